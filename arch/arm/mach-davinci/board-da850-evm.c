@@ -2387,10 +2387,23 @@ static __init void da850_evm_init(void)
 		da8xx_register_mcasp(0, &da850_evm_snd_data);
 	}
 
+#if defined(CONFIG_DAVINCI_PRUSS) || defined(CONFIG_DAVINCI_PRUSS_MODULE)
+	ret = da8xx_register_pruss();
+#else
 	ret = da8xx_register_pruss_uio(&da8xx_pruss_uio_pdata);
+#endif
 	if (ret)
-		pr_warning("%s: pruss_uio initialization failed: %d\n",
-				__func__, ret);	
+		pr_warning("%s: pruss initialization failed: %d\n",
+				__func__, ret);
+
+#if defined(CONFIG_DAVINCI_PRU_GPIO) || defined(CONFIG_DAVINCI_PRU_GPIO_MODULE)
+	if (!ret) {
+		ret = da8xx_register_pru_gpio();
+		if (ret)
+			pr_warning("%s: pru gpio registration failed: %d\n",
+					__func__, ret);
+	}
+#endif
 
 	ret = davinci_cfg_reg_list(da850_lcdcntl_pins);
 	if (ret)
@@ -2443,7 +2456,7 @@ static __init void da850_evm_init(void)
 		pr_warning("da850_evm_init: cpufreq registration failed: %d\n",
 				ret);
 
-	ret = da8xx_register_cpuidle();
+	ret = da8xx_register_cpuidle(true);
 	if (ret)
 		pr_warning("da850_evm_init: cpuidle registration failed: %d\n",
 				ret);
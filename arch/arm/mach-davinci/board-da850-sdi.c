@@ -1751,7 +1751,7 @@ static __init void da850_evm_init(void)
 		pr_warning("da850_evm_init: cpufreq registration failed: %d\n",
 				ret);
 
-	ret = da8xx_register_cpuidle();
+	ret = da8xx_register_cpuidle(false);
 	if (ret)
 		pr_warning("da850_evm_init: cpuidle registration failed: %d\n",
 				ret);
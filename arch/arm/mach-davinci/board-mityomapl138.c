@@ -558,7 +558,7 @@ static void __init mityomapl138_init(void)
 	if (ret)
 		pr_warning("rtc setup failed: %d\n", ret);
 
-	ret = da8xx_register_cpuidle();
+	ret = da8xx_register_cpuidle(false);
 	if (ret)
 		pr_warning("cpuidle registration failed: %d\n", ret);
 
@@ -19,6 +19,7 @@
 #include <linux/mutex.h>
 #include <linux/io.h>
 #include <linux/delay.h>
+#include <linux/sched.h>
 
 #include <mach/hardware.h>
 
@@ -31,23 +32,74 @@ static LIST_HEAD(clocks);
 static DEFINE_MUTEX(clocks_mutex);
 static DEFINE_SPINLOCK(clockfw_lock);
 
+#ifdef CONFIG_DEBUG_FS
+/*
+ * Usage accounting for debugfs: how often and for how long each clock
+ * has been on, plus a short history of clk_enable()/clk_disable() calls
+ * so it's possible to tell who keeps a module powered.
+ */
+#define CLK_HISTORY	64
+
+struct clk_event {
+	u64		time;
+	struct clk	*clk;
+	void		*caller;
+	u8		usecount;	/* after the call */
+	bool		enable;
+};
+
+static struct clk_event clk_history[CLK_HISTORY];
+static unsigned clk_history_next;
+
+static void clk_account_on(struct clk *clk)
+{
+	clk->enables++;
+	clk->on_since = sched_clock();
+}
+
+static void clk_account_off(struct clk *clk)
+{
+	clk->on_time += sched_clock() - clk->on_since;
+}
+
+static void clk_record(struct clk *clk, bool enable, void *caller)
+{
+	struct clk_event *e = &clk_history[clk_history_next++ % CLK_HISTORY];
+
+	e->time = sched_clock();
+	e->clk = clk;
+	e->caller = caller;
+	e->usecount = clk->usecount;
+	e->enable = enable;
+}
+#else
+static inline void clk_account_on(struct clk *clk) { }
+static inline void clk_account_off(struct clk *clk) { }
+static inline void clk_record(struct clk *clk, bool enable, void *caller) { }
+#endif
+
 static void __clk_enable(struct clk *clk)
 {
 	if (clk->parent)
 		__clk_enable(clk->parent);
-	if (clk->usecount++ == 0 && (clk->flags & CLK_PSC))
-		davinci_psc_config(clk->domain, clk->gpsc, clk->lpsc,
-				true, clk->flags);
+	if (clk->usecount++ == 0) {
+		clk_account_on(clk);
+		if (clk->flags & CLK_PSC)
+			davinci_psc_config(clk->domain, clk->gpsc, clk->lpsc,
+					true, clk->flags);
+	}
 }
 
 static void __clk_disable(struct clk *clk)
 {
 	if (WARN_ON(clk->usecount == 0))
 		return;
-	if (--clk->usecount == 0 && !(clk->flags & CLK_PLL) &&
-	    (clk->flags & CLK_PSC))
-		davinci_psc_config(clk->domain, clk->gpsc, clk->lpsc,
-				false, clk->flags);
+	if (--clk->usecount == 0) {
+		clk_account_off(clk);
+		if (!(clk->flags & CLK_PLL) && (clk->flags & CLK_PSC))
+			davinci_psc_config(clk->domain, clk->gpsc, clk->lpsc,
+					false, clk->flags);
+	}
 	if (clk->parent)
 		__clk_disable(clk->parent);
 }
@@ -61,6 +113,7 @@ int clk_enable(struct clk *clk)
 
 	spin_lock_irqsave(&clockfw_lock, flags);
 	__clk_enable(clk);
+	clk_record(clk, true, __builtin_return_address(0));
 	spin_unlock_irqrestore(&clockfw_lock, flags);
 
 	return 0;
@@ -76,6 +129,7 @@ void clk_disable(struct clk *clk)
 
 	spin_lock_irqsave(&clockfw_lock, flags);
 	__clk_disable(clk);
+	clk_record(clk, false, __builtin_return_address(0));
 	spin_unlock_irqrestore(&clockfw_lock, flags);
 }
 EXPORT_SYMBOL(clk_disable);
@@ -503,6 +557,50 @@ int davinci_set_pllrate(struct pll_data *pll, unsigned int prediv,
 }
 EXPORT_SYMBOL(davinci_set_pllrate);
 
+/**
+ * davinci_set_pllpostdiv - change only the post divider of a locked PLL.
+ *
+ * Unlike davinci_set_pllrate() the PLL is neither bypassed nor reset, so
+ * the new rate takes effect within a few cycles and the masters clocked
+ * from the PLL keep running across the change.
+ *
+ * @pll: pll whose rate needs to be changed.
+ * @postdiv: The post divider value. Passing 0 disables the post-divider.
+ */
+int davinci_set_pllpostdiv(struct pll_data *pll, unsigned int postdiv)
+{
+	unsigned long flags;
+	u32 v;
+
+	if (pll->base == NULL || !(pll->flags & PLL_HAS_POSTDIV))
+		return -EINVAL;
+
+	if (postdiv)
+		postdiv = (postdiv - 1) | PLLDIV_EN;
+
+	spin_lock_irqsave(&clockfw_lock, flags);
+
+	do {
+		v = __raw_readl(pll->base + PLLSTAT);
+	} while (v & PLLSTAT_GOSTAT);
+
+	__raw_writel(postdiv, pll->base + POSTDIV);
+
+	/* Align the SYSCLK dividers to the new PLL output */
+	v = __raw_readl(pll->base + PLLCMD);
+	v |= PLLCMD_GOSET;
+	__raw_writel(v, pll->base + PLLCMD);
+
+	do {
+		v = __raw_readl(pll->base + PLLSTAT);
+	} while (v & PLLSTAT_GOSTAT);
+
+	spin_unlock_irqrestore(&clockfw_lock, flags);
+
+	return 0;
+}
+EXPORT_SYMBOL(davinci_set_pllpostdiv);
+
 /**
  * davinci_set_refclk_rate() - Set the reference clock rate
  * @rate:	The new rate.
@@ -594,6 +692,7 @@ int __init davinci_clk_init(struct clk_lookup *clocks)
 
 #include <linux/debugfs.h>
 #include <linux/seq_file.h>
+#include <linux/slab.h>
 
 #define CLKNAME_MAX	10		/* longest clock name */
 #define NEST_DELTA	2
@@ -659,10 +758,106 @@ static const struct file_operations davinci_ck_operations = {
 	.release	= single_release,
 };
 
+/* Per clock: current users, times turned on, total time on */
+static int davinci_clk_usage_show(struct seq_file *m, void *v)
+{
+	u64 now = sched_clock(), up_ms = now;
+	struct clk *clk;
+
+	do_div(up_ms, NSEC_PER_MSEC);
+	seq_printf(m, "%-12s %5s %8s %12s %4s\n",
+		   "clock", "users", "enables", "on ms", "on%");
+
+	mutex_lock(&clocks_mutex);
+	list_for_each_entry(clk, &clocks, node) {
+		unsigned long flags, enables;
+		unsigned usecount;
+		u64 on;
+
+		spin_lock_irqsave(&clockfw_lock, flags);
+		usecount = clk->usecount;
+		enables = clk->enables;
+		on = clk->on_time;
+		if (usecount)
+			on += now - clk->on_since;
+		spin_unlock_irqrestore(&clockfw_lock, flags);
+
+		do_div(on, NSEC_PER_MSEC);
+		seq_printf(m, "%-12s %5u %8lu %12llu %3u%%\n", clk->name,
+			   usecount, enables, (unsigned long long)on,
+			   up_ms ? (unsigned)div64_u64(on * 100, up_ms) : 0);
+	}
+	mutex_unlock(&clocks_mutex);
+
+	return 0;
+}
+
+static int davinci_clk_usage_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, davinci_clk_usage_show, NULL);
+}
+
+static const struct file_operations davinci_clk_usage_operations = {
+	.open		= davinci_clk_usage_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+/* The last CLK_HISTORY clk_enable()/clk_disable() calls, oldest first */
+static int davinci_clk_history_show(struct seq_file *m, void *v)
+{
+	struct clk_event *hist;
+	unsigned long flags;
+	unsigned i, next;
+
+	hist = kmalloc(sizeof(clk_history), GFP_KERNEL);
+	if (!hist)
+		return -ENOMEM;
+
+	spin_lock_irqsave(&clockfw_lock, flags);
+	memcpy(hist, clk_history, sizeof(clk_history));
+	next = clk_history_next;
+	spin_unlock_irqrestore(&clockfw_lock, flags);
+
+	for (i = 0; i < CLK_HISTORY; i++) {
+		struct clk_event *e = &hist[(next + i) % CLK_HISTORY];
+		unsigned long usec;
+		u64 t;
+
+		if (!e->clk)
+			continue;
+		t = e->time;
+		usec = do_div(t, NSEC_PER_SEC) / NSEC_PER_USEC;
+		seq_printf(m, "[%5lu.%06lu] %-12s %s users=%u %pS\n",
+			   (unsigned long)t, usec, e->clk->name,
+			   e->enable ? "on " : "off", e->usecount, e->caller);
+	}
+
+	kfree(hist);
+	return 0;
+}
+
+static int davinci_clk_history_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, davinci_clk_history_show, NULL);
+}
+
+static const struct file_operations davinci_clk_history_operations = {
+	.open		= davinci_clk_history_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int __init davinci_clk_debugfs_init(void)
 {
 	debugfs_create_file("davinci_clocks", S_IFREG | S_IRUGO, NULL, NULL,
 						&davinci_ck_operations);
+	debugfs_create_file("davinci_clock_usage", S_IFREG | S_IRUGO, NULL,
+			    NULL, &davinci_clk_usage_operations);
+	debugfs_create_file("davinci_clock_history", S_IFREG | S_IRUGO, NULL,
+			    NULL, &davinci_clk_history_operations);
 	return 0;
 
 }
@@ -103,6 +103,12 @@ struct clk {
 	unsigned long (*recalc) (struct clk *);
 	int (*set_rate) (struct clk *clk, unsigned long rate);
 	int (*round_rate) (struct clk *clk, unsigned long rate);
+#ifdef CONFIG_DEBUG_FS
+	/* usage accounting, under clockfw_lock */
+	unsigned long		enables;	/* usecount 0 -> 1 transitions */
+	u64			on_since;	/* sched_clock() when enabled */
+	u64			on_time;	/* ns enabled, up to on_since */
+#endif
 };
 
 /* Clock flags: SoC-specific flags start at BIT(16) */
@@ -123,6 +129,7 @@ struct clk {
 int davinci_clk_init(struct clk_lookup *clocks);
 int davinci_set_pllrate(struct pll_data *pll, unsigned int prediv,
 				unsigned int mult, unsigned int postdiv);
+int davinci_set_pllpostdiv(struct pll_data *pll, unsigned int postdiv);
 int davinci_set_sysclk_rate(struct clk *clk, unsigned long rate);
 int davinci_set_refclk_rate(unsigned long rate);
 int davinci_simple_set_rate(struct clk *clk, unsigned long rate);
@@ -12,6 +12,13 @@
 #include <linux/init.h>
 #include <linux/irq.h>
 #include <linux/io.h>
+#include <linux/slab.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/sched.h>
+
+#include <asm/exception.h>
+#include <asm/mach/irq.h>
 
 #include <mach/common.h>
 #include <mach/cp_intc.h>
@@ -90,6 +97,168 @@ static int cp_intc_set_wake(struct irq_data *d, unsigned int on)
 	return 0;
 }
 
+#ifdef CONFIG_CP_INTC_IRQ_STATS
+/* log2 buckets in units of 1024 ns: < 1, < 2, < 4 ... < 1024, >= 1024 */
+#define CP_INTC_HIST_BUCKETS	12
+
+struct cp_intc_irq_stats {
+	u32 count;
+	u32 latency[CP_INTC_HIST_BUCKETS];
+	u32 duration[CP_INTC_HIST_BUCKETS];
+	u32 max_latency;		/* ns */
+	u32 max_duration;		/* ns */
+};
+
+static struct cp_intc_irq_stats *cp_intc_stats;
+static u32 cp_intc_stats_enabled;
+
+static inline void cp_intc_hist_add(u32 *hist, u32 *max, u64 ns)
+{
+	unsigned bucket = fls((u32)(ns >> 10));
+
+	hist[min(bucket, CP_INTC_HIST_BUCKETS - 1)]++;
+	if (ns > *max)
+		*max = min_t(u64, ns, U32_MAX);
+}
+
+static void cp_intc_handle_irq_stats(unsigned irq, struct pt_regs *regs,
+				     u64 entry)
+{
+	struct cp_intc_irq_stats *s = &cp_intc_stats[irq];
+	u64 start, end;
+
+	start = sched_clock();
+	handle_IRQ(irq, regs);
+	end = sched_clock();
+
+	s->count++;
+	cp_intc_hist_add(s->latency, &s->max_latency, start - entry);
+	cp_intc_hist_add(s->duration, &s->max_duration, end - start);
+}
+
+static void cp_intc_hist_show(struct seq_file *m, const char *what,
+			      const u32 *hist, u32 max)
+{
+	int i;
+
+	seq_printf(m, "  %-8s", what);
+	for (i = 0; i < CP_INTC_HIST_BUCKETS; i++)
+		seq_printf(m, " %7u", hist[i]);
+	seq_printf(m, " %9u\n", max);
+}
+
+static int cp_intc_stats_show(struct seq_file *m, void *v)
+{
+	unsigned num_irq = davinci_soc_info.intc_irq_num;
+	struct cp_intc_irq_stats *s;
+	struct irqaction *action;
+	int i;
+
+	seq_printf(m, "%-10s", "us");
+	for (i = 0; i < CP_INTC_HIST_BUCKETS - 1; i++)
+		seq_printf(m, " %6s%u", "<", 1 << i);
+	seq_printf(m, " %6s%u %9s\n", ">=", 1 << i, "max(ns)");
+
+	for (i = 0; i < num_irq; i++) {
+		s = &cp_intc_stats[i];
+		if (!s->count)
+			continue;
+
+		action = irq_to_desc(i)->action;
+		seq_printf(m, "%3d: %u %s\n", i, s->count,
+			   action ? action->name : "");
+		cp_intc_hist_show(m, "latency", s->latency, s->max_latency);
+		cp_intc_hist_show(m, "duration", s->duration, s->max_duration);
+	}
+
+	return 0;
+}
+
+static int cp_intc_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, cp_intc_stats_show, NULL);
+}
+
+/* Any write clears the histograms */
+static ssize_t cp_intc_stats_write(struct file *file, const char __user *buf,
+				   size_t count, loff_t *ppos)
+{
+	unsigned num_irq = davinci_soc_info.intc_irq_num;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	memset(cp_intc_stats, 0, num_irq * sizeof(*cp_intc_stats));
+	local_irq_restore(flags);
+
+	return count;
+}
+
+static const struct file_operations cp_intc_stats_fops = {
+	.open		= cp_intc_stats_open,
+	.read		= seq_read,
+	.write		= cp_intc_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init cp_intc_stats_init(void)
+{
+	unsigned num_irq = davinci_soc_info.intc_irq_num;
+	struct dentry *dir;
+
+	if (davinci_intc_type != DAVINCI_INTC_TYPE_CP_INTC)
+		return 0;
+
+	cp_intc_stats = kcalloc(num_irq, sizeof(*cp_intc_stats), GFP_KERNEL);
+	if (!cp_intc_stats)
+		return -ENOMEM;
+
+	dir = debugfs_create_dir("cp_intc", NULL);
+	if (!dir)
+		return -ENOMEM;
+
+	debugfs_create_bool("enable", S_IRUGO | S_IWUSR, dir,
+			    &cp_intc_stats_enabled);
+	debugfs_create_file("irq_stats", S_IRUGO | S_IWUSR, dir, NULL,
+			    &cp_intc_stats_fops);
+	return 0;
+}
+late_initcall(cp_intc_stats_init);
+#endif
+
+#ifdef CONFIG_MULTI_IRQ_HANDLER
+/*
+ * Dispatch every pending interrupt in one exception entry, highest
+ * priority first, as reported by the global prioritized index register.
+ */
+static asmlinkage void __exception_irq_entry
+cp_intc_handle_irq(struct pt_regs *regs)
+{
+	u32 irqnr;
+#ifdef CONFIG_CP_INTC_IRQ_STATS
+	u64 entry = 0;
+
+	if (cp_intc_stats_enabled && cp_intc_stats)
+		entry = sched_clock();
+#endif
+
+	for (;;) {
+		irqnr = cp_intc_read(CP_INTC_PRIO_IDX);
+		if (irqnr & CP_INTC_PRIO_IDX_NONE)
+			break;
+		irqnr &= CP_INTC_PRIO_IDX_MASK;
+
+#ifdef CONFIG_CP_INTC_IRQ_STATS
+		if (entry) {
+			cp_intc_handle_irq_stats(irqnr, regs, entry);
+			continue;
+		}
+#endif
+		handle_IRQ(irqnr, regs);
+	}
+}
+#endif
+
 static struct irq_chip cp_intc_irq_chip = {
 	.name		= "cp_intc",
 	.irq_ack	= cp_intc_ack_irq,
@@ -172,6 +341,10 @@ void __init cp_intc_init(void)
 		irq_set_handler(i, handle_edge_irq);
 	}
 
+#ifdef CONFIG_MULTI_IRQ_HANDLER
+	handle_arch_irq = cp_intc_handle_irq;
+#endif
+
 	/* Enable global interrupt */
 	cp_intc_write(1, CP_INTC_GLOBAL_ENABLE);
 }
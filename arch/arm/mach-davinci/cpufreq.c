@@ -164,12 +164,15 @@ static int davinci_cpu_init(struct cpufreq_policy *policy)
 	policy->cur = davinci_getspeed(0);
 
 	/*
-	 * Time measurement across the target() function yields ~1500-1800us
-	 * time taken with no drivers on notification list.
-	 * Setting the latency to 2000 us to accommodate addition of drivers
-	 * to pre/post change notification list.
+	 * Without a platform figure, fall back to the time measured across
+	 * the target() function (~1500-1800us with no drivers on the
+	 * notification list), rounded up to 2000 us to accommodate drivers
+	 * on the pre/post change notification list.
 	 */
-	policy->cpuinfo.transition_latency = 2000 * 1000;
+	if (pdata->transition_latency)
+		policy->cpuinfo.transition_latency = pdata->transition_latency;
+	else
+		policy->cpuinfo.transition_latency = 2000 * 1000;
 	return 0;
 }
 
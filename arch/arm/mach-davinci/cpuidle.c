@@ -17,21 +17,32 @@
 #include <linux/cpuidle.h>
 #include <linux/io.h>
 #include <linux/export.h>
+#include <linux/hrtimer.h>
+#include <linux/stat.h>
 #include <asm/proc-fns.h>
 
 #include <mach/cpuidle.h>
 #include <mach/ddr2.h>
+#include <mach/edma.h>
 
-#define DAVINCI_CPUIDLE_MAX_STATES	2
+#define DAVINCI_CPUIDLE_MAX_STATES	3
+
+/* residency histogram buckets: < 10us, < 100us, ... < 1s, >= 1s */
+#define DAVINCI_CPUIDLE_HIST_BUCKETS	7
 
 struct davinci_ops {
 	void (*enter) (u32 flags);
 	void (*exit) (u32 flags);
 	u32 flags;
+	/* worst case wake-up including the DDR2 low-power exit, in us */
+	unsigned int exit_latency;
+	u32 hist[DAVINCI_CPUIDLE_HIST_BUCKETS];
+	u32 demoted;
 };
 
 /* fields in davinci_ops.flags */
-#define DAVINCI_CPUIDLE_FLAGS_DDR2_PWDN	BIT(0)
+#define DAVINCI_CPUIDLE_FLAGS_DDR2_PWDN		BIT(0)
+#define DAVINCI_CPUIDLE_FLAGS_DDR2_MCLKSTOP	BIT(1)
 
 static struct cpuidle_driver davinci_idle_driver = {
 	.name	= "cpuidle-davinci",
@@ -41,20 +52,23 @@ static struct cpuidle_driver davinci_idle_driver = {
 static DEFINE_PER_CPU(struct cpuidle_device, davinci_cpuidle_device);
 static void __iomem *ddr2_reg_base;
 
-static void davinci_save_ddr_power(int enter, bool pdown)
+static void davinci_save_ddr_power(int enter, u32 flags)
 {
 	u32 val;
 
 	val = __raw_readl(ddr2_reg_base + DDR2_SDRCR_OFFSET);
 
 	if (enter) {
-		if (pdown)
+		if (flags & DAVINCI_CPUIDLE_FLAGS_DDR2_PWDN)
 			val |= DDR2_SRPD_BIT;
 		else
 			val &= ~DDR2_SRPD_BIT;
+		if (flags & DAVINCI_CPUIDLE_FLAGS_DDR2_MCLKSTOP)
+			val |= DDR2_MCLKSTOPEN_BIT;
 		val |= DDR2_LPMODEN_BIT;
 	} else {
-		val &= ~(DDR2_SRPD_BIT | DDR2_LPMODEN_BIT);
+		val &= ~(DDR2_SRPD_BIT | DDR2_MCLKSTOPEN_BIT |
+			 DDR2_LPMODEN_BIT);
 	}
 
 	__raw_writel(val, ddr2_reg_base + DDR2_SDRCR_OFFSET);
@@ -62,33 +76,67 @@ static void davinci_save_ddr_power(int enter, bool pdown)
 
 static void davinci_c2state_enter(u32 flags)
 {
-	davinci_save_ddr_power(1, !!(flags & DAVINCI_CPUIDLE_FLAGS_DDR2_PWDN));
+	davinci_save_ddr_power(1, flags);
 }
 
 static void davinci_c2state_exit(u32 flags)
 {
-	davinci_save_ddr_power(0, !!(flags & DAVINCI_CPUIDLE_FLAGS_DDR2_PWDN));
+	davinci_save_ddr_power(0, flags);
 }
 
 static struct davinci_ops davinci_states[DAVINCI_CPUIDLE_MAX_STATES] = {
+	[0] = {
+		.exit_latency	= 1,
+	},
 	[1] = {
-		.enter	= davinci_c2state_enter,
-		.exit	= davinci_c2state_exit,
+		.enter		= davinci_c2state_enter,
+		.exit		= davinci_c2state_exit,
+		.exit_latency	= 10,
+	},
+	[2] = {
+		.enter		= davinci_c2state_enter,
+		.exit		= davinci_c2state_exit,
+		.flags		= DAVINCI_CPUIDLE_FLAGS_DDR2_MCLKSTOP,
+		.exit_latency	= 20,
 	},
 };
 
+static void davinci_account_residency(struct davinci_ops *ops, int idle_time)
+{
+	int i, limit = 10;
+
+	for (i = 0; i < DAVINCI_CPUIDLE_HIST_BUCKETS - 1; i++, limit *= 10)
+		if (idle_time < limit)
+			break;
+	ops->hist[i]++;
+}
+
 /* Actual code that puts the SoC in different idle states */
 static int davinci_enter_idle(struct cpuidle_device *dev,
 				struct cpuidle_driver *drv,
 						int index)
 {
-	struct cpuidle_state_usage *state_usage = &dev->states_usage[index];
-	struct davinci_ops *ops = cpuidle_get_statedata(state_usage);
-	struct timeval before, after;
+	struct cpuidle_state_usage *state_usage;
+	struct davinci_ops *ops;
+	ktime_t before, after;
 	int idle_time;
 
+	/*
+	 * With MCLK stopped a DMA master stalls for the whole self-refresh
+	 * exit, so don't go there while EDMA may be moving data.
+	 */
+	ops = &davinci_states[index];
+	if ((ops->flags & DAVINCI_CPUIDLE_FLAGS_DDR2_MCLKSTOP) &&
+	    edma_is_active()) {
+		ops->demoted++;
+		index = 1;
+	}
+
+	state_usage = &dev->states_usage[index];
+	ops = cpuidle_get_statedata(state_usage);
+
 	local_irq_disable();
-	do_gettimeofday(&before);
+	before = ktime_get();
 
 	if (ops && ops->enter)
 		ops->enter(ops->flags);
@@ -97,22 +145,49 @@ static int davinci_enter_idle(struct cpuidle_device *dev,
 	if (ops && ops->exit)
 		ops->exit(ops->flags);
 
-	do_gettimeofday(&after);
+	after = ktime_get();
 	local_irq_enable();
-	idle_time = (after.tv_sec - before.tv_sec) * USEC_PER_SEC +
-			(after.tv_usec - before.tv_usec);
+	idle_time = ktime_us_delta(after, before);
 
 	dev->last_residency = idle_time;
 
+	if (ops)
+		davinci_account_residency(ops, idle_time);
+
 	return index;
 }
 
+static ssize_t davinci_residency_show(struct device *dev,
+				      struct device_attribute *attr, char *buf)
+{
+	struct cpuidle_driver *driver = &davinci_idle_driver;
+	struct davinci_ops *ops;
+	int i, j, len;
+
+	len = sprintf(buf, "%-8s %10s %10s %10s %10s %10s %10s %10s %8s\n",
+		      "state", "<10us", "<100us", "<1ms", "<10ms", "<100ms",
+		      "<1s", ">=1s", "demoted");
+
+	for (i = 0; i < driver->state_count; i++) {
+		ops = &davinci_states[i];
+		len += sprintf(buf + len, "%-8s", driver->states[i].name);
+		for (j = 0; j < DAVINCI_CPUIDLE_HIST_BUCKETS; j++)
+			len += sprintf(buf + len, " %10u", ops->hist[j]);
+		len += sprintf(buf + len, " %8u\n", ops->demoted);
+	}
+
+	return len;
+}
+
+static DEVICE_ATTR(residency, S_IRUGO, davinci_residency_show, NULL);
+
 static int __init davinci_cpuidle_probe(struct platform_device *pdev)
 {
-	int ret;
+	int ret, i;
 	struct cpuidle_device *device;
 	struct cpuidle_driver *driver = &davinci_idle_driver;
 	struct davinci_cpuidle_config *pdata = pdev->dev.platform_data;
+	int state_count = DAVINCI_CPUIDLE_MAX_STATES;
 
 	device = &per_cpu(davinci_cpuidle_device, smp_processor_id());
 
@@ -125,7 +200,7 @@ static int __init davinci_cpuidle_probe(struct platform_device *pdev)
 
 	/* Wait for interrupt state */
 	driver->states[0].enter = davinci_enter_idle;
-	driver->states[0].exit_latency = 1;
+	driver->states[0].exit_latency = davinci_states[0].exit_latency;
 	driver->states[0].target_residency = 10000;
 	driver->states[0].flags = CPUIDLE_FLAG_TIME_VALID;
 	strcpy(driver->states[0].name, "WFI");
@@ -133,17 +208,34 @@ static int __init davinci_cpuidle_probe(struct platform_device *pdev)
 
 	/* Wait for interrupt and DDR self refresh state */
 	driver->states[1].enter = davinci_enter_idle;
-	driver->states[1].exit_latency = 10;
+	driver->states[1].exit_latency = davinci_states[1].exit_latency;
 	driver->states[1].target_residency = 10000;
 	driver->states[1].flags = CPUIDLE_FLAG_TIME_VALID;
 	strcpy(driver->states[1].name, "DDR SR");
 	strcpy(driver->states[1].desc, "WFI and DDR Self Refresh");
 	if (pdata->ddr2_pdown)
 		davinci_states[1].flags |= DAVINCI_CPUIDLE_FLAGS_DDR2_PWDN;
-	cpuidle_set_statedata(&device->states_usage[1], &davinci_states[1]);
 
-	device->state_count = DAVINCI_CPUIDLE_MAX_STATES;
-	driver->state_count = DAVINCI_CPUIDLE_MAX_STATES;
+	/* Wait for interrupt, DDR self refresh and DDR clock gated */
+	if (pdata->ddr2_mclkstop) {
+		driver->states[2].enter = davinci_enter_idle;
+		driver->states[2].exit_latency =
+					davinci_states[2].exit_latency;
+		driver->states[2].target_residency = 20000;
+		driver->states[2].flags = CPUIDLE_FLAG_TIME_VALID;
+		strcpy(driver->states[2].name, "DDR CG");
+		strcpy(driver->states[2].desc,
+		       "WFI, DDR Self Refresh and MCLK stopped");
+	} else {
+		state_count--;
+	}
+
+	for (i = 0; i < state_count; i++)
+		cpuidle_set_statedata(&device->states_usage[i],
+				      &davinci_states[i]);
+
+	device->state_count = state_count;
+	driver->state_count = state_count;
 
 	ret = cpuidle_register_driver(&davinci_idle_driver);
 	if (ret) {
@@ -158,6 +250,9 @@ static int __init davinci_cpuidle_probe(struct platform_device *pdev)
 		return ret;
 	}
 
+	if (device_create_file(&pdev->dev, &dev_attr_residency))
+		dev_warn(&pdev->dev, "failed to create residency attribute\n");
+
 	return 0;
 }
 
@@ -974,12 +974,6 @@ static struct map_desc da850_io_desc[] = {
 		.length		= DA8XX_CP_INTC_SIZE,
 		.type		= MT_DEVICE
 	},
-	{
-		.virtual	= SRAM_VIRT,
-		.pfn		= __phys_to_pfn(DA8XX_SHARED_RAM_BASE),
-		.length		= SZ_8K,
-		.type		= MT_DEVICE
-	},
 };
 
 static u32 da850_psc_bases[] = { DA8XX_PSC0_BASE, DA8XX_PSC1_BASE };
@@ -1221,12 +1215,26 @@ static int da850_set_voltage(unsigned int index)
 
 static int da850_regulator_init(void)
 {
+	struct cpufreq_frequency_table *table = cpufreq_info.freq_table;
+	struct da850_opp *high, *low;
+	int ramp;
+	int i;
+
 	cvdd = regulator_get(NULL, "cvdd");
 	if (WARN(IS_ERR(cvdd), "Unable to obtain voltage regulator for CVDD;"
 					" voltage scaling unsupported\n")) {
 		return PTR_ERR(cvdd);
 	}
 
+	/* Account for the worst case CVDD ramp in the transition latency */
+	for (i = 0; table[i + 1].frequency != CPUFREQ_TABLE_END; i++)
+		;
+	high = (struct da850_opp *) table[0].index;
+	low = (struct da850_opp *) table[i].index;
+	ramp = regulator_set_voltage_time(cvdd, low->cvdd_min, high->cvdd_max);
+	if (ramp > 0)
+		cpufreq_info.transition_latency += ramp * NSEC_PER_USEC;
+
 	return 0;
 }
 #endif
@@ -1246,6 +1254,52 @@ static void da850_set_pll0_bypass_src(bool pll1_sysclk3)
 	__raw_writel(v, pll->base + PLLCTL);
 }
 
+/*
+ * Worst case time spent reprogramming PLL0 between any two OPPs of the
+ * table, in ns. OPPs sharing the pre-divider and multiplier only need a
+ * post-divider update; anything else bypasses the PLL and waits for it
+ * to lock again.
+ */
+static unsigned int da850_pll0_latency(void)
+{
+	struct cpufreq_frequency_table *table = cpufreq_info.freq_table;
+	struct da850_opp *opp, *first = (struct da850_opp *) table[0].index;
+	unsigned int latency = 10;	/* GOSET alignment, in us */
+	int i;
+
+	for (i = 0; table[i].frequency != CPUFREQ_TABLE_END; i++) {
+		opp = (struct da850_opp *) table[i].index;
+		if (opp->prediv == first->prediv && opp->mult == first->mult)
+			continue;
+		latency = max(latency, PLL_BYPASS_TIME + PLL_RESET_TIME +
+			      (2000 * max(opp->prediv, first->prediv)) / 100);
+	}
+
+	return latency * NSEC_PER_USEC;
+}
+
+/*
+ * True if PLL0 already runs with the pre-divider and multiplier of @opp,
+ * so that only the post-divider has to change.
+ */
+static bool da850_pll0_postdiv_only(struct pll_data *pll,
+				    const struct da850_opp *opp)
+{
+	u32 v;
+
+	if (!(__raw_readl(pll->base + PLLCTL) & PLLCTL_PLLEN))
+		return false;
+
+	v = __raw_readl(pll->base + PLLM) & PLLM_PLLM_MASK;
+	if (v != opp->mult - 1)
+		return false;
+
+	v = __raw_readl(pll->base + PREDIV);
+	v = (v & PLLDIV_EN) ? (v & pll->div_ratio_mask) + 1 : 1;
+
+	return v == opp->prediv;
+}
+
 static struct platform_device da850_cpufreq_device = {
 	.name			= "cpufreq-davinci",
 	.dev = {
@@ -1275,6 +1329,8 @@ int __init da850_register_cpufreq(char *async_clk)
 		}
 	}
 
+	cpufreq_info.transition_latency = da850_pll0_latency();
+
 	return platform_device_register(&da850_cpufreq_device);
 }
 
@@ -1319,7 +1375,10 @@ static int da850_set_pll0rate(struct clk *clk, unsigned long index)
 	mult = opp->mult;
 	postdiv = opp->postdiv;
 
-	ret = davinci_set_pllrate(pll, prediv, mult, postdiv);
+	if (da850_pll0_postdiv_only(pll, opp))
+		ret = davinci_set_pllpostdiv(pll, postdiv);
+	else
+		ret = davinci_set_pllrate(pll, prediv, mult, postdiv);
 	if (WARN_ON(ret))
 		return ret;
 
@@ -1730,8 +1789,9 @@ static struct davinci_soc_info davinci_soc_info_da850 = {
 	.gpio_irq		= IRQ_DA8XX_GPIO0,
 	.serial_dev		= &da8xx_serial_device,
 	.emac_pdata		= &da8xx_emac_pdata,
-	.sram_phys		= DA8XX_ARM_RAM_BASE,
-	.sram_len		= SZ_8K,
+	.sram_phys		= DA8XX_SHARED_RAM_BASE,
+	.sram_len		= SZ_128K,
+	.sram_dsp_len		= SZ_64K,
 };
 
 void __init da850_init(void)
@@ -63,6 +63,8 @@
 #define DA8XX_DMA_MMCSD0_TX	EDMA_CTLR_CHAN(0, 17)
 #define DA8XX_DMA_SPI1_RX	EDMA_CTLR_CHAN(0, 18)
 #define DA8XX_DMA_SPI1_TX	EDMA_CTLR_CHAN(0, 19)
+#define DA8XX_DMA_I2C0_RX	EDMA_CTLR_CHAN(0, 24)
+#define DA8XX_DMA_I2C1_RX	EDMA_CTLR_CHAN(0, 26)
 #define DA850_DMA_MMCSD1_RX	EDMA_CTLR_CHAN(1, 28)
 #define DA850_DMA_MMCSD1_TX	EDMA_CTLR_CHAN(1, 29)
 
@@ -332,6 +334,11 @@ static struct resource da8xx_i2c_resources0[] = {
 		.end	= IRQ_DA8XX_I2CINT0,
 		.flags	= IORESOURCE_IRQ,
 	},
+	{		/* DMA RX */
+		.start	= DA8XX_DMA_I2C0_RX,
+		.end	= DA8XX_DMA_I2C0_RX,
+		.flags	= IORESOURCE_DMA,
+	},
 };
 
 static struct platform_device da8xx_i2c_device0 = {
@@ -352,6 +359,11 @@ static struct resource da8xx_i2c_resources1[] = {
 		.end	= IRQ_DA8XX_I2CINT1,
 		.flags	= IORESOURCE_IRQ,
 	},
+	{		/* DMA RX */
+		.start	= DA8XX_DMA_I2C1_RX,
+		.end	= DA8XX_DMA_I2C1_RX,
+		.flags	= IORESOURCE_DMA,
+	},
 };
 
 static struct platform_device da8xx_i2c_device1 = {
@@ -619,6 +631,34 @@ int __init da8xx_register_pruss_uio(struct uio_pruss_pdata *config)
 	return platform_device_register(&da8xx_pruss_uio_dev);
 }
 
+static struct platform_device da8xx_pruss_dev = {
+	.name		= "davinci_pruss",
+	.id		= -1,
+	.num_resources	= ARRAY_SIZE(da8xx_pruss_resources),
+	.resource	= da8xx_pruss_resources,
+	.dev	 =	{
+		.coherent_dma_mask = 0xffffffff,
+	}
+};
+
+int __init da8xx_register_pruss(void)
+{
+	return platform_device_register(&da8xx_pruss_dev);
+}
+
+static struct platform_device da8xx_pru_gpio_dev = {
+	.name		= "davinci_pru_gpio",
+	.id		= -1,
+	.dev	 =	{
+		.parent	= &da8xx_pruss_dev.dev,
+	}
+};
+
+int __init da8xx_register_pru_gpio(void)
+{
+	return platform_device_register(&da8xx_pru_gpio_dev);
+}
+
 static const struct display_panel disp_panel = {
 #ifdef CONFIG_GLCD_DVI_VGA
 	VGA,
@@ -931,7 +971,7 @@ static struct resource da8xx_cpuidle_resources[] = {
 	},
 };
 
-/* DA8XX devices support DDR2 power down */
+/* DA8XX devices support DDR2 power down in self-refresh */
 static struct davinci_cpuidle_config da8xx_cpuidle_pdata = {
 	.ddr2_pdown	= 1,
 };
@@ -946,9 +986,14 @@ static struct platform_device da8xx_cpuidle_device = {
 	},
 };
 
-int __init da8xx_register_cpuidle(void)
+/*
+ * Boards validated with DDR2 MCLK stopped in self-refresh pass @mclkstop to
+ * get the extra idle state.
+ */
+int __init da8xx_register_cpuidle(bool mclkstop)
 {
 	da8xx_cpuidle_pdata.ddr2_ctlr_base = da8xx_get_mem_ctlr();
+	da8xx_cpuidle_pdata.ddr2_mclkstop = mclkstop;
 
 	return platform_device_register(&da8xx_cpuidle_device);
 }
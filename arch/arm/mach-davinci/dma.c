@@ -85,6 +85,7 @@
 #define EDMA_QWMTHRA	0x0620
 #define EDMA_QWMTHRB	0x0624
 #define EDMA_CCSTAT	0x0640
+#define CCSTAT_ACTV	BIT(4)
 
 #define EDMA_M		0x1000	/* global channel registers */
 #define EDMA_ECR	0x1008
@@ -1386,6 +1387,30 @@ void edma_clear_event(unsigned channel)
 }
 EXPORT_SYMBOL(edma_clear_event);
 
+/**
+ * edma_is_active - check whether any channel may be moving data
+ *
+ * Returns true while a channel controller is busy or any channel has
+ * its hardware event enabled, i.e. a peripheral is streaming through
+ * EDMA and will need memory at short notice.  Meant for idle code
+ * deciding whether it may take the memory into a slow-to-exit state.
+ */
+bool edma_is_active(void)
+{
+	unsigned ctlr;
+
+	for (ctlr = 0; ctlr < arch_num_cc; ctlr++) {
+		if (edma_read(ctlr, EDMA_CCSTAT) & CCSTAT_ACTV)
+			return true;
+		if (edma_shadow0_read_array(ctlr, SH_EER, 0) ||
+		    edma_shadow0_read_array(ctlr, SH_EER, 1))
+			return true;
+	}
+
+	return false;
+}
+EXPORT_SYMBOL(edma_is_active);
+
 /*-----------------------------------------------------------------------*/
 
 static int __init edma_probe(struct platform_device *pdev)
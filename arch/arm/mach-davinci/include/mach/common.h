@@ -77,6 +77,7 @@ struct davinci_soc_info {
 	struct emac_platform_data	*emac_pdata;
 	phys_addr_t			sram_phys;
 	unsigned			sram_len;
+	unsigned			sram_dsp_len;	/* left to the DSP */
 };
 
 extern struct davinci_soc_info davinci_soc_info;
@@ -28,6 +28,8 @@
 #define CP_INTC_VECTOR_SIZE		0x54
 #define CP_INTC_VECTOR_NULL		0x58
 #define CP_INTC_PRIO_IDX		0x80
+#define CP_INTC_PRIO_IDX_NONE		BIT(31)
+#define CP_INTC_PRIO_IDX_MASK		0x3ff
 #define CP_INTC_PRIO_VECTOR		0x84
 #define CP_INTC_SECURE_ENABLE		0x90
 #define CP_INTC_SECURE_PRIO_IDX 	0x94
@@ -22,6 +22,8 @@ struct davinci_cpufreq_config {
 	int (*set_voltage) (unsigned int index);
 	int (*init) (void);
 	unsigned int emif_rate;
+	/* worst case OPP transition time in ns, 0 if unknown */
+	unsigned int transition_latency;
 };
 
 #endif
@@ -12,6 +12,8 @@
 
 struct davinci_cpuidle_config {
 	u32 ddr2_pdown;
+	/* stop DDR2 MCLK in the deepest (self-refresh) state */
+	u32 ddr2_mclkstop;
 	void __iomem *ddr2_ctlr_base;
 };
 
@@ -113,13 +113,15 @@ int da8xx_register_usb20(unsigned mA, unsigned potpgt);
 int da8xx_register_usb11(struct da8xx_ohci_root_hub *pdata);
 int da8xx_register_emac(void);
 int da8xx_register_pruss_uio(struct uio_pruss_pdata *config);
+int da8xx_register_pruss(void);
+int da8xx_register_pru_gpio(void);
 int da8xx_register_lcdc(struct da8xx_lcdc_platform_data *pdata);
 int da8xx_register_mmcsd0(struct davinci_mmc_config *config);
 int da850_register_mmcsd1(struct davinci_mmc_config *config);
 void __init da8xx_register_mcasp(int id, struct snd_platform_data *pdata);
 int da8xx_register_rtc(void);
 int da850_register_cpufreq(char *async_clk);
-int da8xx_register_cpuidle(void);
+int da8xx_register_cpuidle(bool mclkstop);
 void __iomem * __init da8xx_get_mem_ctlr(void);
 int __init da850_register_pm(struct platform_device *pdev);
 int __init da850_register_sata(unsigned long refclkpn);
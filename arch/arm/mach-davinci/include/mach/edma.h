@@ -235,6 +235,8 @@ void edma_clear_event(unsigned channel);
 void edma_pause(unsigned channel);
 void edma_resume(unsigned channel);
 
+bool edma_is_active(void);
+
 struct edma_rsv_info {
 
 	const s16	(*rsv_chans)[2];
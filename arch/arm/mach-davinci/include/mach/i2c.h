@@ -18,6 +18,8 @@ struct davinci_i2c_platform_data {
 	unsigned int	bus_delay;	/* post-transaction delay (usec) */
 	unsigned int    sda_pin;        /* GPIO pin ID to use for SDA */
 	unsigned int    scl_pin;        /* GPIO pin ID to use for SCL */
+	unsigned int	poll_usecs;	/* poll transfers up to this long */
+	unsigned int	dma_min;	/* EDMA for reads of this many bytes */
 };
 
 /* for board setup code */
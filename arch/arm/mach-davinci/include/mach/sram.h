@@ -17,4 +17,21 @@
 
 extern struct gen_pool *davinci_gen_pool;
 
+/*
+ * Placement priority of a named SRAM region.  Part of the pool (the
+ * "reserve" parameter) is only handed out to HIGH priority requests, so
+ * data that must live in SRAM is not crowded out by data that merely
+ * benefits from it.  Userspace mappings are always LOW.
+ */
+enum davinci_sram_prio {
+	DAVINCI_SRAM_PRIO_LOW,
+	DAVINCI_SRAM_PRIO_NORMAL,
+	DAVINCI_SRAM_PRIO_HIGH,
+};
+
+extern void *davinci_sram_alloc(const char *name, size_t len,
+				enum davinci_sram_prio prio,
+				phys_addr_t *phys);
+extern void davinci_sram_free(void *addr);
+
 #endif /* __MACH_SRAM_H */
@@ -120,8 +120,9 @@ static int __init davinci_pm_probe(struct platform_device *pdev)
 		return -ENOENT;
 	}
 
-	davinci_sram_suspend_mem = (void *)gen_pool_alloc(davinci_gen_pool,
-				davinci_cpu_suspend_sz);
+	davinci_sram_suspend_mem = davinci_sram_alloc("suspend",
+				davinci_cpu_suspend_sz, DAVINCI_SRAM_PRIO_HIGH,
+				NULL);
 	if (!davinci_sram_suspend_mem) {
 		dev_err(&pdev->dev, "cannot allocate SRAM memory\n");
 		return -ENOMEM;
@@ -136,8 +137,7 @@ static int __init davinci_pm_probe(struct platform_device *pdev)
 
 static int __exit davinci_pm_remove(struct platform_device *pdev)
 {
-	gen_pool_free(davinci_gen_pool, (unsigned long)davinci_sram_suspend_mem,
-		davinci_cpu_suspend_sz);
+	davinci_sram_free(davinci_sram_suspend_mem);
 	return 0;
 }
 
@@ -10,6 +10,17 @@
  */
 #include <linux/module.h>
 #include <linux/init.h>
+#include <linux/io.h>
+#include <linux/slab.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/miscdevice.h>
+#include <linux/fs.h>
+#include <linux/mm.h>
+
+#include <asm/sizes.h>
 
 #include <mach/common.h>
 #include <mach/sram.h>
@@ -17,6 +28,318 @@
 struct gen_pool *davinci_gen_pool;
 EXPORT_SYMBOL_GPL(davinci_gen_pool);
 
+/*
+ * Regions handed out through davinci_sram_alloc() and /dev/sram.  The
+ * pool itself is lockless; sram_lock only covers the bookkeeping and
+ * makes the reserve check and the allocation atomic with respect to
+ * each other.
+ */
+struct sram_region {
+	struct list_head	node;
+	unsigned long		alloc;		/* as returned by gen_pool */
+	size_t			alloc_len;
+	unsigned long		virt;		/* aligned start */
+	phys_addr_t		phys;
+	size_t			len;
+	enum davinci_sram_prio	prio;
+	int			users;		/* vmas mapping a /dev/sram region */
+	char			name[24];
+};
+
+static LIST_HEAD(sram_regions);
+static DEFINE_MUTEX(sram_lock);
+static size_t sram_low_used;
+
+/* Bytes that only HIGH priority requests may use */
+static unsigned sram_reserve;
+module_param_named(reserve, sram_reserve, uint, 0644);
+MODULE_PARM_DESC(reserve, "SRAM bytes kept back for high priority regions");
+
+/* Leading part of a SRAM shared with the DSP which the pool keeps out of */
+static int sram_dsp_len = -1;
+module_param_named(dsp_len, sram_dsp_len, int, 0444);
+MODULE_PARM_DESC(dsp_len, "SRAM bytes left to the DSP (-1: SoC default)");
+
+/* Cap on everything allocated at LOW priority, userspace included */
+static unsigned sram_low_max = SZ_32K;
+module_param_named(low_max, sram_low_max, uint, 0644);
+MODULE_PARM_DESC(low_max, "maximum SRAM bytes given to low priority regions");
+
+static struct sram_region *sram_region_alloc(const char *name, size_t len,
+		size_t align, enum davinci_sram_prio prio)
+{
+	struct sram_region *r;
+	size_t alloc_len, avail;
+
+	if (!davinci_gen_pool || !len)
+		return NULL;
+
+	r = kzalloc(sizeof(*r), GFP_KERNEL);
+	if (!r)
+		return NULL;
+
+	len = ALIGN(len, SRAM_GRANULARITY);
+	alloc_len = len;
+	if (align > SRAM_GRANULARITY)
+		alloc_len += align - SRAM_GRANULARITY;
+
+	mutex_lock(&sram_lock);
+
+	avail = gen_pool_avail(davinci_gen_pool);
+	if (prio != DAVINCI_SRAM_PRIO_HIGH && avail < alloc_len + sram_reserve)
+		goto fail;
+	if (prio == DAVINCI_SRAM_PRIO_LOW &&
+			sram_low_used + alloc_len > sram_low_max)
+		goto fail;
+
+	r->alloc = gen_pool_alloc(davinci_gen_pool, alloc_len);
+	if (!r->alloc)
+		goto fail;
+
+	r->alloc_len = alloc_len;
+	r->virt = ALIGN(r->alloc, max_t(size_t, align, SRAM_GRANULARITY));
+	r->phys = gen_pool_virt_to_phys(davinci_gen_pool, r->virt);
+	r->len = len;
+	r->prio = prio;
+	strlcpy(r->name, name, sizeof(r->name));
+
+	if (prio == DAVINCI_SRAM_PRIO_LOW)
+		sram_low_used += alloc_len;
+	list_add_tail(&r->node, &sram_regions);
+
+	mutex_unlock(&sram_lock);
+	return r;
+
+fail:
+	mutex_unlock(&sram_lock);
+	pr_debug("sram: no room for %s (%zu bytes, prio %d)\n",
+		 name, len, prio);
+	kfree(r);
+	return NULL;
+}
+
+/* Called with sram_lock held */
+static void sram_region_release(struct sram_region *r)
+{
+	list_del(&r->node);
+	if (r->prio == DAVINCI_SRAM_PRIO_LOW)
+		sram_low_used -= r->alloc_len;
+	gen_pool_free(davinci_gen_pool, r->alloc, r->alloc_len);
+	kfree(r);
+}
+
+/**
+ * davinci_sram_alloc - place a named region in on-chip SRAM
+ * @name: label shown in the debugfs usage map
+ * @len: size in bytes, rounded up to SRAM_GRANULARITY
+ * @prio: placement priority
+ * @phys: if not NULL, receives the physical (DMA) address
+ *
+ * Returns the kernel virtual address of the region, or NULL when SRAM
+ * is exhausted for this priority; callers are expected to fall back to
+ * DDR in that case.  May sleep.
+ */
+void *davinci_sram_alloc(const char *name, size_t len,
+			 enum davinci_sram_prio prio, phys_addr_t *phys)
+{
+	struct sram_region *r;
+
+	r = sram_region_alloc(name, len, 0, prio);
+	if (!r)
+		return NULL;
+
+	if (phys)
+		*phys = r->phys;
+	return (void *)r->virt;
+}
+EXPORT_SYMBOL_GPL(davinci_sram_alloc);
+
+/**
+ * davinci_sram_free - release a region from davinci_sram_alloc()
+ * @addr: address returned by davinci_sram_alloc()
+ */
+void davinci_sram_free(void *addr)
+{
+	struct sram_region *r;
+
+	mutex_lock(&sram_lock);
+	list_for_each_entry(r, &sram_regions, node) {
+		if (r->virt == (unsigned long)addr) {
+			sram_region_release(r);
+			mutex_unlock(&sram_lock);
+			return;
+		}
+	}
+	mutex_unlock(&sram_lock);
+
+	WARN(1, "sram: freeing unknown region %p\n", addr);
+}
+EXPORT_SYMBOL_GPL(davinci_sram_free);
+
+#ifdef CONFIG_DAVINCI_SRAM_DEV
+/*
+ * /dev/sram: every mmap() of the device places a fresh LOW priority
+ * region of the mapping's size in SRAM, which lives until the last vma
+ * referring to it goes away.  The mapping is uncached, matching the
+ * kernel's device mapping of the same memory.
+ */
+static void sram_vma_open(struct vm_area_struct *vma)
+{
+	struct sram_region *r = vma->vm_private_data;
+
+	mutex_lock(&sram_lock);
+	r->users++;
+	mutex_unlock(&sram_lock);
+}
+
+static void sram_vma_close(struct vm_area_struct *vma)
+{
+	struct sram_region *r = vma->vm_private_data;
+
+	mutex_lock(&sram_lock);
+	if (!--r->users)
+		sram_region_release(r);
+	mutex_unlock(&sram_lock);
+}
+
+static const struct vm_operations_struct sram_vm_ops = {
+	.open	= sram_vma_open,
+	.close	= sram_vma_close,
+};
+
+static int sram_dev_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	size_t len = vma->vm_end - vma->vm_start;
+	struct sram_region *r;
+	char name[24];
+	int ret;
+
+	if (vma->vm_pgoff)
+		return -EINVAL;
+
+	snprintf(name, sizeof(name), "%s[%d]", current->comm,
+		 task_pid_nr(current));
+	r = sram_region_alloc(name, len, PAGE_SIZE, DAVINCI_SRAM_PRIO_LOW);
+	if (!r)
+		return -ENOMEM;
+
+	/* Don't leak what the previous owner left behind */
+	memset_io((void __iomem *)r->virt, 0, len);
+
+	vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+	vma->vm_flags |= VM_IO | VM_RESERVED | VM_DONTCOPY | VM_DONTEXPAND;
+
+	ret = remap_pfn_range(vma, vma->vm_start, __phys_to_pfn(r->phys),
+			      len, vma->vm_page_prot);
+	if (ret) {
+		mutex_lock(&sram_lock);
+		sram_region_release(r);
+		mutex_unlock(&sram_lock);
+		return ret;
+	}
+
+	r->users = 1;
+	vma->vm_private_data = r;
+	vma->vm_ops = &sram_vm_ops;
+	return 0;
+}
+
+static const struct file_operations sram_dev_fops = {
+	.owner	= THIS_MODULE,
+	.mmap	= sram_dev_mmap,
+	.llseek	= noop_llseek,
+};
+
+static struct miscdevice sram_miscdev = {
+	.minor	= MISC_DYNAMIC_MINOR,
+	.name	= "sram",
+	.fops	= &sram_dev_fops,
+};
+
+static int __init sram_dev_init(void)
+{
+	if (!davinci_gen_pool)
+		return 0;
+
+	return misc_register(&sram_miscdev);
+}
+device_initcall(sram_dev_init);
+#endif
+
+#ifdef CONFIG_DEBUG_FS
+static const char *sram_prio_names[] = {
+	[DAVINCI_SRAM_PRIO_LOW]		= "low",
+	[DAVINCI_SRAM_PRIO_NORMAL]	= "normal",
+	[DAVINCI_SRAM_PRIO_HIGH]	= "high",
+};
+
+/* One character per SRAM_GRANULARITY bytes, 64 to a line */
+static void sram_show_chunk(struct gen_pool *pool,
+			    struct gen_pool_chunk *chunk, void *data)
+{
+	struct seq_file *m = data;
+	int order = pool->min_alloc_order;
+	int nbits = (chunk->end_addr - chunk->start_addr) >> order;
+	int i;
+
+	for (i = 0; i < nbits; i++) {
+		if (!(i % 64))
+			seq_printf(m, "%s0x%08x ", i ? "\n" : "",
+				   chunk->phys_addr + (i << order));
+		seq_putc(m, test_bit(i, chunk->bits) ? '#' : '.');
+	}
+	seq_putc(m, '\n');
+}
+
+static int sram_usage_show(struct seq_file *m, void *v)
+{
+	struct sram_region *r;
+
+	mutex_lock(&sram_lock);
+
+	seq_printf(m, "size %zu, free %zu, reserve %u, low %zu/%u\n\n",
+		   gen_pool_size(davinci_gen_pool),
+		   gen_pool_avail(davinci_gen_pool), sram_reserve,
+		   sram_low_used, sram_low_max);
+
+	seq_printf(m, "%-10s %-10s %6s %-6s %s\n",
+		   "phys", "virt", "size", "prio", "name");
+	list_for_each_entry(r, &sram_regions, node)
+		seq_printf(m, "0x%08x 0x%08lx %6zu %-6s %s\n",
+			   r->phys, r->virt, r->len,
+			   sram_prio_names[r->prio], r->name);
+
+	seq_printf(m, "\nmap, %d bytes per character:\n", SRAM_GRANULARITY);
+	gen_pool_for_each_chunk(davinci_gen_pool, sram_show_chunk, m);
+
+	mutex_unlock(&sram_lock);
+	return 0;
+}
+
+static int sram_usage_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sram_usage_show, NULL);
+}
+
+static const struct file_operations sram_usage_fops = {
+	.open		= sram_usage_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init sram_debugfs_init(void)
+{
+	if (!davinci_gen_pool)
+		return 0;
+
+	debugfs_create_file("davinci_sram", S_IRUGO, NULL, NULL,
+			    &sram_usage_fops);
+	return 0;
+}
+late_initcall(sram_debugfs_init);
+#endif
+
 /*
  * REVISIT This supports CPU and DMA access to/from SRAM, but it
  * doesn't (yet?) support some other notable uses of SRAM:  as TCM
@@ -26,18 +349,39 @@ EXPORT_SYMBOL_GPL(davinci_gen_pool);
 static int __init sram_init(void)
 {
 	unsigned len = davinci_soc_info.sram_len;
+	phys_addr_t phys = davinci_soc_info.sram_phys;
+	unsigned dsp_len = davinci_soc_info.sram_dsp_len;
+	unsigned long virt;
+	bool in_window = len <= SZ_32K;
 
-	if (!len)
+	/* Only the part the ARM owns goes into the pool */
+	if (sram_dsp_len >= 0)
+		dsp_len = ALIGN(sram_dsp_len, SRAM_GRANULARITY);
+	if (dsp_len >= len)
 		return 0;
+	phys += dsp_len;
+	len -= dsp_len;
+
+	/*
+	 * Small SRAMs sit in the static SRAM_VIRT window; anything larger
+	 * (the 128K DA850 shared RAM) would run into the vector page, so
+	 * it is mapped dynamically instead.
+	 */
+	if (in_window) {
+		virt = SRAM_VIRT + dsp_len;
+	} else {
+		len = min_t(unsigned, len, SRAM_SIZE);
+		virt = (unsigned long)ioremap(phys, len);
+		if (!virt)
+			return -ENOMEM;
+	}
 
-	len = min_t(unsigned, len, SRAM_SIZE);
 	davinci_gen_pool = gen_pool_create(ilog2(SRAM_GRANULARITY), -1);
 
 	if (!davinci_gen_pool)
 		return -ENOMEM;
 
-	WARN_ON(gen_pool_add_virt(davinci_gen_pool, SRAM_VIRT,
-				  davinci_soc_info.sram_phys, len, -1));
+	WARN_ON(gen_pool_add_virt(davinci_gen_pool, virt, phys, len, -1));
 
 	return 0;
 }
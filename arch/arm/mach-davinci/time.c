@@ -22,6 +22,7 @@
 #include <mach/hardware.h>
 #include <asm/mach/irq.h>
 #include <asm/mach/time.h>
+#include <asm/sched_clock.h>
 #include <mach/cputype.h>
 #include <mach/time.h>
 #include "clock.h"
@@ -29,6 +30,14 @@
 static struct clock_event_device clockevent_davinci;
 static unsigned int davinci_clock_tick_rate;
 
+/*
+ * Shortest oneshot period we program.  Reloading a stopped timer half
+ * is four register writes, so a couple of microseconds is plenty; the
+ * compare register variant has to stay clear of the counter it chases.
+ */
+#define DAVINCI_MIN_DELTA_NS		2000
+#define DAVINCI_MIN_DELTA_CMP_NS	50000
+
 /*
  * This driver configures the 2 64-bit count-up timers as 4 independent
  * 32-bit count-up timers used as follows:
@@ -94,6 +103,8 @@ struct timer_s {
 	unsigned long tim_off;
 	unsigned long prd_off;
 	unsigned long enamode_shift;
+	/* TCR with this half disabled, cached for oneshot reloads */
+	u32 tcr_off;
 	struct irqaction irqaction;
 };
 static struct timer_s timers[];
@@ -167,12 +178,6 @@ static irqreturn_t timer_interrupt(int irq, void *dev_id)
 	return IRQ_HANDLED;
 }
 
-/* called when 32-bit counter wraps */
-static irqreturn_t freerun_interrupt(int irq, void *dev_id)
-{
-	return IRQ_HANDLED;
-}
-
 static struct timer_s timers[] = {
 	[TID_CLOCKEVENT] = {
 		.name      = "clockevent",
@@ -182,14 +187,15 @@ static struct timer_s timers[] = {
 			.handler = timer_interrupt,
 		}
 	},
+	/*
+	 * No interrupt for the free-running counter: nothing needs to
+	 * know when it wraps, and it would only wake up a tickless idle
+	 * CPU every three minutes.
+	 */
 	[TID_CLOCKSOURCE] = {
 		.name       = "free-run counter",
 		.period     = ~0,
 		.opts       = TIMER_OPTS_PERIODIC,
-		.irqaction = {
-			.flags   = IRQF_DISABLED | IRQF_TIMER,
-			.handler = freerun_interrupt,
-		}
 	},
 };
 
@@ -272,32 +278,20 @@ static cycle_t read_cycles(struct clocksource *cs)
 	return (cycles_t)timer32_read(t);
 }
 
-/*
- * Kernel assumes that sched_clock can be called early but may not have
- * things ready yet.
- */
-static cycle_t read_dummy(struct clocksource *cs)
-{
-	return 0;
-}
-
-
 static struct clocksource clocksource_davinci = {
 	.rating		= 300,
-	.read		= read_dummy,
+	.read		= read_cycles,
 	.mask		= CLOCKSOURCE_MASK(32),
 	.flags		= CLOCK_SOURCE_IS_CONTINUOUS,
 };
 
 /*
- * Overwrite weak default sched_clock with something more precise
+ * sched_clock from the free-running half; the ARM sched_clock code
+ * extends it past the 32-bit wrap (~179 s at 24 MHz).
  */
-unsigned long long notrace sched_clock(void)
+static u32 notrace davinci_read_sched_clock(void)
 {
-	const cycle_t cyc = clocksource_davinci.read(&clocksource_davinci);
-
-	return clocksource_cyc2ns(cyc, clocksource_davinci.mult,
-				clocksource_davinci.shift);
+	return timer32_read(&timers[TID_CLOCKSOURCE]);
 }
 
 /*
@@ -308,8 +302,18 @@ static int davinci_set_next_event(unsigned long cycles,
 {
 	struct timer_s *t = &timers[TID_CLOCKEVENT];
 
-	t->period = cycles;
-	timer32_config(t);
+	if (USING_COMPARE(t)) {
+		t->period = cycles;
+		timer32_config(t);
+		return 0;
+	}
+
+	/* Stop, rewind and restart the half without reading anything back */
+	__raw_writel(t->tcr_off, t->base + TCR);
+	__raw_writel(0, t->base + t->tim_off);
+	__raw_writel(cycles, t->base + t->prd_off);
+	__raw_writel(t->tcr_off | (TCR_ENAMODE_ONESHOT << t->enamode_shift),
+		     t->base + TCR);
 	return 0;
 }
 
@@ -328,6 +332,16 @@ static void davinci_set_mode(enum clock_event_mode mode,
 	case CLOCK_EVT_MODE_ONESHOT:
 		t->opts &= ~TIMER_OPTS_STATE_MASK;
 		t->opts |= TIMER_OPTS_ONESHOT;
+		if (USING_COMPARE(t))
+			break;
+		/*
+		 * The other half of this timer is the free-running
+		 * clocksource (or unused) and never changes mode again,
+		 * so TCR can be cached here.
+		 */
+		t->tcr_off = __raw_readl(t->base + TCR) &
+			     ~(TCR_ENAMODE_MASK << t->enamode_shift);
+		__raw_writel(t->tcr_off, t->base + TCR);
 		break;
 	case CLOCK_EVT_MODE_UNUSED:
 	case CLOCK_EVT_MODE_SHUTDOWN:
@@ -355,7 +369,6 @@ static void __init davinci_timer_init(void)
 	unsigned int clocksource_id;
 	static char err[] __initdata = KERN_ERR
 		"%s: can't register clocksource!\n";
-	int i;
 
 	clockevent_id = soc_info->timer_info->clockevent_id;
 	clocksource_id = soc_info->timer_info->clocksource_id;
@@ -396,8 +409,12 @@ static void __init davinci_timer_init(void)
 
 	davinci_clock_tick_rate = clk_get_rate(timer_clk);
 
+	/* Start the free-running counter before anything reads it */
+	timer32_config(&timers[TID_CLOCKSOURCE]);
+	setup_sched_clock(davinci_read_sched_clock, 32,
+			  davinci_clock_tick_rate);
+
 	/* setup clocksource */
-	clocksource_davinci.read = read_cycles;
 	clocksource_davinci.name = id_to_name[clocksource_id];
 	if (clocksource_register_hz(&clocksource_davinci,
 				    davinci_clock_tick_rate))
@@ -409,13 +426,13 @@ static void __init davinci_timer_init(void)
 					 clockevent_davinci.shift);
 	clockevent_davinci.max_delta_ns =
 		clockevent_delta2ns(0xfffffffe, &clockevent_davinci);
-	clockevent_davinci.min_delta_ns = 50000; /* 50 usec */
+	if (USING_COMPARE(&timers[TID_CLOCKEVENT]))
+		clockevent_davinci.min_delta_ns = DAVINCI_MIN_DELTA_CMP_NS;
+	else
+		clockevent_davinci.min_delta_ns = DAVINCI_MIN_DELTA_NS;
 
 	clockevent_davinci.cpumask = cpumask_of(0);
 	clockevents_register_device(&clockevent_davinci);
-
-	for (i=0; i< ARRAY_SIZE(timers); i++)
-		timer32_config(&timers[i]);
 }
 
 struct sys_timer davinci_timer = {
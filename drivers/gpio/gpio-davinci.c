@@ -131,6 +131,42 @@ davinci_gpio_set(struct gpio_chip *chip, unsigned offset, int value)
 	__raw_writel((1 << offset), value ? &g->set_data : &g->clr_data);
 }
 
+/*
+ * A chip is one bank pair, so the whole set is one in_data read.
+ */
+static unsigned long
+davinci_gpio_get_multiple(struct gpio_chip *chip, unsigned offset,
+			  unsigned long mask)
+{
+	struct davinci_gpio_controller *d = chip2controller(chip);
+	struct davinci_gpio_regs __iomem *g = d->regs;
+
+	return __raw_readl(&g->in_data) >> offset;
+}
+
+/*
+ * All pins change with the one out_data write, so the bus never sees a
+ * mix of old and new values.  DaVinci parts are uniprocessor, and with
+ * interrupts off no set_data/clr_data write to the bank can land
+ * between our read and write of out_data.
+ */
+static void
+davinci_gpio_set_multiple(struct gpio_chip *chip, unsigned offset,
+			  unsigned long mask, unsigned long bits)
+{
+	struct davinci_gpio_controller *d = chip2controller(chip);
+	struct davinci_gpio_regs __iomem *g = d->regs;
+	unsigned long flags;
+	u32 temp;
+
+	spin_lock_irqsave(&d->lock, flags);
+	temp = __raw_readl(&g->out_data);
+	temp &= ~(mask << offset);
+	temp |= (bits & mask) << offset;
+	__raw_writel(temp, &g->out_data);
+	spin_unlock_irqrestore(&d->lock, flags);
+}
+
 static int __init davinci_gpio_setup(void)
 {
 	int i, base;
@@ -166,6 +202,8 @@ static int __init davinci_gpio_setup(void)
 		chips[i].chip.get = davinci_gpio_get;
 		chips[i].chip.direction_output = davinci_direction_out;
 		chips[i].chip.set = davinci_gpio_set;
+		chips[i].chip.get_multiple = davinci_gpio_get_multiple;
+		chips[i].chip.set_multiple = davinci_gpio_set_multiple;
 
 		chips[i].chip.base = base;
 		chips[i].chip.ngpio = ngpio - base;
@@ -189,6 +189,40 @@ err:
 	return ret;
 }
 
+/*
+ * Helpers for the bulk accessors.  "mask" has already been checked to lie
+ * within the chip, so any chip->base + offset + N it selects is valid.
+ */
+static unsigned long gpiochip_get_multiple(struct gpio_chip *chip,
+		unsigned offset, unsigned long mask)
+{
+	unsigned long	values = 0;
+	int		i;
+
+	if (chip->get_multiple)
+		return chip->get_multiple(chip, offset, mask) & mask;
+
+	if (chip->get)
+		for_each_set_bit(i, &mask, BITS_PER_LONG)
+			if (chip->get(chip, offset + i))
+				values |= BIT(i);
+	return values;
+}
+
+static void gpiochip_set_multiple(struct gpio_chip *chip,
+		unsigned offset, unsigned long mask, unsigned long values)
+{
+	int		i;
+
+	if (chip->set_multiple) {
+		chip->set_multiple(chip, offset, mask, values & mask);
+		return;
+	}
+
+	for_each_set_bit(i, &mask, BITS_PER_LONG)
+		chip->set(chip, offset + i, values & BIT(i));
+}
+
 #ifdef CONFIG_GPIO_SYSFS
 
 /* lock protects against unexport_gpio() being called while
@@ -558,6 +592,7 @@ static const struct attribute_group gpio_attr_group = {
  *   /base ... matching gpio_chip.base (N)
  *   /label ... matching gpio_chip.label
  *   /ngpio ... matching gpio_chip.ngpio
+ *   /values ... read/write, bulk access to exported gpios
  */
 
 static ssize_t chip_base_show(struct device *dev,
@@ -587,10 +622,87 @@ static ssize_t chip_ngpio_show(struct device *dev,
 }
 static DEVICE_ATTR(ngpio, 0444, chip_ngpio_show, NULL);
 
+/*
+ * "values" covers the first BITS_PER_LONG gpios of the chip as one hex
+ * word, bit N being gpio base + N.  Only exported gpios take part: the
+ * others read as zero and may not be written.  Writing "MASK VALUES"
+ * assigns VALUES to the exported outputs in MASK together, going through
+ * set_multiple() when the chip has it.  Active-low settings apply as
+ * they do for the per-gpio "value" attribute.
+ */
+static unsigned long chip_exported(struct gpio_chip *chip,
+		unsigned long *active_low, unsigned long *output)
+{
+	unsigned long	exported = 0;
+	unsigned	i, n = min_t(unsigned, chip->ngpio, BITS_PER_LONG);
+
+	*active_low = *output = 0;
+	for (i = 0; i < n; i++) {
+		struct gpio_desc *desc = &gpio_desc[chip->base + i];
+
+		if (!test_bit(FLAG_EXPORT, &desc->flags))
+			continue;
+		exported |= BIT(i);
+		if (test_bit(FLAG_ACTIVE_LOW, &desc->flags))
+			*active_low |= BIT(i);
+		if (test_bit(FLAG_IS_OUT, &desc->flags))
+			*output |= BIT(i);
+	}
+	return exported;
+}
+
+static ssize_t chip_values_show(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	struct gpio_chip	*chip = dev_get_drvdata(dev);
+	unsigned long		exported, active_low, output, values = 0;
+	int			width = DIV_ROUND_UP(min_t(unsigned,
+						chip->ngpio, BITS_PER_LONG), 4);
+
+	mutex_lock(&sysfs_lock);
+
+	exported = chip_exported(chip, &active_low, &output);
+	if (exported)
+		values = gpiochip_get_multiple(chip, 0, exported) ^ active_low;
+
+	mutex_unlock(&sysfs_lock);
+	return sprintf(buf, "%0*lx\n", width, values);
+}
+
+static ssize_t chip_values_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t size)
+{
+	struct gpio_chip	*chip = dev_get_drvdata(dev);
+	unsigned long		exported, active_low, output, mask, values;
+	ssize_t			status;
+
+	if (sscanf(buf, "%lx %lx", &mask, &values) != 2)
+		return -EINVAL;
+
+	mutex_lock(&sysfs_lock);
+
+	exported = chip_exported(chip, &active_low, &output);
+	if (mask & ~exported)
+		status = -EIO;
+	else if (mask & ~output)
+		status = -EPERM;
+	else {
+		if (mask)
+			gpiochip_set_multiple(chip, 0, mask,
+					      values ^ active_low);
+		status = size;
+	}
+
+	mutex_unlock(&sysfs_lock);
+	return status;
+}
+static DEVICE_ATTR(values, 0644, chip_values_show, chip_values_store);
+
 static const struct attribute *gpiochip_attrs[] = {
 	&dev_attr_base.attr,
 	&dev_attr_label.attr,
 	&dev_attr_ngpio.attr,
+	&dev_attr_values.attr,
 	NULL,
 };
 
@@ -1654,6 +1766,73 @@ void gpio_set_value_cansleep(unsigned gpio, int value)
 }
 EXPORT_SYMBOL_GPL(gpio_set_value_cansleep);
 
+static struct gpio_chip *gpio_multiple_to_chip(unsigned gpio,
+		unsigned long mask)
+{
+	struct gpio_chip	*chip;
+
+	if (!mask || !gpio_is_valid(gpio))
+		return NULL;
+	chip = gpio_to_chip(gpio);
+	if (!chip || gpio - chip->base + fls_long(mask) > chip->ngpio)
+		return NULL;
+	return chip;
+}
+
+/**
+ * gpio_get_multiple() - read several gpios of one chip together
+ * @gpio: lowest gpio; bit N of @mask and @values stands for @gpio + N
+ * @mask: gpios to read
+ * @values: returns their values; bits outside @mask are zero
+ * Context: any, unless the chip can sleep
+ *
+ * All gpios in @mask must belong to the same gpio_chip and be requested.
+ * Chips providing a get_multiple() method sample the whole set in one
+ * access, others are read one gpio at a time.  Returns zero, or -EINVAL
+ * if @mask is empty or does not fit within a single chip.
+ */
+int gpio_get_multiple(unsigned gpio, unsigned long mask, unsigned long *values)
+{
+	struct gpio_chip	*chip;
+
+	chip = gpio_multiple_to_chip(gpio, mask);
+	if (!chip)
+		return -EINVAL;
+
+	might_sleep_if(chip->can_sleep);
+	*values = gpiochip_get_multiple(chip, gpio - chip->base, mask);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(gpio_get_multiple);
+
+/**
+ * gpio_set_multiple() - assign several gpios of one chip together
+ * @gpio: lowest gpio; bit N of @mask and @values stands for @gpio + N
+ * @mask: gpios to assign
+ * @values: values to assign; bits outside @mask are ignored
+ * Context: any, unless the chip can sleep
+ *
+ * All gpios in @mask must belong to the same gpio_chip and be requested
+ * outputs.  Chips providing a set_multiple() method update them in as few
+ * register writes as the hardware allows, so a multi-bit bus does not go
+ * through intermediate states one bit at a time; others are assigned one
+ * gpio at a time.  Returns zero, or -EINVAL if @mask is empty or does not
+ * fit within a single chip.
+ */
+int gpio_set_multiple(unsigned gpio, unsigned long mask, unsigned long values)
+{
+	struct gpio_chip	*chip;
+
+	chip = gpio_multiple_to_chip(gpio, mask);
+	if (!chip)
+		return -EINVAL;
+
+	might_sleep_if(chip->can_sleep);
+	gpiochip_set_multiple(chip, gpio - chip->base, mask, values);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(gpio_set_multiple);
+
 
 #ifdef CONFIG_DEBUG_FS
 
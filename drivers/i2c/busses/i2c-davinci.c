@@ -38,13 +38,17 @@
 #include <linux/slab.h>
 #include <linux/cpufreq.h>
 #include <linux/gpio.h>
+#include <linux/dma-mapping.h>
+#include <linux/pm_runtime.h>
 
 #include <mach/hardware.h>
 #include <mach/i2c.h>
+#include <mach/edma.h>
 
 /* ----- global defines ----------------------------------------------- */
 
 #define DAVINCI_I2C_TIMEOUT	(1*HZ)
+#define DAVINCI_I2C_AUTOSUSPEND	100	/* msec idle before gating */
 #define DAVINCI_I2C_MAX_TRIES	2
 #define I2C_DAVINCI_INTR_ALL    (DAVINCI_I2C_IMR_AAS | \
 				 DAVINCI_I2C_IMR_SCD | \
@@ -101,6 +105,7 @@
 struct davinci_i2c_dev {
 	struct device           *dev;
 	void __iomem		*base;
+	resource_size_t		pbase;
 	struct completion	cmd_complete;
 	struct clk              *clk;
 	int			cmd_err;
@@ -110,6 +115,18 @@ struct davinci_i2c_dev {
 	int			stop;
 	u8			terminate;
 	struct i2c_adapter	adapter;
+
+	/* the i2c_transfer() in progress; msgs[cur_msg] is on the bus */
+	struct i2c_msg		*msgs;
+	int			num_msgs;
+	int			cur_msg;
+	bool			chain;		/* ISR may start the next msg */
+
+	/* EDMA for long reads, dma_ch < 0 when unavailable */
+	int			dma_ch;
+	dma_addr_t		dma_addr;
+	size_t			dma_len;	/* nonzero while mapped */
+	struct completion	dma_complete;
 #ifdef CONFIG_CPU_FREQ
 	struct completion	xfr_complete;
 	struct notifier_block	freq_transition;
@@ -300,24 +317,63 @@ static int i2c_davinci_wait_bus_not_busy(struct davinci_i2c_dev *dev,
 	return 0;
 }
 
+static struct davinci_i2c_platform_data *
+i2c_davinci_pdata(struct davinci_i2c_dev *dev)
+{
+	return dev->dev->platform_data ? : &davinci_i2c_platform_data_default;
+}
+
+static bool i2c_davinci_use_dma(struct davinci_i2c_dev *dev,
+				struct i2c_msg *msg)
+{
+	unsigned int dma_min = i2c_davinci_pdata(dev)->dma_min;
+
+	return dev->dma_ch >= 0 && dma_min && (msg->flags & I2C_M_RD) &&
+		msg->len >= dma_min;
+}
+
+static void i2c_davinci_dma_callback(unsigned lch, u16 ch_status, void *data)
+{
+	struct davinci_i2c_dev *dev = data;
+
+	if (ch_status != DMA_COMPLETE)
+		dev_err(dev->dev, "EDMA error %d on read\n", ch_status);
+	complete(&dev->dma_complete);
+}
+
 /*
- * Low level master read/write transaction. This function is called
- * from i2c_davinci_xfer.
+ * Have EDMA move the received bytes from DRR to memory; the controller
+ * raises an RX event for each byte, so the RRDY interrupt stays masked.
  */
-static int
-i2c_davinci_xfer_msg(struct i2c_adapter *adap, struct i2c_msg *msg, int stop)
+static void i2c_davinci_dma_start(struct davinci_i2c_dev *dev)
 {
-	struct davinci_i2c_dev *dev = i2c_get_adapdata(adap);
-	struct davinci_i2c_platform_data *pdata = dev->dev->platform_data;
+	struct edmacc_param param;
+
+	param.opt = TCINTEN | EDMA_TCC(EDMA_CHAN_SLOT(dev->dma_ch));
+	param.src = dev->pbase + DAVINCI_I2C_DRR_REG;
+	param.a_b_cnt = dev->dma_len << 16 | 1;
+	param.dst = dev->dma_addr;
+	param.src_dst_bidx = 1 << 16;
+	param.link_bcntrld = 0xffff;
+	param.src_dst_cidx = 0;
+	param.ccnt = 1;
+	edma_write_slot(dev->dma_ch, &param);
+
+	INIT_COMPLETION(dev->dma_complete);
+	edma_start(dev->dma_ch);
+}
+
+/*
+ * Put msgs[cur_msg] on the bus.  Called from process context for the
+ * first message of a transfer, and from the ISR when chaining to the
+ * next one with a repeated start.
+ */
+static void i2c_davinci_start_msg(struct davinci_i2c_dev *dev)
+{
+	struct i2c_msg *msg = &dev->msgs[dev->cur_msg];
+	int stop = dev->cur_msg == dev->num_msgs - 1;
 	u32 flag;
 	u16 w;
-	int r;
-
-	if (!pdata)
-		pdata = &davinci_i2c_platform_data_default;
-	/* Introduce a delay, required for some boards (e.g Davinci EVM) */
-	if (pdata->bus_delay)
-		udelay(pdata->bus_delay);
 
 	/* set the slave address */
 	davinci_i2c_write_reg(dev, DAVINCI_I2C_SAR_REG, msg->addr);
@@ -328,9 +384,6 @@ i2c_davinci_xfer_msg(struct i2c_adapter *adap, struct i2c_msg *msg, int stop)
 
 	davinci_i2c_write_reg(dev, DAVINCI_I2C_CNT_REG, dev->buf_len);
 
-	INIT_COMPLETION(dev->cmd_complete);
-	dev->cmd_err = 0;
-
 	/* Take I2C out of reset and configure it as master */
 	flag = DAVINCI_I2C_MDR_IRS | DAVINCI_I2C_MDR_MST;
 
@@ -342,12 +395,17 @@ i2c_davinci_xfer_msg(struct i2c_adapter *adap, struct i2c_msg *msg, int stop)
 	if (msg->len == 0)
 		flag |= DAVINCI_I2C_MDR_RM;
 
-	/* Enable receive or transmit interrupts */
+	/* Enable receive or transmit interrupts, unless EDMA reads */
 	w = davinci_i2c_read_reg(dev, DAVINCI_I2C_IMR_REG);
-	if (msg->flags & I2C_M_RD)
+	w &= ~(DAVINCI_I2C_IMR_RRDY | DAVINCI_I2C_IMR_XRDY);
+	if (dev->dma_len) {
+		dev->buf_len = 0;
+		i2c_davinci_dma_start(dev);
+	} else if (msg->flags & I2C_M_RD) {
 		w |= DAVINCI_I2C_IMR_RRDY;
-	else
+	} else {
 		w |= DAVINCI_I2C_IMR_XRDY;
+	}
 	davinci_i2c_write_reg(dev, DAVINCI_I2C_IMR_REG, w);
 
 	dev->terminate = 0;
@@ -376,47 +434,169 @@ i2c_davinci_xfer_msg(struct i2c_adapter *adap, struct i2c_msg *msg, int stop)
 	if (stop && msg->len != 0)
 		flag |= DAVINCI_I2C_MDR_STP;
 	davinci_i2c_write_reg(dev, DAVINCI_I2C_MDR_REG, flag);
+}
+
+/*
+ * Called from the ARDY interrupt when a message not ending in a STOP has
+ * gone through: start the next one straight away, rather than waking the
+ * caller just to have it do the same.  Messages needing a bus_delay, or
+ * involving EDMA, still go back through process context.
+ */
+static bool i2c_davinci_chain(struct davinci_i2c_dev *dev)
+{
+	if (!dev->chain || dev->cmd_err || dev->buf_len || dev->stop ||
+	    dev->dma_len ||
+	    dev->cur_msg + 1 >= dev->num_msgs ||
+	    i2c_davinci_use_dma(dev, &dev->msgs[dev->cur_msg + 1]))
+		return false;
+
+	dev->cur_msg++;
+	i2c_davinci_start_msg(dev);
+	return true;
+}
+
+static int i2c_davinci_handle(struct davinci_i2c_dev *dev);
+
+/*
+ * Give up on the transfer in progress.  Once chaining is off and the ISR
+ * has finished, nothing starts another message; the reset then stops one
+ * the ISR may already have started from msgs[] the caller is about to free.
+ */
+static void i2c_davinci_abort(struct davinci_i2c_dev *dev, bool recover)
+{
+	dev->chain = false;
+	synchronize_irq(dev->irq);
+	if (recover)
+		i2c_recover_bus(dev);
+	i2c_davinci_init(dev);
+	dev->buf_len = 0;
+}
+
+/*
+ * Bus time of a transfer in usec, counting nine clocks per byte
+ * including the address bytes.
+ */
+static unsigned i2c_davinci_xfer_usecs(struct davinci_i2c_dev *dev,
+				       struct i2c_msg msgs[], int num)
+{
+	unsigned bytes = 0;
+	int i;
+
+	for (i = 0; i < num; i++)
+		bytes += msgs[i].len + 1;
+
+	return bytes * 9 * 1000 / i2c_davinci_pdata(dev)->bus_freq;
+}
+
+/*
+ * Wait for a short transfer by running the interrupt handler from here,
+ * with the IRQ line disabled: for a few bytes this takes less time than
+ * the context switches of an interrupt driven transfer.
+ */
+static int i2c_davinci_poll(struct davinci_i2c_dev *dev)
+{
+	unsigned long timeout = jiffies + dev->adapter.timeout;
+
+	while (!try_wait_for_completion(&dev->cmd_complete)) {
+		if (!i2c_davinci_handle(dev)) {
+			if (time_after(jiffies, timeout))
+				return 0;
+			cpu_relax();
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * Low level master read/write transaction, starting at msgs[first] and
+ * running until the ISR stops chaining messages.  Returns the number of
+ * messages completed, or a negative errno.
+ */
+static int
+i2c_davinci_xfer_msgs(struct davinci_i2c_dev *dev, int first, bool polled)
+{
+	struct davinci_i2c_platform_data *pdata = i2c_davinci_pdata(dev);
+	struct i2c_msg *msg = &dev->msgs[first];
+	long r;
+	u16 w;
+
+	/* Introduce a delay, required for some boards (e.g Davinci EVM) */
+	if (pdata->bus_delay)
+		udelay(pdata->bus_delay);
+
+	if (!polled && i2c_davinci_use_dma(dev, msg)) {
+		dev->dma_addr = dma_map_single(dev->dev, msg->buf, msg->len,
+					       DMA_FROM_DEVICE);
+		if (!dma_mapping_error(dev->dev, dev->dma_addr))
+			dev->dma_len = msg->len;
+	}
+
+	INIT_COMPLETION(dev->cmd_complete);
+	dev->cmd_err = 0;
+	dev->cur_msg = first;
+	i2c_davinci_start_msg(dev);
+
+	if (polled)
+		r = i2c_davinci_poll(dev);
+	else
+		r = wait_for_completion_interruptible_timeout(
+				&dev->cmd_complete, dev->adapter.timeout);
+
+	/* the ISR may have moved on to later messages */
+	msg = &dev->msgs[dev->cur_msg];
+
+	if (dev->dma_len) {
+		if (r > 0 && !dev->cmd_err &&
+		    !wait_for_completion_timeout(&dev->dma_complete,
+						 dev->adapter.timeout)) {
+			dev_err(dev->dev, "EDMA read timed out\n");
+			r = -ETIMEDOUT;
+		}
+		edma_stop(dev->dma_ch);
+		dma_unmap_single(dev->dev, dev->dma_addr, dev->dma_len,
+				 DMA_FROM_DEVICE);
+		dev->dma_len = 0;
+		if (r == -ETIMEDOUT) {
+			i2c_davinci_abort(dev, false);
+			return r;
+		}
+	}
 
-	r = wait_for_completion_interruptible_timeout(&dev->cmd_complete,
-						      dev->adapter.timeout);
 	if (r == 0) {
 		dev_err(dev->dev, "controller timed out\n");
-		i2c_recover_bus(dev);
-		i2c_davinci_init(dev);
-		dev->buf_len = 0;
+		i2c_davinci_abort(dev, true);
 		return -ETIMEDOUT;
 	}
-	if (dev->buf_len) {
+	if (r > 0 && dev->buf_len) {
 		/* This should be 0 if all bytes were transferred
 		 * or dev->cmd_err denotes an error.
-		 * A signal may have aborted the transfer.
 		 */
-		if (r >= 0) {
-			dev_err(dev->dev, "abnormal termination buf_len=%i\n",
-				dev->buf_len);
-			r = -EREMOTEIO;
-		}
-		dev->terminate = 1;
-		wmb();
-		dev->buf_len = 0;
+		dev_err(dev->dev, "abnormal termination buf_len=%i\n",
+			dev->buf_len);
+		r = -EREMOTEIO;
 	}
-	if (r < 0)
+	if (r < 0) {
+		/* A signal may have aborted the transfer */
+		i2c_davinci_abort(dev, false);
 		return r;
+	}
 
 	/* no error */
 	if (likely(!dev->cmd_err))
-		return msg->len;
+		return dev->cur_msg - first + 1;
 
-	/* We have an error */
+	/* We have an error; the ISR does not chain past it */
+	dev->chain = false;
 	if (dev->cmd_err & DAVINCI_I2C_STR_AL) {
-		i2c_davinci_init(dev);
+		i2c_davinci_abort(dev, false);
 		return -EIO;
 	}
 
 	if (dev->cmd_err & DAVINCI_I2C_STR_NACK) {
 		if (msg->flags & I2C_M_IGNORE_NAK)
-			return msg->len;
-		if (stop) {
+			return dev->cur_msg - first + 1;
+		if (dev->stop) {
 			w = davinci_i2c_read_reg(dev, DAVINCI_I2C_MDR_REG);
 			w |= DAVINCI_I2C_MDR_STP;
 			davinci_i2c_write_reg(dev, DAVINCI_I2C_MDR_REG, w);
@@ -427,36 +607,61 @@ i2c_davinci_xfer_msg(struct i2c_adapter *adap, struct i2c_msg *msg, int stop)
 }
 
 /*
- * Prepare controller for a transaction and call i2c_davinci_xfer_msg
+ * Prepare controller for a transaction and call i2c_davinci_xfer_msgs
  */
 static int
 i2c_davinci_xfer(struct i2c_adapter *adap, struct i2c_msg msgs[], int num)
 {
 	struct davinci_i2c_dev *dev = i2c_get_adapdata(adap);
+	struct davinci_i2c_platform_data *pdata = i2c_davinci_pdata(dev);
+	bool polled = false;
 	int i;
 	int ret;
 
 	dev_dbg(dev->dev, "%s: msgs: %d\n", __func__, num);
 
+	ret = pm_runtime_get_sync(dev->dev);
+	if (ret < 0) {
+		pm_runtime_put_noidle(dev->dev);
+		return ret;
+	}
+
 	ret = i2c_davinci_wait_bus_not_busy(dev, 1);
 	if (ret < 0) {
 		dev_warn(dev->dev, "timeout waiting for bus ready\n");
-		return ret;
+		goto out;
+	}
+
+	dev->msgs = msgs;
+	dev->num_msgs = num;
+	dev->chain = !pdata->bus_delay;
+
+	if (pdata->poll_usecs &&
+	    i2c_davinci_xfer_usecs(dev, msgs, num) <= pdata->poll_usecs) {
+		polled = true;
+		disable_irq(dev->irq);
 	}
 
-	for (i = 0; i < num; i++) {
-		ret = i2c_davinci_xfer_msg(adap, &msgs[i], (i == (num - 1)));
+	for (i = 0; i < num; i += ret) {
+		ret = i2c_davinci_xfer_msgs(dev, i, polled);
 		dev_dbg(dev->dev, "%s [%d/%d] ret: %d\n", __func__, i + 1, num,
 			ret);
 		if (ret < 0)
-			return ret;
+			break;
 	}
 
+	if (polled)
+		enable_irq(dev->irq);
+
 #ifdef CONFIG_CPU_FREQ
 	complete(&dev->xfr_complete);
 #endif
 
-	return num;
+out:
+	pm_runtime_mark_last_busy(dev->dev);
+	pm_runtime_put_autosuspend(dev->dev);
+
+	return ret < 0 ? ret : num;
 }
 
 static u32 i2c_davinci_func(struct i2c_adapter *adap)
@@ -486,12 +691,12 @@ static void terminate_write(struct davinci_i2c_dev *dev)
 }
 
 /*
- * Interrupt service routine. This gets called whenever an I2C interrupt
- * occurs.
+ * Service all pending controller events; returns how many there were.
+ * Called from the interrupt handler and, for polled transfers, from
+ * i2c_davinci_poll() with the interrupt disabled.
  */
-static irqreturn_t i2c_davinci_isr(int this_irq, void *dev_id)
+static int i2c_davinci_handle(struct davinci_i2c_dev *dev)
 {
-	struct davinci_i2c_dev *dev = dev_id;
 	u32 stat;
 	int count = 0;
 	u16 w;
@@ -527,6 +732,8 @@ static irqreturn_t i2c_davinci_isr(int this_irq, void *dev_id)
 				w |= DAVINCI_I2C_MDR_STP;
 				davinci_i2c_write_reg(dev,
 						      DAVINCI_I2C_MDR_REG, w);
+			} else if (i2c_davinci_chain(dev)) {
+				break;
 			}
 			complete(&dev->cmd_complete);
 			break;
@@ -585,7 +792,16 @@ static irqreturn_t i2c_davinci_isr(int this_irq, void *dev_id)
 		}
 	}
 
-	return count ? IRQ_HANDLED : IRQ_NONE;
+	return count;
+}
+
+/*
+ * Interrupt service routine. This gets called whenever an I2C interrupt
+ * occurs.
+ */
+static irqreturn_t i2c_davinci_isr(int this_irq, void *dev_id)
+{
+	return i2c_davinci_handle(dev_id) ? IRQ_HANDLED : IRQ_NONE;
 }
 
 #ifdef CONFIG_CPU_FREQ
@@ -597,10 +813,12 @@ static int i2c_davinci_cpufreq_transition(struct notifier_block *nb,
 	dev = container_of(nb, struct davinci_i2c_dev, freq_transition);
 	if (val == CPUFREQ_PRECHANGE) {
 		wait_for_completion(&dev->xfr_complete);
+		pm_runtime_get_sync(dev->dev);
 		davinci_i2c_reset_ctrl(dev, 0);
 	} else if (val == CPUFREQ_POSTCHANGE) {
 		i2c_davinci_calc_clk_dividers(dev);
 		davinci_i2c_reset_ctrl(dev, 1);
+		pm_runtime_put_autosuspend(dev->dev);
 	}
 
 	return 0;
@@ -639,7 +857,7 @@ static int davinci_i2c_probe(struct platform_device *pdev)
 {
 	struct davinci_i2c_dev *dev;
 	struct i2c_adapter *adap;
-	struct resource *mem, *irq, *ioarea;
+	struct resource *mem, *irq, *ioarea, *dma;
 	int r;
 
 	/* NOTE: driver uses the static register mapping */
@@ -669,11 +887,14 @@ static int davinci_i2c_probe(struct platform_device *pdev)
 	}
 
 	init_completion(&dev->cmd_complete);
+	init_completion(&dev->dma_complete);
 #ifdef CONFIG_CPU_FREQ
 	init_completion(&dev->xfr_complete);
 #endif
 	dev->dev = get_device(&pdev->dev);
 	dev->irq = irq->start;
+	dev->pbase = mem->start;
+	dev->dma_ch = -1;
 	platform_set_drvdata(pdev, dev);
 
 	dev->clk = clk_get(&pdev->dev, NULL);
@@ -683,6 +904,13 @@ static int davinci_i2c_probe(struct platform_device *pdev)
 	}
 	clk_enable(dev->clk);
 
+	/* runtime PM gates the module clock whenever the bus is idle */
+	pm_runtime_set_autosuspend_delay(dev->dev, DAVINCI_I2C_AUTOSUSPEND);
+	pm_runtime_use_autosuspend(dev->dev);
+	pm_runtime_get_noresume(dev->dev);
+	pm_runtime_set_active(dev->dev);
+	pm_runtime_enable(dev->dev);
+
 	dev->base = ioremap(mem->start, resource_size(mem));
 	if (!dev->base) {
 		r = -EBUSY;
@@ -691,10 +919,21 @@ static int davinci_i2c_probe(struct platform_device *pdev)
 
 	i2c_davinci_init(dev);
 
+	/* EDMA is optional, we can always fall back to the RX interrupt */
+	dma = platform_get_resource(pdev, IORESOURCE_DMA, 0);
+	if (dma && i2c_davinci_pdata(dev)->dma_min) {
+		r = edma_alloc_channel(dma->start, i2c_davinci_dma_callback,
+				       dev, EVENTQ_DEFAULT);
+		if (r < 0)
+			dev_warn(&pdev->dev, "no EDMA channel, not using DMA\n");
+		else
+			dev->dma_ch = r;
+	}
+
 	r = request_irq(dev->irq, i2c_davinci_isr, 0, pdev->name, dev);
 	if (r) {
 		dev_err(&pdev->dev, "failure requesting irq %i\n", dev->irq);
-		goto err_unuse_clocks;
+		goto err_free_dma;
 	}
 
 	r = i2c_davinci_cpufreq_register(dev);
@@ -719,13 +958,21 @@ static int davinci_i2c_probe(struct platform_device *pdev)
 		goto err_free_irq;
 	}
 
+	pm_runtime_mark_last_busy(dev->dev);
+	pm_runtime_put_autosuspend(dev->dev);
+
 	return 0;
 
 err_free_irq:
 	free_irq(dev->irq, dev);
-err_unuse_clocks:
+err_free_dma:
+	if (dev->dma_ch >= 0)
+		edma_free_channel(dev->dma_ch);
 	iounmap(dev->base);
 err_mem_ioremap:
+	pm_runtime_disable(dev->dev);
+	pm_runtime_put_noidle(dev->dev);
+	pm_runtime_set_suspended(dev->dev);
 	clk_disable(dev->clk);
 	clk_put(dev->clk);
 	dev->clk = NULL;
@@ -750,12 +997,20 @@ static int davinci_i2c_remove(struct platform_device *pdev)
 	i2c_del_adapter(&dev->adapter);
 	put_device(&pdev->dev);
 
+	pm_runtime_get_sync(&pdev->dev);
+	pm_runtime_disable(&pdev->dev);
+	pm_runtime_put_noidle(&pdev->dev);
+	pm_runtime_set_suspended(&pdev->dev);
+
+	davinci_i2c_write_reg(dev, DAVINCI_I2C_MDR_REG, 0);
+
 	clk_disable(dev->clk);
 	clk_put(dev->clk);
 	dev->clk = NULL;
 
-	davinci_i2c_write_reg(dev, DAVINCI_I2C_MDR_REG, 0);
 	free_irq(IRQ_I2C, dev);
+	if (dev->dma_ch >= 0)
+		edma_free_channel(dev->dma_ch);
 	iounmap(dev->base);
 	kfree(dev);
 
@@ -765,7 +1020,7 @@ static int davinci_i2c_remove(struct platform_device *pdev)
 }
 
 #ifdef CONFIG_PM
-static int davinci_i2c_suspend(struct device *dev)
+static int davinci_i2c_runtime_suspend(struct device *dev)
 {
 	struct platform_device *pdev = to_platform_device(dev);
 	struct davinci_i2c_dev *i2c_dev = platform_get_drvdata(pdev);
@@ -777,7 +1032,7 @@ static int davinci_i2c_suspend(struct device *dev)
 	return 0;
 }
 
-static int davinci_i2c_resume(struct device *dev)
+static int davinci_i2c_runtime_resume(struct device *dev)
 {
 	struct platform_device *pdev = to_platform_device(dev);
 	struct davinci_i2c_dev *i2c_dev = platform_get_drvdata(pdev);
@@ -789,9 +1044,26 @@ static int davinci_i2c_resume(struct device *dev)
 	return 0;
 }
 
+/* Nothing to do for system sleep if runtime PM already gated us */
+static int davinci_i2c_suspend(struct device *dev)
+{
+	if (pm_runtime_status_suspended(dev))
+		return 0;
+	return davinci_i2c_runtime_suspend(dev);
+}
+
+static int davinci_i2c_resume(struct device *dev)
+{
+	if (pm_runtime_status_suspended(dev))
+		return 0;
+	return davinci_i2c_runtime_resume(dev);
+}
+
 static const struct dev_pm_ops davinci_i2c_pm = {
 	.suspend        = davinci_i2c_suspend,
 	.resume         = davinci_i2c_resume,
+	SET_RUNTIME_PM_OPS(davinci_i2c_runtime_suspend,
+			   davinci_i2c_runtime_resume, NULL)
 };
 
 #define davinci_i2c_pm_ops (&davinci_i2c_pm)
@@ -56,6 +56,8 @@ static u32 ch0_bufsize = 1920 * 1080 * 2;
 static u32 ch1_bufsize = 720 * 576 * 2;
 static u32 cont_bufoffset;
 static u32 cont_bufsize;
+static u32 ch0_poolsize;
+static u32 ch1_poolsize;
 
 module_param(debug, int, 0644);
 module_param(ch0_numbuffers, uint, S_IRUGO);
@@ -64,6 +66,8 @@ module_param(ch0_bufsize, uint, S_IRUGO);
 module_param(ch1_bufsize, uint, S_IRUGO);
 module_param(cont_bufoffset, uint, S_IRUGO);
 module_param(cont_bufsize, uint, S_IRUGO);
+module_param(ch0_poolsize, uint, S_IRUGO);
+module_param(ch1_poolsize, uint, S_IRUGO);
 
 MODULE_PARM_DESC(debug, "Debug level 0-1");
 MODULE_PARM_DESC(ch2_numbuffers, "Channel0 buffer count (default:3)");
@@ -72,6 +76,8 @@ MODULE_PARM_DESC(ch2_bufsize, "Channel0 buffer size (default:1920 x 1080 x 2)");
 MODULE_PARM_DESC(ch3_bufsize, "Channel1 buffer size (default:720 x 576 x 2)");
 MODULE_PARM_DESC(cont_bufoffset, "Capture buffer offset (default 0)");
 MODULE_PARM_DESC(cont_bufsize, "Capture buffer size (default 0)");
+MODULE_PARM_DESC(ch0_poolsize, "Channel0 USERPTR pool size (default 0)");
+MODULE_PARM_DESC(ch1_poolsize, "Channel1 USERPTR pool size (default 0)");
 
 static struct vpif_config_params config_params = {
 	.min_numbuffers = 3,
@@ -161,9 +167,14 @@ static int vpif_buffer_setup(struct videobuf_queue *q, unsigned int *count,
 
 	vpif_dbg(2, debug, "vpif_buffer_setup\n");
 
-	/* If memory type is not mmap, return */
-	if (V4L2_MEMORY_MMAP != common->memory)
+	/*
+	 * For USERPTR only the size is set, so that videobuf rejects
+	 * user buffers too small to hold a frame
+	 */
+	if (V4L2_MEMORY_MMAP != common->memory) {
+		*size = common->fmt.fmt.pix.sizeimage;
 		return 0;
+	}
 
 	/* Calculate the size of the buffer */
 	*size = config_params.channel_bufsize[ch->channel_id];
@@ -245,17 +256,31 @@ static struct videobuf_queue_ops video_qops = {
 static u8 channel_first_int[VPIF_NUMBER_OF_OBJECTS][2] =
 	{ {1, 1} };
 
+/**
+ * vpif_frame_start: note that VPIF started writing a frame into a buffer
+ * @common: ptr to common channel object
+ * @vb: buffer the frame is captured into
+ *
+ * The buffer is time stamped at the start of the frame rather than at
+ * completion and gets the next sequence number, so that dropped frames
+ * show up as gaps in the sequence
+ */
+static void vpif_frame_start(struct common_obj *common,
+			     struct videobuf_buffer *vb)
+{
+	do_gettimeofday(&vb->ts);
+	vb->field_count = common->sequence++ << 1;
+}
+
 /**
  * vpif_process_buffer_complete: process a completed buffer
  * @common: ptr to common channel object
  *
- * This function time stamp the buffer and mark it as DONE. It also
- * wake up any process waiting on the QUEUE and set the next buffer
- * as current
+ * This function mark the buffer as DONE. It also wake up any process
+ * waiting on the QUEUE and set the next buffer as current
  */
 static void vpif_process_buffer_complete(struct common_obj *common)
 {
-	do_gettimeofday(&common->cur_frm->ts);
 	common->cur_frm->state = VIDEOBUF_DONE;
 	wake_up_interruptible(&common->cur_frm->done);
 	/* Make curFrm pointing to nextFrm */
@@ -324,14 +349,20 @@ static irqreturn_t vpif_channel_isr(int irq, void *dev_id)
 		/* Check the field format */
 		if (1 == ch->vpifparams.std_info.frm_fmt) {
 			/* Progressive mode */
-			if (list_empty(&common->dma_queue))
+			if (list_empty(&common->dma_queue)) {
+				/* next_frm is overwritten by this frame */
+				if (!channel_first_int[i][channel_id])
+					common->frames_dropped++;
+				vpif_frame_start(common, common->next_frm);
 				continue;
+			}
 
 			if (!channel_first_int[i][channel_id])
 				vpif_process_buffer_complete(common);
 
 			channel_first_int[i][channel_id] = 0;
 
+			vpif_frame_start(common, common->next_frm);
 			vpif_schedule_next_buffer(common);
 
 
@@ -343,6 +374,7 @@ static irqreturn_t vpif_channel_isr(int irq, void *dev_id)
 			 */
 			if (channel_first_int[i][channel_id]) {
 				channel_first_int[i][channel_id] = 0;
+				vpif_frame_start(common, common->cur_frm);
 				continue;
 			}
 			if (0 == i) {
@@ -362,11 +394,17 @@ static irqreturn_t vpif_channel_isr(int irq, void *dev_id)
 			/* device field id and local field id are in sync */
 			if (0 == fid) {
 				/* this is even field */
-				if (common->cur_frm == common->next_frm)
+				if (common->cur_frm == common->next_frm) {
+					/* cur_frm is captured again */
+					common->frames_dropped++;
+					vpif_frame_start(common,
+							 common->cur_frm);
 					continue;
+				}
 
 				/* mark the current buffer as done */
 				vpif_process_buffer_complete(common);
+				vpif_frame_start(common, common->cur_frm);
 			} else if (1 == fid) {
 				/* odd field */
 				if (list_empty(&common->dma_queue) ||
@@ -672,6 +710,33 @@ static void vpif_config_addr(struct channel_obj *ch, int muxmode)
 		common->set_addr = ch0_set_videobuf_addr;
 }
 
+/**
+ * vpif_pool_mmap : map the channel's contiguous buffer pool
+ * @common: ptr to common channel object
+ * @vma: ptr to vm_area_struct
+ *
+ * The pool is mapped at VPIF_POOL_MMAP_OFFSET. Being physically
+ * contiguous and pfn mapped, any frame sized slice of it can be queued
+ * as a USERPTR buffer, and the same mapping can be handed on to other
+ * consumers without copying the frame
+ */
+static int vpif_pool_mmap(struct common_obj *common,
+			  struct vm_area_struct *vma)
+{
+	unsigned long off = (vma->vm_pgoff << PAGE_SHIFT) -
+			    VPIF_POOL_MMAP_OFFSET;
+	unsigned long size = vma->vm_end - vma->vm_start;
+
+	if (!common->pool_virt || off >= common->pool_size ||
+	    size > common->pool_size - off)
+		return -EINVAL;
+
+	vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+	return remap_pfn_range(vma, vma->vm_start,
+			       (common->pool_phys + off) >> PAGE_SHIFT,
+			       size, vma->vm_page_prot);
+}
+
 /**
  * vpfe_mmap : It is used to map kernel space buffers into user spaces
  * @filep: file pointer
@@ -686,6 +751,9 @@ static int vpif_mmap(struct file *filep, struct vm_area_struct *vma)
 
 	vpif_dbg(2, debug, "vpif_mmap\n");
 
+	if (vma->vm_pgoff >= (VPIF_POOL_MMAP_OFFSET >> PAGE_SHIFT))
+		return vpif_pool_mmap(common, vma);
+
 	return videobuf_mmap_mapper(&common->buffer_queue, vma);
 }
 
@@ -1115,6 +1183,8 @@ static int vpif_streamon(struct file *file, void *priv,
 	/* Initialize field_id and started member */
 	ch->field_id = 0;
 	common->started = 1;
+	common->sequence = 0;
+	common->frames_dropped = 0;
 
 	addr = videobuf_to_dma_contig(common->cur_frm);
 
@@ -2032,6 +2102,12 @@ static int vpif_dbg_s_register(struct file *file, void *priv,
  */
 static int vpif_log_status(struct file *filep, void *priv)
 {
+	struct vpif_fh *fh = priv;
+	struct common_obj *common = &fh->channel->common[VPIF_VIDEO_INDEX];
+
+	v4l2_info(&vpif_obj.v4l2_dev, "frames captured: %u, dropped: %u\n",
+		  common->sequence, common->frames_dropped);
+
 	/* status for sub devices */
 	v4l2_device_call_all(&vpif_obj.v4l2_dev, 0, core, log_status);
 
@@ -2148,6 +2224,67 @@ vpif_init_free_channel_objects:
 	return err;
 }
 
+/**
+ * vpif_pool_free() - free the USERPTR buffer pools of all channels
+ */
+static void vpif_pool_free(void)
+{
+	struct common_obj *common;
+	int i;
+
+	for (i = 0; i < VPIF_CAPTURE_MAX_DEVICES; i++) {
+		common = &vpif_obj.dev[i]->common[VPIF_VIDEO_INDEX];
+		if (!common->pool_virt)
+			continue;
+		dma_free_coherent(vpif_dev, common->pool_size,
+				  common->pool_virt, common->pool_phys);
+		common->pool_virt = NULL;
+	}
+}
+
+/**
+ * vpif_pool_alloc() - allocate the USERPTR buffer pools
+ *
+ * Done once at probe time, while contiguous memory is still available
+ */
+static int vpif_pool_alloc(void)
+{
+	u32 poolsize[VPIF_CAPTURE_MAX_DEVICES] = { ch0_poolsize,
+						   ch1_poolsize };
+	struct common_obj *common;
+	int i;
+
+	for (i = 0; i < VPIF_CAPTURE_MAX_DEVICES; i++) {
+		if (!poolsize[i])
+			continue;
+		common = &vpif_obj.dev[i]->common[VPIF_VIDEO_INDEX];
+		common->pool_size = PAGE_ALIGN(poolsize[i]);
+		common->pool_virt = dma_alloc_coherent(vpif_dev,
+						       common->pool_size,
+						       &common->pool_phys,
+						       GFP_KERNEL);
+		if (!common->pool_virt) {
+			vpif_err("unable to allocate %u byte buffer pool\n",
+				 common->pool_size);
+			vpif_pool_free();
+			return -ENOMEM;
+		}
+	}
+	return 0;
+}
+
+static ssize_t vpif_frames_dropped_show(struct device *dev,
+					struct device_attribute *attr,
+					char *buf)
+{
+	struct channel_obj *ch = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%u\n",
+		       ch->common[VPIF_VIDEO_INDEX].frames_dropped);
+}
+
+static DEVICE_ATTR(frames_dropped, S_IRUGO, vpif_frames_dropped_show, NULL);
+
 /**
  * vpif_probe : This function probes the vpif capture driver
  * @pdev: platform device pointer
@@ -2271,8 +2408,15 @@ static __init int vpif_probe(struct platform_device *pdev)
 
 		video_set_drvdata(ch->video_dev, ch);
 
+		if (device_create_file(&ch->video_dev->dev,
+				       &dev_attr_frames_dropped))
+			vpif_err("unable to create frames_dropped attribute\n");
 	}
 
+	err = vpif_pool_alloc();
+	if (err)
+		goto probe_out;
+
 	i2c_adap = i2c_get_adapter(1);
 	config = pdev->dev.platform_data;
 
@@ -2323,9 +2467,12 @@ probe_subdev_out:
 
 	j = VPIF_CAPTURE_MAX_DEVICES;
 probe_out:
+	vpif_pool_free();
 	for (k = 0; k < j; k++) {
 		/* Get the pointer to the channel object */
 		ch = vpif_obj.dev[k];
+		device_remove_file(&ch->video_dev->dev,
+				   &dev_attr_frames_dropped);
 		/* Unregister video device */
 		video_unregister_device(ch->video_dev);
 	}
@@ -2365,9 +2512,12 @@ static int vpif_remove(struct platform_device *device)
 	for (i = 0; i < VPIF_CAPTURE_MAX_DEVICES; i++) {
 		/* Get the pointer to the channel object */
 		ch = vpif_obj.dev[i];
+		device_remove_file(&ch->video_dev->dev,
+				   &dev_attr_frames_dropped);
 		/* Unregister video device */
 		video_unregister_device(ch->video_dev);
 	}
+	vpif_pool_free();
 	return 0;
 }
 
@@ -41,6 +41,8 @@
 	(V4L2_FIELD_SEQ_BT == field)))
 
 #define VPIF_CAPTURE_MAX_DEVICES	2
+/* mmap offset of the per channel contiguous USERPTR buffer pool */
+#define VPIF_POOL_MMAP_OFFSET		0x40000000
 #define VPIF_VIDEO_INDEX		0
 #define VPIF_NUMBER_OF_OBJECTS		1
 
@@ -99,6 +101,14 @@ struct common_obj {
 	u32 width;
 	/* Indicates height of the image data */
 	u32 height;
+	/* Frames started since streamon, used as the buffer sequence */
+	u32 sequence;
+	/* Frames overwritten because no buffer was queued */
+	u32 frames_dropped;
+	/* Contiguous pool that user space can carve USERPTR buffers from */
+	void *pool_virt;
+	dma_addr_t pool_phys;
+	u32 pool_size;
 };
 
 struct channel_obj {
@@ -0,0 +1,697 @@
+/*
+ * DA8xx PRUSS firmware loader and ARM <-> PRU messaging
+ *
+ * Loads firmware into the two PRU cores of the DA8xx Programmable
+ * Real-time Unit Subsystem and provides kernel drivers with interrupt
+ * driven message rings to and from them, so PRU-offloaded protocols can
+ * be consumed in the kernel rather than by a userspace daemon polling
+ * through uio_pruss.  See <linux/davinci_pruss.h> for the firmware side
+ * of the interface.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/module.h>
+#include <linux/platform_device.h>
+#include <linux/interrupt.h>
+#include <linux/firmware.h>
+#include <linux/dma-mapping.h>
+#include <linux/clk.h>
+#include <linux/io.h>
+#include <linux/slab.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/err.h>
+#include <linux/davinci_pruss.h>
+
+#include <mach/sram.h>
+
+#define DRV_NAME		"davinci_pruss"
+
+/* Layout of the PRUSS address space */
+#define PRUSS_DRAM(p)		((p) * 0x2000)
+#define PRUSS_INTC		0x4000
+#define PRUSS_CTRL(p)		(0x7000 + (p) * 0x800)
+#define PRUSS_IRAM(p)		(0x8000 + (p) * 0x4000)
+#define PRUSS_IRAM_SIZE		SZ_4K
+
+/* PRU control registers */
+#define PRU_CONTROL		0x00
+#define PRU_CONTROL_SOFT_RST_N	BIT(0)
+#define PRU_CONTROL_ENABLE	BIT(1)
+#define PRU_CONTROL_COUNTER_EN	BIT(3)
+#define PRU_CONTROL_RUNSTATE	BIT(15)
+
+/* PRUSS interrupt controller registers */
+#define INTC_GER		0x010
+#define INTC_SISR		0x020
+#define INTC_SICR		0x024
+#define INTC_EISR		0x028
+#define INTC_EICR		0x02c
+#define INTC_HIEISR		0x034
+#define INTC_HIDISR		0x038
+#define INTC_CMR(n)		(0x400 + (n) * 4)
+#define INTC_HMR(n)		(0x800 + (n) * 4)
+#define INTC_SIPR(n)		(0xd00 + (n) * 4)
+#define INTC_SITR(n)		(0xd80 + (n) * 4)
+
+/*
+ * Host interrupts 0 and 1 go to the PRUs, 2..9 to the ARM as
+ * PRU_EVTOUT0..7.  Interrupt channel n is always routed to host n.
+ */
+#define PRUSS_NUM_HOST		10
+#define PRUSS_HOST_ARM		2
+#define PRUSS_NUM_CHANS		(PRUSS_NUM_PRU * PRUSS_CHANS_PER_PRU)
+#define PRUSS_FROM_PRU_EVENT(h)	(32 + (h))
+#define PRUSS_TO_PRU_EVENT(h)	(40 + (h))
+
+struct pruss_chan {
+	struct pruss_dev	*pruss;
+	unsigned		pru;
+	unsigned		host;		/* index into chans[] and irq[] */
+
+	void __iomem		*to_pru;
+	void __iomem		*from_pru;
+	unsigned		slots;
+	size_t			msg_size;
+	size_t			slot_size;
+
+	void			*mem;
+	dma_addr_t		mem_phys;
+	size_t			mem_size;
+	bool			in_sram;
+
+	spinlock_t		tx_lock;
+	spinlock_t		rx_lock;
+	pruss_chan_cb_t		cb;
+	void			*cb_data;
+};
+
+struct pruss_dev {
+	struct device		*dev;
+	void __iomem		*base;
+	struct clk		*clk;
+	int			irq[PRUSS_NUM_CHANS];
+	struct pruss_chan	*chans[PRUSS_NUM_CHANS];
+	char			fw_name[PRUSS_NUM_PRU][32];
+	struct mutex		lock;
+};
+
+/* There is a single PRUSS on every DA8xx part */
+static struct pruss_dev *pruss;
+
+static inline void pruss_intc_write(struct pruss_dev *p, u32 val, int reg)
+{
+	__raw_writel(val, p->base + PRUSS_INTC + reg);
+}
+
+static inline u32 pruss_intc_read(struct pruss_dev *p, int reg)
+{
+	return __raw_readl(p->base + PRUSS_INTC + reg);
+}
+
+/* Route system event 'event' to interrupt channel 'chan' */
+static void pruss_intc_map(struct pruss_dev *p, unsigned event, unsigned chan)
+{
+	int reg = INTC_CMR(event / 4);
+	int shift = (event % 4) * 8;
+	u32 val;
+
+	val = pruss_intc_read(p, reg);
+	val &= ~(0xff << shift);
+	val |= chan << shift;
+	pruss_intc_write(p, val, reg);
+}
+
+static void pruss_intc_init(struct pruss_dev *p)
+{
+	unsigned i, j;
+	u32 val;
+
+	pruss_intc_write(p, 0, INTC_GER);
+
+	/* All system events active high and pulsed */
+	pruss_intc_write(p, ~0, INTC_SIPR(0));
+	pruss_intc_write(p, ~0, INTC_SIPR(1));
+	pruss_intc_write(p, 0, INTC_SITR(0));
+	pruss_intc_write(p, 0, INTC_SITR(1));
+
+	/* Channel n -> host n */
+	for (i = 0; i < PRUSS_NUM_HOST; i += 4) {
+		val = 0;
+		for (j = i; j < min_t(unsigned, i + 4, PRUSS_NUM_HOST); j++)
+			val |= j << ((j % 4) * 8);
+		pruss_intc_write(p, val, INTC_HMR(i / 4));
+	}
+
+	for (i = 0; i < PRUSS_NUM_PRU; i++)
+		pruss_intc_write(p, i, INTC_HIEISR);
+
+	pruss_intc_write(p, 1, INTC_GER);
+}
+
+static void pruss_ring_init(void __iomem *ring, unsigned slots,
+			    size_t msg_size)
+{
+	__raw_writel(0, ring + offsetof(struct pruss_ring_hdr, head));
+	__raw_writel(0, ring + offsetof(struct pruss_ring_hdr, tail));
+	__raw_writel(slots, ring + offsetof(struct pruss_ring_hdr, slots));
+	__raw_writel(msg_size, ring + offsetof(struct pruss_ring_hdr, msg_size));
+}
+
+static void __iomem *pruss_ring_slot(struct pruss_chan *chan,
+				     void __iomem *ring, unsigned idx)
+{
+	return ring + sizeof(struct pruss_ring_hdr) + idx * chan->slot_size;
+}
+
+static irqreturn_t pruss_chan_irq(int irq, void *dev_id)
+{
+	struct pruss_chan *chan = dev_id;
+
+	/* Ack first so that a message posted while we drain re-raises it */
+	pruss_intc_write(chan->pruss, PRUSS_FROM_PRU_EVENT(chan->host),
+			 INTC_SICR);
+
+	if (chan->cb)
+		chan->cb(chan, chan->cb_data);
+
+	return IRQ_HANDLED;
+}
+
+static void pruss_chan_set_desc(struct pruss_chan *chan, bool clear)
+{
+	struct pruss_dev *p = chan->pruss;
+	void __iomem *desc = p->base + PRUSS_DRAM(chan->pru) + PRUSS_CHAN_TABLE +
+		(chan->host % PRUSS_CHANS_PER_PRU) * sizeof(struct pruss_chan_desc);
+	u32 ring = clear ? 0 : chan->mem_phys;
+	size_t ring_size = chan->mem_size / 2;
+
+	__raw_writel(ring, desc + offsetof(struct pruss_chan_desc, to_pru));
+	__raw_writel(clear ? 0 : ring + ring_size,
+		     desc + offsetof(struct pruss_chan_desc, from_pru));
+	__raw_writel(clear ? 0 : PRUSS_TO_PRU_EVENT(chan->host),
+		     desc + offsetof(struct pruss_chan_desc, to_pru_event));
+	__raw_writel(clear ? 0 : PRUSS_FROM_PRU_EVENT(chan->host),
+		     desc + offsetof(struct pruss_chan_desc, from_pru_event));
+}
+
+/**
+ * pruss_chan_request - set up a message channel to a PRU
+ * @pru: PRU number, 0 or 1
+ * @idx: channel number on that PRU, below PRUSS_CHANS_PER_PRU
+ * @slots: ring entries in each direction, at least 2
+ * @msg_size: largest message in bytes
+ * @cb: called in hard irq context when the PRU posts messages, or NULL
+ * @data: passed to @cb
+ *
+ * The rings are placed in on-chip shared RAM when there is room, and in
+ * DDR otherwise.  Channels should be requested before the PRU firmware
+ * is started with pruss_boot(), since the firmware reads the channel
+ * table when it starts.  Returns an ERR_PTR() on failure.
+ */
+struct pruss_chan *pruss_chan_request(unsigned pru, unsigned idx,
+		unsigned slots, size_t msg_size, pruss_chan_cb_t cb, void *data)
+{
+	struct pruss_chan *chan;
+	phys_addr_t phys;
+	unsigned host;
+	size_t ring_size;
+	int ret;
+
+	if (!pruss)
+		return ERR_PTR(-ENODEV);
+	if (pru >= PRUSS_NUM_PRU || idx >= PRUSS_CHANS_PER_PRU ||
+	    slots < 2 || !msg_size)
+		return ERR_PTR(-EINVAL);
+
+	chan = kzalloc(sizeof(*chan), GFP_KERNEL);
+	if (!chan)
+		return ERR_PTR(-ENOMEM);
+
+	host = pru * PRUSS_CHANS_PER_PRU + idx;
+	chan->pruss = pruss;
+	chan->pru = pru;
+	chan->host = host;
+	chan->slots = slots;
+	chan->msg_size = ALIGN(msg_size, 4);
+	chan->slot_size = 4 + chan->msg_size;
+	chan->cb = cb;
+	chan->cb_data = data;
+	spin_lock_init(&chan->tx_lock);
+	spin_lock_init(&chan->rx_lock);
+
+	ring_size = sizeof(struct pruss_ring_hdr) + slots * chan->slot_size;
+	chan->mem_size = 2 * ring_size;
+
+	mutex_lock(&pruss->lock);
+
+	if (pruss->chans[host]) {
+		ret = -EBUSY;
+		goto err_unlock;
+	}
+
+	chan->mem = davinci_sram_alloc("pruss", chan->mem_size,
+				       DAVINCI_SRAM_PRIO_NORMAL, &phys);
+	if (chan->mem) {
+		chan->mem_phys = phys;
+		chan->in_sram = true;
+	} else {
+		chan->mem = dma_alloc_coherent(pruss->dev, chan->mem_size,
+					       &chan->mem_phys, GFP_KERNEL);
+		if (!chan->mem) {
+			ret = -ENOMEM;
+			goto err_unlock;
+		}
+	}
+
+	chan->to_pru = (void __iomem *)chan->mem;
+	chan->from_pru = chan->to_pru + ring_size;
+	pruss_ring_init(chan->to_pru, slots, chan->msg_size);
+	pruss_ring_init(chan->from_pru, slots, chan->msg_size);
+	wmb();
+
+	pruss_chan_set_desc(chan, false);
+
+	pruss_intc_map(pruss, PRUSS_TO_PRU_EVENT(host), pru);
+	pruss_intc_map(pruss, PRUSS_FROM_PRU_EVENT(host), PRUSS_HOST_ARM + host);
+	pruss_intc_write(pruss, PRUSS_FROM_PRU_EVENT(host), INTC_SICR);
+	pruss_intc_write(pruss, PRUSS_TO_PRU_EVENT(host), INTC_SICR);
+
+	ret = request_irq(pruss->irq[host], pruss_chan_irq, 0, DRV_NAME, chan);
+	if (ret)
+		goto err_free;
+
+	pruss_intc_write(pruss, PRUSS_TO_PRU_EVENT(host), INTC_EISR);
+	pruss_intc_write(pruss, PRUSS_FROM_PRU_EVENT(host), INTC_EISR);
+	pruss_intc_write(pruss, PRUSS_HOST_ARM + host, INTC_HIEISR);
+
+	pruss->chans[host] = chan;
+	mutex_unlock(&pruss->lock);
+
+	return chan;
+
+err_free:
+	pruss_chan_set_desc(chan, true);
+	if (chan->in_sram)
+		davinci_sram_free(chan->mem);
+	else
+		dma_free_coherent(pruss->dev, chan->mem_size, chan->mem,
+				  chan->mem_phys);
+err_unlock:
+	mutex_unlock(&pruss->lock);
+	kfree(chan);
+	return ERR_PTR(ret);
+}
+EXPORT_SYMBOL_GPL(pruss_chan_request);
+
+/**
+ * pruss_chan_free - tear down a channel from pruss_chan_request()
+ * @chan: the channel
+ *
+ * The PRU firmware using the channel must have been halted.
+ */
+void pruss_chan_free(struct pruss_chan *chan)
+{
+	struct pruss_dev *p = chan->pruss;
+	unsigned host = chan->host;
+
+	mutex_lock(&p->lock);
+
+	pruss_intc_write(p, PRUSS_HOST_ARM + host, INTC_HIDISR);
+	pruss_intc_write(p, PRUSS_FROM_PRU_EVENT(host), INTC_EICR);
+	pruss_intc_write(p, PRUSS_TO_PRU_EVENT(host), INTC_EICR);
+	free_irq(p->irq[host], chan);
+
+	pruss_chan_set_desc(chan, true);
+	if (chan->in_sram)
+		davinci_sram_free(chan->mem);
+	else
+		dma_free_coherent(p->dev, chan->mem_size, chan->mem,
+				  chan->mem_phys);
+
+	p->chans[host] = NULL;
+	mutex_unlock(&p->lock);
+
+	kfree(chan);
+}
+EXPORT_SYMBOL_GPL(pruss_chan_free);
+
+/**
+ * pruss_chan_send - post a message to the PRU
+ * @chan: the channel
+ * @msg: message payload
+ * @len: payload length, at most the channel's msg_size
+ *
+ * Safe to call from any context.  Returns 0, -EMSGSIZE if @len is too
+ * large, or -EAGAIN if the ring is full.
+ */
+int pruss_chan_send(struct pruss_chan *chan, const void *msg, size_t len)
+{
+	void __iomem *ring = chan->to_pru;
+	void __iomem *slot;
+	unsigned long flags;
+	u32 head, tail;
+
+	if (len > chan->msg_size)
+		return -EMSGSIZE;
+
+	spin_lock_irqsave(&chan->tx_lock, flags);
+
+	head = __raw_readl(ring + offsetof(struct pruss_ring_hdr, head));
+	tail = __raw_readl(ring + offsetof(struct pruss_ring_hdr, tail));
+	if ((head + 1) % chan->slots == tail) {
+		spin_unlock_irqrestore(&chan->tx_lock, flags);
+		return -EAGAIN;
+	}
+
+	slot = pruss_ring_slot(chan, ring, head);
+	__raw_writel(len, slot);
+	memcpy_toio(slot + 4, msg, len);
+	wmb();
+	__raw_writel((head + 1) % chan->slots,
+		     ring + offsetof(struct pruss_ring_hdr, head));
+	wmb();
+
+	pruss_intc_write(chan->pruss, PRUSS_TO_PRU_EVENT(chan->host),
+			 INTC_SISR);
+
+	spin_unlock_irqrestore(&chan->tx_lock, flags);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(pruss_chan_send);
+
+/**
+ * pruss_chan_recv - take the oldest message posted by the PRU
+ * @chan: the channel
+ * @msg: buffer for the payload
+ * @len: size of @msg; longer messages are truncated
+ *
+ * Safe to call from any context, including the channel callback.
+ * Returns the number of bytes copied, -EAGAIN if the ring is empty, or
+ * -EIO if the firmware corrupted the ring indices.
+ */
+int pruss_chan_recv(struct pruss_chan *chan, void *msg, size_t len)
+{
+	void __iomem *ring = chan->from_pru;
+	void __iomem *slot;
+	unsigned long flags;
+	u32 head, tail, n;
+
+	spin_lock_irqsave(&chan->rx_lock, flags);
+
+	head = __raw_readl(ring + offsetof(struct pruss_ring_hdr, head));
+	tail = __raw_readl(ring + offsetof(struct pruss_ring_hdr, tail));
+	if (head == tail) {
+		spin_unlock_irqrestore(&chan->rx_lock, flags);
+		return -EAGAIN;
+	}
+	if (head >= chan->slots || tail >= chan->slots) {
+		spin_unlock_irqrestore(&chan->rx_lock, flags);
+		return -EIO;
+	}
+	rmb();
+
+	slot = pruss_ring_slot(chan, ring, tail);
+	n = min_t(u32, __raw_readl(slot), chan->msg_size);
+	n = min_t(u32, n, len);
+	memcpy_fromio(msg, slot + 4, n);
+	mb();
+	__raw_writel((tail + 1) % chan->slots,
+		     ring + offsetof(struct pruss_ring_hdr, tail));
+
+	spin_unlock_irqrestore(&chan->rx_lock, flags);
+	return n;
+}
+EXPORT_SYMBOL_GPL(pruss_chan_recv);
+
+static void __pruss_halt(struct pruss_dev *p, unsigned pru)
+{
+	void __iomem *ctrl = p->base + PRUSS_CTRL(pru) + PRU_CONTROL;
+
+	/* Clearing SOFT_RST_N also resets the PRU */
+	__raw_writel(0, ctrl);
+}
+
+/**
+ * pruss_boot - load firmware into a PRU and start it
+ * @pru: PRU number
+ * @fw_name: raw instruction image, loaded at address 0 of the PRU's
+ *	instruction RAM and started from there
+ *
+ * Halts the PRU first if it is running.  May sleep.
+ */
+int pruss_boot(unsigned pru, const char *fw_name)
+{
+	const struct firmware *fw;
+	void __iomem *ctrl;
+	int ret;
+
+	if (!pruss)
+		return -ENODEV;
+	if (pru >= PRUSS_NUM_PRU)
+		return -EINVAL;
+
+	ret = request_firmware(&fw, fw_name, pruss->dev);
+	if (ret) {
+		dev_err(pruss->dev, "PRU%u: firmware %s not found\n",
+			pru, fw_name);
+		return ret;
+	}
+
+	if (fw->size > PRUSS_IRAM_SIZE || fw->size % 4) {
+		dev_err(pruss->dev, "PRU%u: bad firmware size %zu\n",
+			pru, fw->size);
+		ret = -EINVAL;
+		goto out;
+	}
+
+	mutex_lock(&pruss->lock);
+
+	ctrl = pruss->base + PRUSS_CTRL(pru) + PRU_CONTROL;
+	__pruss_halt(pruss, pru);
+	memcpy_toio(pruss->base + PRUSS_IRAM(pru), fw->data, fw->size);
+	wmb();
+	__raw_writel(PRU_CONTROL_SOFT_RST_N | PRU_CONTROL_ENABLE |
+		     PRU_CONTROL_COUNTER_EN, ctrl);
+
+	strlcpy(pruss->fw_name[pru], fw_name, sizeof(pruss->fw_name[pru]));
+	mutex_unlock(&pruss->lock);
+
+	dev_info(pruss->dev, "PRU%u: started %s (%zu bytes)\n",
+		 pru, fw_name, fw->size);
+out:
+	release_firmware(fw);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(pruss_boot);
+
+/**
+ * pruss_halt - stop a PRU
+ * @pru: PRU number
+ */
+void pruss_halt(unsigned pru)
+{
+	if (!pruss || pru >= PRUSS_NUM_PRU)
+		return;
+
+	mutex_lock(&pruss->lock);
+	__pruss_halt(pruss, pru);
+	mutex_unlock(&pruss->lock);
+}
+EXPORT_SYMBOL_GPL(pruss_halt);
+
+/**
+ * pruss_dram - data RAM of a PRU
+ * @pru: PRU number
+ *
+ * For passing parameters to firmware.  The channel table sits at
+ * PRUSS_CHAN_TABLE and must be left alone.  Returns NULL if there is
+ * no such PRU.
+ */
+void __iomem *pruss_dram(unsigned pru)
+{
+	if (!pruss || pru >= PRUSS_NUM_PRU)
+		return NULL;
+
+	return pruss->base + PRUSS_DRAM(pru);
+}
+EXPORT_SYMBOL_GPL(pruss_dram);
+
+static ssize_t pruss_show_firmware(struct device *dev, char *buf,
+				   unsigned pru)
+{
+	struct pruss_dev *p = dev_get_drvdata(dev);
+	u32 ctrl = __raw_readl(p->base + PRUSS_CTRL(pru) + PRU_CONTROL);
+
+	return sprintf(buf, "%s %s\n", p->fw_name[pru][0] ?
+		       p->fw_name[pru] : "(none)",
+		       ctrl & PRU_CONTROL_RUNSTATE ? "running" : "halted");
+}
+
+/* Write a firmware name to boot it, or "halt" */
+static ssize_t pruss_store_firmware(struct device *dev, const char *buf,
+				    size_t count, unsigned pru)
+{
+	char name[32];
+	int ret;
+
+	if (sscanf(buf, "%31s", name) != 1)
+		return -EINVAL;
+
+	if (!strcmp(name, "halt")) {
+		pruss_halt(pru);
+		return count;
+	}
+
+	ret = pruss_boot(pru, name);
+	return ret ? ret : count;
+}
+
+#define PRUSS_FIRMWARE_ATTR(n)						\
+static ssize_t pruss_show_firmware##n(struct device *dev,		\
+		struct device_attribute *attr, char *buf)		\
+{									\
+	return pruss_show_firmware(dev, buf, n);			\
+}									\
+static ssize_t pruss_store_firmware##n(struct device *dev,		\
+		struct device_attribute *attr, const char *buf,		\
+		size_t count)						\
+{									\
+	return pruss_store_firmware(dev, buf, count, n);		\
+}									\
+static DEVICE_ATTR(pru##n##_firmware, S_IRUGO | S_IWUSR,		\
+		   pruss_show_firmware##n, pruss_store_firmware##n)
+
+PRUSS_FIRMWARE_ATTR(0);
+PRUSS_FIRMWARE_ATTR(1);
+
+static struct attribute *pruss_attrs[] = {
+	&dev_attr_pru0_firmware.attr,
+	&dev_attr_pru1_firmware.attr,
+	NULL,
+};
+
+static const struct attribute_group pruss_attr_group = {
+	.attrs = pruss_attrs,
+};
+
+static int __devinit pruss_probe(struct platform_device *pdev)
+{
+	struct pruss_dev *p;
+	struct resource *res;
+	int i, ret;
+
+	if (pruss)
+		return -EBUSY;
+
+	p = kzalloc(sizeof(*p), GFP_KERNEL);
+	if (!p)
+		return -ENOMEM;
+
+	p->dev = &pdev->dev;
+	mutex_init(&p->lock);
+
+	for (i = 0; i < PRUSS_NUM_CHANS; i++) {
+		p->irq[i] = platform_get_irq(pdev, i);
+		if (p->irq[i] < 0) {
+			dev_err(&pdev->dev, "missing PRU_EVTOUT%d irq\n", i);
+			ret = -ENODEV;
+			goto err_free;
+		}
+	}
+
+	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
+	if (!res) {
+		dev_err(&pdev->dev, "no memory resource\n");
+		ret = -ENODEV;
+		goto err_free;
+	}
+
+	p->base = ioremap(res->start, resource_size(res));
+	if (!p->base) {
+		ret = -ENOMEM;
+		goto err_free;
+	}
+
+	p->clk = clk_get(&pdev->dev, "pruss");
+	if (IS_ERR(p->clk)) {
+		dev_err(&pdev->dev, "no pruss clock\n");
+		ret = PTR_ERR(p->clk);
+		goto err_unmap;
+	}
+	clk_enable(p->clk);
+
+	pruss_intc_init(p);
+	for (i = 0; i < PRUSS_NUM_PRU; i++)
+		memset_io(p->base + PRUSS_DRAM(i) + PRUSS_CHAN_TABLE, 0,
+			  PRUSS_CHANS_PER_PRU * sizeof(struct pruss_chan_desc));
+
+	platform_set_drvdata(pdev, p);
+	ret = sysfs_create_group(&pdev->dev.kobj, &pruss_attr_group);
+	if (ret)
+		goto err_clk;
+
+	pruss = p;
+
+	dev_info(&pdev->dev, "PRUSS ready\n");
+	return 0;
+
+err_clk:
+	platform_set_drvdata(pdev, NULL);
+	clk_disable(p->clk);
+	clk_put(p->clk);
+err_unmap:
+	iounmap(p->base);
+err_free:
+	kfree(p);
+	return ret;
+}
+
+static int __devexit pruss_remove(struct platform_device *pdev)
+{
+	struct pruss_dev *p = platform_get_drvdata(pdev);
+	int i;
+
+	sysfs_remove_group(&pdev->dev.kobj, &pruss_attr_group);
+
+	for (i = 0; i < PRUSS_NUM_CHANS; i++)
+		WARN_ON(p->chans[i]);
+	for (i = 0; i < PRUSS_NUM_PRU; i++)
+		__pruss_halt(p, i);
+	pruss_intc_write(p, 0, INTC_GER);
+
+	pruss = NULL;
+	platform_set_drvdata(pdev, NULL);
+	clk_disable(p->clk);
+	clk_put(p->clk);
+	iounmap(p->base);
+	kfree(p);
+	return 0;
+}
+
+static struct platform_driver pruss_driver = {
+	.probe		= pruss_probe,
+	.remove		= __devexit_p(pruss_remove),
+	.driver		= {
+		.name	= DRV_NAME,
+		.owner	= THIS_MODULE,
+	},
+};
+
+static int __init pruss_init(void)
+{
+	return platform_driver_register(&pruss_driver);
+}
+module_init(pruss_init);
+
+static void __exit pruss_exit(void)
+{
+	platform_driver_unregister(&pruss_driver);
+}
+module_exit(pruss_exit);
+
+MODULE_DESCRIPTION("DA8xx PRUSS firmware loader and messaging");
+MODULE_LICENSE("GPL v2");
+MODULE_ALIAS("platform:" DRV_NAME);
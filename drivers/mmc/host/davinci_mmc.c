@@ -1169,7 +1169,8 @@ static int mmc_davinci_cpufreq_transition(struct notifier_block *nb,
 	mmc = host->mmc;
 	mmc_pclk = clk_get_rate(host->clk);
 
-	if (val == CPUFREQ_POSTCHANGE) {
+	/* Nothing to do if this transition left our clock alone */
+	if (val == CPUFREQ_POSTCHANGE && mmc_pclk != host->mmc_input_clk) {
 		spin_lock_irqsave(&mmc->lock, flags);
 		host->mmc_input_clk = mmc_pclk;
 		calculate_clk_divider(mmc, &mmc->ios);
@@ -28,32 +28,55 @@
 #include <linux/slab.h>
 #include <linux/types.h>
 #include <linux/vmalloc.h>
+#include <linux/workqueue.h>
 
 #include <linux/mtd/mtd.h>
 #include <linux/mtd/blktrans.h>
 #include <linux/mutex.h>
 
 
+struct mtdblk_cache {
+	struct list_head lru;
+	unsigned char *data;
+	unsigned long offset;
+	enum { STATE_EMPTY, STATE_CLEAN, STATE_DIRTY } state;
+};
+
 struct mtdblk_dev {
 	struct mtd_blktrans_dev mbd;
 	int count;
 	struct mutex cache_mutex;
-	unsigned char *cache_data;
-	unsigned long cache_offset;
+	struct list_head cache_lru;
+	unsigned int cache_nr;
 	unsigned int cache_size;
-	enum { STATE_EMPTY, STATE_CLEAN, STATE_DIRTY } cache_state;
+	struct delayed_work flush_work;
 };
 
 static DEFINE_MUTEX(mtdblks_lock);
 
+static unsigned int cache_blocks = 4;
+module_param(cache_blocks, uint, 0644);
+MODULE_PARM_DESC(cache_blocks, "number of erase blocks cached per device");
+
+static unsigned int flush_interval = 5;
+module_param(flush_interval, uint, 0644);
+MODULE_PARM_DESC(flush_interval, "seconds before dirty cached blocks are "
+		 "written back (0 to only write them back on sync, close or "
+		 "eviction)");
+
 /*
  * Cache stuff...
  *
  * Since typical flash erasable sectors are much larger than what Linux's
  * buffer cache can handle, we must implement read-modify-write on flash
  * sectors for each block write requests.  To avoid over-erasing flash sectors
- * and to speed things up, we locally cache a whole flash sector while it is
- * being written to until a different sector is required.
+ * and to speed things up, we locally cache up to @cache_blocks whole flash
+ * sectors while they are being written to.  The cache is kept in LRU order,
+ * most recently used first; the least recently used sector is written back
+ * when another one is needed, and all of them are written back on flush,
+ * close, or @flush_interval seconds after they were first dirtied.  This
+ * way scattered small writes to a few sectors cost one erase per sector
+ * instead of one per switch between sectors.
  */
 
 static void erase_callback(struct erase_info *done)
@@ -111,20 +134,21 @@ static int erase_write (struct mtd_info *mtd, unsigned long pos,
 }
 
 
-static int write_cached_data (struct mtdblk_dev *mtdblk)
+static int write_cached_block(struct mtdblk_dev *mtdblk,
+			      struct mtdblk_cache *cache)
 {
 	struct mtd_info *mtd = mtdblk->mbd.mtd;
 	int ret;
 
-	if (mtdblk->cache_state != STATE_DIRTY)
+	if (cache->state != STATE_DIRTY)
 		return 0;
 
 	pr_debug("mtdblock: writing cached data for \"%s\" "
 			"at 0x%lx, size 0x%x\n", mtd->name,
-			mtdblk->cache_offset, mtdblk->cache_size);
+			cache->offset, mtdblk->cache_size);
 
-	ret = erase_write (mtd, mtdblk->cache_offset,
-			   mtdblk->cache_size, mtdblk->cache_data);
+	ret = erase_write (mtd, cache->offset,
+			   mtdblk->cache_size, cache->data);
 	if (ret)
 		return ret;
 
@@ -133,18 +157,110 @@ static int write_cached_data (struct mtdblk_dev *mtdblk)
 	 * However this could lead to inconsistency since we will not
 	 * be notified if this content is altered on the flash by other
 	 * means.  Let's declare it empty and leave buffering tasks to
-	 * the buffer cache instead.
+	 * the buffer cache instead.  Empty entries go to the LRU tail,
+	 * to be reused first.
 	 */
-	mtdblk->cache_state = STATE_EMPTY;
+	cache->state = STATE_EMPTY;
+	list_move_tail(&cache->lru, &mtdblk->cache_lru);
 	return 0;
 }
 
+static int write_cached_data (struct mtdblk_dev *mtdblk)
+{
+	struct mtdblk_cache *cache, *next;
+	int ret, err = 0;
+
+	list_for_each_entry_safe(cache, next, &mtdblk->cache_lru, lru) {
+		ret = write_cached_block(mtdblk, cache);
+		if (ret && !err)
+			err = ret;
+	}
+
+	return err;
+}
+
+static void mtdblock_flush_work(struct work_struct *work)
+{
+	struct mtdblk_dev *mtdblk = container_of(work, struct mtdblk_dev,
+						 flush_work.work);
+
+	mutex_lock(&mtdblk->cache_mutex);
+	write_cached_data(mtdblk);
+	mutex_unlock(&mtdblk->cache_mutex);
+}
+
+static struct mtdblk_cache *find_cached_block(struct mtdblk_dev *mtdblk,
+					      unsigned long sect_start)
+{
+	struct mtdblk_cache *cache;
+
+	list_for_each_entry(cache, &mtdblk->cache_lru, lru)
+		if (cache->state != STATE_EMPTY &&
+		    cache->offset == sect_start)
+			return cache;
+
+	return NULL;
+}
+
+/*
+ * Get a cache entry for a new sector:  a fresh one while we are below
+ * @cache_blocks, otherwise the least recently used one, written back if
+ * needed.
+ */
+static struct mtdblk_cache *get_cache_block(struct mtdblk_dev *mtdblk)
+{
+	struct mtdblk_cache *cache = NULL;
+	int ret;
+
+	if (list_empty(&mtdblk->cache_lru) ||
+	    mtdblk->cache_nr < max(cache_blocks, 1U)) {
+		cache = kmalloc(sizeof(*cache), GFP_KERNEL);
+		if (cache) {
+			cache->data = vmalloc(mtdblk->cache_size);
+			if (cache->data) {
+				cache->state = STATE_EMPTY;
+				list_add_tail(&cache->lru, &mtdblk->cache_lru);
+				mtdblk->cache_nr++;
+				return cache;
+			}
+			kfree(cache);
+		}
+		/* -EINTR is not really correct, but it is the best match
+		 * documented in man 2 write for all cases.  We could also
+		 * return -EAGAIN sometimes, but why bother?
+		 */
+		if (list_empty(&mtdblk->cache_lru))
+			return ERR_PTR(-EINTR);
+	}
+
+	cache = list_entry(mtdblk->cache_lru.prev, struct mtdblk_cache, lru);
+	ret = write_cached_block(mtdblk, cache);
+	if (ret)
+		return ERR_PTR(ret);
+
+	cache->state = STATE_EMPTY;
+	return cache;
+}
+
+static void free_cache(struct mtdblk_dev *mtdblk)
+{
+	struct mtdblk_cache *cache, *next;
+
+	list_for_each_entry_safe(cache, next, &mtdblk->cache_lru, lru) {
+		list_del(&cache->lru);
+		vfree(cache->data);
+		kfree(cache);
+	}
+	mtdblk->cache_nr = 0;
+}
+
 
 static int do_cached_write (struct mtdblk_dev *mtdblk, unsigned long pos,
 			    int len, const char *buf)
 {
 	struct mtd_info *mtd = mtdblk->mbd.mtd;
 	unsigned int sect_size = mtdblk->cache_size;
+	struct mtdblk_cache *cache;
 	size_t retlen;
 	int ret;
 
@@ -161,44 +277,50 @@ static int do_cached_write (struct mtdblk_dev *mtdblk, unsigned long pos,
 		if( size > len )
 			size = len;
 
+		cache = find_cached_block(mtdblk, sect_start);
+
 		if (size == sect_size) {
 			/*
 			 * We are covering a whole sector.  Thus there is no
 			 * need to bother with the cache while it may still be
-			 * useful for other partial writes.
+			 * useful for other partial writes.  Just drop any
+			 * cached copy, which this write supersedes.
 			 */
+			if (cache) {
+				cache->state = STATE_EMPTY;
+				list_move_tail(&cache->lru, &mtdblk->cache_lru);
+			}
 			ret = erase_write (mtd, pos, size, buf);
 			if (ret)
 				return ret;
 		} else {
 			/* Partial sector: need to use the cache */
 
-			if (mtdblk->cache_state == STATE_DIRTY &&
-			    mtdblk->cache_offset != sect_start) {
-				ret = write_cached_data(mtdblk);
-				if (ret)
-					return ret;
-			}
+			if (!cache) {
+				cache = get_cache_block(mtdblk);
+				if (IS_ERR(cache))
+					return PTR_ERR(cache);
 
-			if (mtdblk->cache_state == STATE_EMPTY ||
-			    mtdblk->cache_offset != sect_start) {
 				/* fill the cache with the current sector */
-				mtdblk->cache_state = STATE_EMPTY;
 				ret = mtd_read(mtd, sect_start, sect_size,
-					       &retlen, mtdblk->cache_data);
+					       &retlen, cache->data);
 				if (ret)
 					return ret;
 				if (retlen != sect_size)
 					return -EIO;
 
-				mtdblk->cache_offset = sect_start;
-				mtdblk->cache_size = sect_size;
-				mtdblk->cache_state = STATE_CLEAN;
+				cache->offset = sect_start;
+				cache->state = STATE_CLEAN;
 			}
 
 			/* write data to our local cache */
-			memcpy (mtdblk->cache_data + offset, buf, size);
-			mtdblk->cache_state = STATE_DIRTY;
+			memcpy (cache->data + offset, buf, size);
+			cache->state = STATE_DIRTY;
+			list_move(&cache->lru, &mtdblk->cache_lru);
+
+			if (flush_interval)
+				schedule_delayed_work(&mtdblk->flush_work,
+						      flush_interval * HZ);
 		}
 
 		buf += size;
@@ -215,6 +337,7 @@ static int do_cached_read (struct mtdblk_dev *mtdblk, unsigned long pos,
 {
 	struct mtd_info *mtd = mtdblk->mbd.mtd;
 	unsigned int sect_size = mtdblk->cache_size;
+	struct mtdblk_cache *cache;
 	size_t retlen;
 	int ret;
 
@@ -237,9 +360,10 @@ static int do_cached_read (struct mtdblk_dev *mtdblk, unsigned long pos,
 		 * contains what we want, otherwise we read the data directly
 		 * from flash.
 		 */
-		if (mtdblk->cache_state != STATE_EMPTY &&
-		    mtdblk->cache_offset == sect_start) {
-			memcpy (buf, mtdblk->cache_data + offset, size);
+		cache = find_cached_block(mtdblk, sect_start);
+		if (cache) {
+			memcpy (buf, cache->data + offset, size);
+			list_move(&cache->lru, &mtdblk->cache_lru);
 		} else {
 			ret = mtd_read(mtd, pos, size, &retlen, buf);
 			if (ret)
@@ -260,23 +384,24 @@ static int mtdblock_readsect(struct mtd_blktrans_dev *dev,
 			      unsigned long block, char *buf)
 {
 	struct mtdblk_dev *mtdblk = container_of(dev, struct mtdblk_dev, mbd);
-	return do_cached_read(mtdblk, block<<9, 512, buf);
+	int ret;
+
+	mutex_lock(&mtdblk->cache_mutex);
+	ret = do_cached_read(mtdblk, block<<9, 512, buf);
+	mutex_unlock(&mtdblk->cache_mutex);
+	return ret;
 }
 
 static int mtdblock_writesect(struct mtd_blktrans_dev *dev,
 			      unsigned long block, char *buf)
 {
 	struct mtdblk_dev *mtdblk = container_of(dev, struct mtdblk_dev, mbd);
-	if (unlikely(!mtdblk->cache_data && mtdblk->cache_size)) {
-		mtdblk->cache_data = vmalloc(mtdblk->mbd.mtd->erasesize);
-		if (!mtdblk->cache_data)
-			return -EINTR;
-		/* -EINTR is not really correct, but it is the best match
-		 * documented in man 2 write for all cases.  We could also
-		 * return -EAGAIN sometimes, but why bother?
-		 */
-	}
-	return do_cached_write(mtdblk, block<<9, 512, buf);
+	int ret;
+
+	mutex_lock(&mtdblk->cache_mutex);
+	ret = do_cached_write(mtdblk, block<<9, 512, buf);
+	mutex_unlock(&mtdblk->cache_mutex);
+	return ret;
 }
 
 static int mtdblock_open(struct mtd_blktrans_dev *mbd)
@@ -295,11 +420,11 @@ static int mtdblock_open(struct mtd_blktrans_dev *mbd)
 	/* OK, it's not open. Create cache info for it */
 	mtdblk->count = 1;
 	mutex_init(&mtdblk->cache_mutex);
-	mtdblk->cache_state = STATE_EMPTY;
-	if (!(mbd->mtd->flags & MTD_NO_ERASE) && mbd->mtd->erasesize) {
+	INIT_LIST_HEAD(&mtdblk->cache_lru);
+	mtdblk->cache_nr = 0;
+	INIT_DELAYED_WORK(&mtdblk->flush_work, mtdblock_flush_work);
+	if (!(mbd->mtd->flags & MTD_NO_ERASE) && mbd->mtd->erasesize)
 		mtdblk->cache_size = mbd->mtd->erasesize;
-		mtdblk->cache_data = NULL;
-	}
 
 	mutex_unlock(&mtdblks_lock);
 
@@ -322,8 +447,9 @@ static int mtdblock_release(struct mtd_blktrans_dev *mbd)
 
 	if (!--mtdblk->count) {
 		/* It was the last usage. Free the cache */
+		cancel_delayed_work_sync(&mtdblk->flush_work);
+		free_cache(mtdblk);
 		mtd_sync(mbd->mtd);
-		vfree(mtdblk->cache_data);
 	}
 
 	mutex_unlock(&mtdblks_lock);
@@ -336,12 +462,13 @@ static int mtdblock_release(struct mtd_blktrans_dev *mbd)
 static int mtdblock_flush(struct mtd_blktrans_dev *dev)
 {
 	struct mtdblk_dev *mtdblk = container_of(dev, struct mtdblk_dev, mbd);
+	int ret;
 
 	mutex_lock(&mtdblk->cache_mutex);
-	write_cached_data(mtdblk);
+	ret = write_cached_data(mtdblk);
 	mutex_unlock(&mtdblk->cache_mutex);
 	mtd_sync(dev->mtd);
-	return 0;
+	return ret;
 }
 
 static void mtdblock_add_mtd(struct mtd_blktrans_ops *tr, struct mtd_info *mtd)
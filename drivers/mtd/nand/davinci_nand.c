@@ -34,6 +34,8 @@
 #include <linux/mtd/partitions.h>
 #include <linux/slab.h>
 #include <linux/cpufreq.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <mach/nand.h>
 #include <linux/mfd/davinci_aemif.h>
@@ -78,10 +80,24 @@ struct davinci_nand_info {
 	struct notifier_block	freq_transition;
 #endif
 
+	/* 4-bit ECC statistics, indexed by the most bitflips corrected
+	 * in any 512-byte step of a page
+	 */
+	unsigned long		ecc4_pages[5];
+	unsigned long		ecc4_failed_pages;
+	struct dentry		*debugfs;
 };
 
 static DEFINE_SPINLOCK(davinci_nand_lock);
-static bool ecc4_busy;
+
+/* The 4-bit ECC engine is shared by all chipselects, so chips using it
+ * share one controller:  the NAND core then runs only one operation at
+ * a time on them, and the engine is never used for two chips at once.
+ */
+static struct nand_hw_control davinci_nand_ecc4_control = {
+	.lock	= __SPIN_LOCK_UNLOCKED(davinci_nand_ecc4_control.lock),
+	.wq	= __WAIT_QUEUE_HEAD_INITIALIZER(davinci_nand_ecc4_control.wq),
+};
 
 #define to_davinci_nand(m) container_of(m, struct davinci_nand_info, mtd)
 
@@ -362,8 +378,8 @@ compare:
 	davinci_nand_readl(info, NAND_ERR_ADD1_OFFSET);
 
 	/* Start address calculation, and wait for it to complete.
-	 * We _could_ start reading more data while this is working,
-	 * to speed up the overall page read.
+	 * The next step's data can't be read meanwhile:  it has to go
+	 * through the same ECC engine.
 	 */
 	davinci_nand_writel(info, NANDFCR_OFFSET,
 			davinci_nand_readl(info, NANDFCR_OFFSET) | BIT(13));
@@ -384,6 +400,7 @@ compare:
 		cpu_relax();
 	} while ((ecc_state < 4) && time_before(jiffies, timeo));
 
+	timeo = jiffies + msecs_to_jiffies(10);
 	for (;;) {
 		u32	fsr = davinci_nand_readl(info, NANDFSR_OFFSET);
 
@@ -399,6 +416,11 @@ compare:
 			num_errors = 1 + ((fsr >> 16) & 0x03);
 			goto correct;
 		default:	/* still working on it */
+			if (time_after(jiffies, timeo)) {
+				dev_err(info->dev, "4-bit ECC correction "
+						"timed out\n");
+				return -EIO;
+			}
 			cpu_relax();
 			continue;
 		}
@@ -437,6 +459,92 @@ correct:
 	return corrected;
 }
 
+/*
+ * Read a page with 4-bit ECC, keeping per-page correction statistics.
+ *
+ * The ECC codes are needed before the data can be corrected.  On large
+ * page chips they follow the data, and the generic OOB-first page read
+ * gets them by reading the page from the array twice more.  The NAND core
+ * has just issued READ0 for this page (chips never auto-increment here),
+ * so instead we fetch the OOB from the page register by random data
+ * output and go back for the data the same way.
+ */
+static int nand_davinci_read_page_4bit(struct mtd_info *mtd,
+		struct nand_chip *chip, uint8_t *buf, int page)
+{
+	struct davinci_nand_info *info = to_davinci_nand(mtd);
+	int eccsize = chip->ecc.size;
+	int eccbytes = chip->ecc.bytes;
+	int eccsteps = chip->ecc.steps;
+	uint32_t *eccpos = chip->ecc.layout->eccpos;
+	uint8_t *ecc_code = chip->buffers->ecccode;
+	uint8_t *p = buf;
+	int i, j, stat, max_flips = 0;
+	bool failed = false;
+
+	if (eccsteps > 1) {
+		chip->cmdfunc(mtd, NAND_CMD_RNDOUT, mtd->writesize, -1);
+		chip->read_buf(mtd, chip->oob_poi, mtd->oobsize);
+		chip->cmdfunc(mtd, NAND_CMD_RNDOUT, 0, -1);
+	}
+
+	for (i = 0; i < eccsteps; i++, p += eccsize) {
+		chip->ecc.hwctl(mtd, NAND_ECC_READ);
+		chip->read_buf(mtd, p, eccsize);
+		chip->ecc.calculate(mtd, p, chip->buffers->ecccalc);
+
+		/* small page:  the ECC bytes follow the data */
+		if (eccsteps == 1)
+			chip->read_buf(mtd, chip->oob_poi, mtd->oobsize);
+
+		for (j = 0; j < eccbytes; j++)
+			ecc_code[j] = chip->oob_poi[eccpos[i * eccbytes + j]];
+
+		stat = chip->ecc.correct(mtd, p, ecc_code, NULL);
+		if (stat < 0) {
+			mtd->ecc_stats.failed++;
+			failed = true;
+		} else {
+			mtd->ecc_stats.corrected += stat;
+			max_flips = max(max_flips, stat);
+		}
+	}
+
+	if (failed)
+		info->ecc4_failed_pages++;
+	else
+		info->ecc4_pages[min(max_flips, 4)]++;
+
+	return 0;
+}
+
+static int nand_davinci_ecc4_stats_show(struct seq_file *s, void *unused)
+{
+	struct davinci_nand_info *info = s->private;
+	int i;
+
+	for (i = 0; i <= 4; i++)
+		seq_printf(s, "pages with worst step at %d bitflips: %lu\n",
+				i, info->ecc4_pages[i]);
+	seq_printf(s, "uncorrectable pages: %lu\n", info->ecc4_failed_pages);
+
+	return 0;
+}
+
+static int nand_davinci_ecc4_stats_open(struct inode *inode,
+		struct file *file)
+{
+	return single_open(file, nand_davinci_ecc4_stats_show,
+			inode->i_private);
+}
+
+static const struct file_operations nand_davinci_ecc4_stats_fops = {
+	.open		= nand_davinci_ecc4_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 /*----------------------------------------------------------------------*/
 
 /*
@@ -685,20 +793,13 @@ static int __init nand_davinci_probe(struct platform_device *pdev)
 			 * and the chips may not use NAND_BUSWIDTH_16.
 			 */
 
-			/* No sharing 4-bit hardware between chipselects yet */
-			spin_lock_irq(&davinci_nand_lock);
-			if (ecc4_busy)
-				ret = -EBUSY;
-			else
-				ecc4_busy = true;
-			spin_unlock_irq(&davinci_nand_lock);
-
-			if (ret == -EBUSY)
-				goto err_ecc;
+			/* Chipselects take turns with the 4-bit hardware */
+			info->chip.controller = &davinci_nand_ecc4_control;
 
 			info->chip.ecc.calculate = nand_davinci_calculate_4bit;
 			info->chip.ecc.correct = nand_davinci_correct_4bit;
 			info->chip.ecc.hwctl = nand_davinci_hwctl_4bit;
+			info->chip.ecc.read_page = nand_davinci_read_page_4bit;
 			info->chip.ecc.bytes = 10;
 		} else {
 			info->chip.ecc.calculate = nand_davinci_calculate_1bit;
@@ -832,6 +933,14 @@ syndrome_done:
 	if (ret < 0)
 		goto err_scan;
 
+	if (pdata->ecc_bits == 4) {
+		info->debugfs = debugfs_create_dir(dev_name(&pdev->dev), NULL);
+		if (info->debugfs)
+			debugfs_create_file("ecc4_stats", S_IRUGO,
+					info->debugfs, info,
+					&nand_davinci_ecc4_stats_fops);
+	}
+
 	val = davinci_nand_readl(info, NRCSR_OFFSET);
 	dev_info(&pdev->dev, "controller rev. %d.%d\n",
 	       (val >> 8) & 0xff, val & 0xff);
@@ -846,11 +955,6 @@ err_timing:
 err_clk_enable:
 	clk_put(info->clk);
 
-	spin_lock_irq(&davinci_nand_lock);
-	if (ecc_mode == NAND_ECC_HW_SYNDROME)
-		ecc4_busy = false;
-	spin_unlock_irq(&davinci_nand_lock);
-
 err_ecc:
 err_clk:
 err_ioremap:
@@ -869,10 +973,7 @@ static int __exit nand_davinci_remove(struct platform_device *pdev)
 	struct davinci_nand_info *info = platform_get_drvdata(pdev);
 
 	nand_davinci_cpufreq_deregister(info);
-	spin_lock_irq(&davinci_nand_lock);
-	if (info->chip.ecc.mode == NAND_ECC_HW_SYNDROME)
-		ecc4_busy = false;
-	spin_unlock_irq(&davinci_nand_lock);
+	debugfs_remove_recursive(info->debugfs);
 
 	iounmap(info->base);
 	iounmap(info->vaddr);
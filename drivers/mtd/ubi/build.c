@@ -44,6 +44,7 @@
 #include <linux/kthread.h>
 #include <linux/kernel.h>
 #include <linux/slab.h>
+#include <linux/ktime.h>
 #include "ubi.h"
 
 /* Maximum length of the 'mtd=' parameter */
@@ -131,6 +132,8 @@ static struct device_attribute dev_bgt_enabled =
 	__ATTR(bgt_enabled, S_IRUGO, dev_attribute_show, NULL);
 static struct device_attribute dev_mtd_num =
 	__ATTR(mtd_num, S_IRUGO, dev_attribute_show, NULL);
+static struct device_attribute dev_read_scrubs =
+	__ATTR(read_scrubs, S_IRUGO, dev_attribute_show, NULL);
 
 /**
  * ubi_volume_notify - send a volume change notification.
@@ -355,6 +358,8 @@ static ssize_t dev_attribute_show(struct device *dev,
 		ret = sprintf(buf, "%d\n", ubi->thread_enabled);
 	else if (attr == &dev_mtd_num)
 		ret = sprintf(buf, "%d\n", ubi->mtd->index);
+	else if (attr == &dev_read_scrubs)
+		ret = sprintf(buf, "%d\n", ubi->read_scrubs);
 	else
 		ret = -EINVAL;
 
@@ -422,6 +427,9 @@ static int ubi_sysfs_init(struct ubi_device *ubi, int *ref)
 	if (err)
 		return err;
 	err = device_create_file(&ubi->dev, &dev_mtd_num);
+	if (err)
+		return err;
+	err = device_create_file(&ubi->dev, &dev_read_scrubs);
 	return err;
 }
 
@@ -431,6 +439,7 @@ static int ubi_sysfs_init(struct ubi_device *ubi, int *ref)
  */
 static void ubi_sysfs_close(struct ubi_device *ubi)
 {
+	device_remove_file(&ubi->dev, &dev_read_scrubs);
 	device_remove_file(&ubi->dev, &dev_mtd_num);
 	device_remove_file(&ubi->dev, &dev_bgt_enabled);
 	device_remove_file(&ubi->dev, &dev_min_io_size);
@@ -575,19 +584,34 @@ static void free_internal_volumes(struct ubi_device *ubi)
  * This function returns zero in case of success and a negative error code in
  * case of failure.
  *
- * Note, currently this is the only method to attach UBI devices. Hopefully in
- * the future we'll have more scalable attaching methods and avoid full media
- * scanning. But even in this case scanning will be needed as a fall-back
- * attaching method if there are some on-flash table corruptions.
+ * Note, if fast attach is enabled, the scanning information is taken from the
+ * on-flash checkpoint instead (see ckpt.c). Full media scanning is still the
+ * fall-back attaching method if the checkpoint is missing or stale. The time
+ * spent in each attach phase is printed, to make attach time regressions easy
+ * to spot.
  */
 static int attach_by_scanning(struct ubi_device *ubi)
 {
 	int err;
 	struct ubi_scan_info *si;
+	const char *how = "checkpoint";
+	ktime_t start, t_scan, t_vtbl, t_wl, t_eba;
 
-	si = ubi_scan(ubi);
-	if (IS_ERR(si))
-		return PTR_ERR(si);
+	err = ubi_ckpt_init(ubi);
+	if (err)
+		return err;
+
+	start = ktime_get();
+	si = ubi_ckpt_scan(ubi);
+	if (!si) {
+		how = "scan";
+		si = ubi_scan(ubi);
+	}
+	if (IS_ERR(si)) {
+		err = PTR_ERR(si);
+		goto out_ckpt;
+	}
+	t_scan = ktime_get();
 
 	ubi->bad_peb_count = si->bad_peb_count;
 	ubi->good_peb_count = ubi->peb_count - ubi->bad_peb_count;
@@ -599,16 +623,28 @@ static int attach_by_scanning(struct ubi_device *ubi)
 	err = ubi_read_volume_table(ubi, si);
 	if (err)
 		goto out_si;
+	t_vtbl = ktime_get();
 
 	err = ubi_wl_init_scan(ubi, si);
 	if (err)
 		goto out_vtbl;
+	t_wl = ktime_get();
 
 	err = ubi_eba_init_scan(ubi, si);
+	if (err)
+		goto out_wl;
+	t_eba = ktime_get();
+
+	err = ubi_ckpt_attach(ubi, si);
 	if (err)
 		goto out_wl;
 
 	ubi_scan_destroy_si(si);
+
+	ubi_msg("attach time: %s %lld us, volume table %lld us, WL %lld us, "
+		"EBA %lld us", how, ktime_us_delta(t_scan, start),
+		ktime_us_delta(t_vtbl, t_scan), ktime_us_delta(t_wl, t_vtbl),
+		ktime_us_delta(t_eba, t_wl));
 	return 0;
 
 out_wl:
@@ -618,6 +654,8 @@ out_vtbl:
 	vfree(ubi->vtbl);
 out_si:
 	ubi_scan_destroy_si(si);
+out_ckpt:
+	ubi_ckpt_free(ubi);
 	return err;
 }
 
@@ -1023,6 +1061,7 @@ out_uif:
 	ubi_assert(ref);
 	uif_close(ubi);
 out_detach:
+	ubi_ckpt_free(ubi);
 	ubi_wl_close(ubi);
 	free_internal_volumes(ubi);
 	vfree(ubi->vtbl);
@@ -1081,6 +1120,13 @@ int ubi_detach_mtd_dev(int ubi_num, int anyway)
 	ubi_notify_all(ubi, UBI_VOLUME_REMOVED, NULL);
 	dbg_msg("detaching mtd%d from ubi%d", ubi->mtd->index, ubi_num);
 
+	/*
+	 * Leave a checkpoint behind for the next attach. This has to be done
+	 * while the background thread is still running, because writing the
+	 * checkpoint schedules erasures and may have to wait for them.
+	 */
+	ubi_ckpt_close(ubi);
+
 	/*
 	 * Before freeing anything, we have to stop the background thread to
 	 * prevent it from doing anything on this device while we are freeing.
@@ -0,0 +1,1078 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See
+ * the GNU General Public License for more details.
+ */
+
+/*
+ * UBI checkpoint (fast attach) sub-system.
+ *
+ * Scanning reads the EC and VID headers of every physical eraseblock, so
+ * attaching takes time proportional to the flash size. This sub-system
+ * stores what scanning would find - the state and erase counter of every PEB
+ * and the LEB each used PEB maps - in a checkpoint on the flash, and builds
+ * the scanning information from it on the next attach. Only the first
+ * %UBI_CKPT_MAX_START PEBs have to be read to find it.
+ *
+ * The checkpoint consists of an anchor PEB holding &struct ubi_ckpt_hdr and
+ * of data PEBs holding the records (see ubi-media.h). All of them belong to
+ * the internal checkpoint volume, which has the "delete" compatibility flag,
+ * so an older UBI simply erases them. The PEBs are taken out of the WL
+ * sub-system while they hold the current checkpoint and are returned to it
+ * once a newer one has been written.
+ *
+ * The checkpoint is written when the device is detached, when the system is
+ * rebooted or shut down (a built-in root device is never detached), and
+ * every @ckpt_interval seconds if it went stale or LEB mappings changed
+ * meanwhile. Each rewrite erases nr_blocks + 1 PEBs itself, so the periodic
+ * update is rate-limited by @ckpt_interval rather than done on every change.
+ *
+ * The checkpoint also carries the read counts of used PEBs (see
+ * 'ubi_wl_read_done()'), which otherwise would restart from zero on every
+ * attach. Reads do not make the checkpoint stale, so they alone only cause a
+ * rewrite on detach, reboot or shutdown; the reads done after the last
+ * checkpoint are lost if the system crashes.
+ *
+ * Rather than updating the checkpoint on every change, the I/O sub-system
+ * calls 'ubi_ckpt_invalidate()' before anything on the flash changes and the
+ * first such call writes a "stale" marker to the anchor PEB. If the system
+ * crashes afterwards, the next attach falls back to scanning. Erasing a PEB
+ * the checkpoint already records as "to be erased" does not make it stale,
+ * which is what happens to the previous checkpoint's PEBs.
+ *
+ * Locking: the checkpoint is written with @sem held for writing, which keeps
+ * the EBA sub-system from changing LEB mappings (see 'leb_map_lock()'), and
+ * with @ubi->work_sem held for writing, which keeps the WL sub-system from
+ * moving and erasing PEBs. The WL workers must therefore never take @sem.
+ */
+
+#include <linux/crc32.h>
+#include <linux/moduleparam.h>
+#include <linux/workqueue.h>
+#include <linux/reboot.h>
+#include "ubi.h"
+
+/* How often the checkpoint is brought up to date, in seconds (0 - never) */
+static unsigned int ckpt_interval = 300;
+module_param(ckpt_interval, uint, 0644);
+MODULE_PARM_DESC(ckpt_interval, "seconds between checkpoint updates "
+		 "(0 - only on detach and reboot)");
+
+/**
+ * struct ubi_ckpt - checkpoint information.
+ * @ubi: UBI device description object
+ * @sem: taken for reading by LEB mapping changes, for writing by the writer
+ * @mutex: protects @valid, @state, @pnum and @ec against the invalidation
+ * @valid: the checkpoint on the flash describes the current state
+ * @dirty: the checkpoint went stale or LEB mappings changed since it was
+ *         written
+ * @count: count of PEBs in @pnum, %0 if there is no checkpoint on the flash
+ * @pnum: checkpoint PEBs, the anchor first
+ * @ec: erase counters of the checkpoint PEBs
+ * @nr_blocks: count of data PEBs in a checkpoint
+ * @hdr_len: size of the header aligned to the min. I/O unit
+ * @state: PEB states recorded in the checkpoint, indexed by PEB number
+ * @reads: sum of the read counts recorded in the checkpoint
+ * @marker: min. I/O unit of zeroes to mark the checkpoint stale with
+ * @work: periodic update
+ * @reboot: writes the checkpoint on reboot and shutdown
+ */
+struct ubi_ckpt {
+	struct ubi_device *ubi;
+	struct rw_semaphore sem;
+	struct mutex mutex;
+	int valid;
+	int dirty;
+	int count;
+	int pnum[UBI_CKPT_MAX_BLOCKS + 1];
+	int ec[UBI_CKPT_MAX_BLOCKS + 1];
+	int nr_blocks;
+	int hdr_len;
+	u8 *state;
+	unsigned long long reads;
+	void *marker;
+	struct delayed_work work;
+	struct notifier_block reboot;
+};
+
+/**
+ * ckpt_reads - convert a PEB read count to the checkpoint representation.
+ * @reads: pages read from the PEB
+ */
+static u16 ckpt_reads(unsigned int reads)
+{
+	return min_t(unsigned int, reads >> UBI_CKPT_READS_SHIFT, 0xFFFF);
+}
+
+/**
+ * reads_changed - check if the read counts are newer than the checkpoint.
+ * @ubi: UBI device description object
+ */
+static int reads_changed(struct ubi_device *ubi)
+{
+	struct ubi_ckpt *ckpt = ubi->ckpt;
+	unsigned long long reads = 0;
+	int pnum;
+
+	for (pnum = 0; pnum < ubi->peb_count; pnum++)
+		if (ckpt->state[pnum] == UBI_CKPT_PEB_USED)
+			reads += ckpt_reads(ubi->peb_reads[pnum]);
+	return reads != ckpt->reads;
+}
+
+/**
+ * mark_stale - mark the checkpoint on the flash stale.
+ * @ubi: UBI device description object
+ *
+ * This function has to be called with @ckpt->mutex held. Returns zero in case
+ * of success and a negative error code in case of failure.
+ */
+static int mark_stale(struct ubi_device *ubi)
+{
+	struct ubi_ckpt *ckpt = ubi->ckpt;
+	int err;
+
+	dbg_gen("mark checkpoint in PEB %d stale", ckpt->pnum[0]);
+	err = ubi_io_write_data(ubi, ckpt->marker, ckpt->pnum[0],
+				ckpt->hdr_len, ubi->min_io_size);
+	if (err) {
+		ubi_err("cannot mark checkpoint in PEB %d stale, error %d",
+			ckpt->pnum[0], err);
+		return err;
+	}
+
+	ckpt->valid = 0;
+	ckpt->dirty = 1;
+	return 0;
+}
+
+/**
+ * ubi_ckpt_invalidate - note that the flash contents is about to change.
+ * @ubi: UBI device description object
+ * @pnum: the physical eraseblock which is going to change
+ * @erase: non-zero if @pnum is going to be erased
+ *
+ * This function is called by the I/O sub-system before a VID header is
+ * written, a PEB is erased or marked bad. Returns zero in case of success and
+ * a negative error code if the checkpoint could not be marked stale, in which
+ * case the operation must not go ahead.
+ */
+int ubi_ckpt_invalidate(struct ubi_device *ubi, int pnum, int erase)
+{
+	struct ubi_ckpt *ckpt = ubi->ckpt;
+	int err = 0;
+
+	if (!ckpt || !ckpt->valid)
+		return 0;
+
+	mutex_lock(&ckpt->mutex);
+	if (ckpt->valid &&
+	    !(erase && ckpt->state[pnum] == UBI_CKPT_PEB_ERASE))
+		err = mark_stale(ubi);
+	mutex_unlock(&ckpt->mutex);
+	return err;
+}
+
+/**
+ * ubi_ckpt_read_lock - keep the checkpoint from being written.
+ * @ubi: UBI device description object
+ *
+ * This is taken around LEB mapping changes, so it also notes that the next
+ * periodic update has something to do.
+ */
+void ubi_ckpt_read_lock(struct ubi_device *ubi)
+{
+	if (ubi->ckpt) {
+		down_read(&ubi->ckpt->sem);
+		ubi->ckpt->dirty = 1;
+	}
+}
+
+/**
+ * ubi_ckpt_read_unlock - release the lock taken by 'ubi_ckpt_read_lock()'.
+ * @ubi: UBI device description object
+ */
+void ubi_ckpt_read_unlock(struct ubi_device *ubi)
+{
+	if (ubi->ckpt)
+		up_read(&ubi->ckpt->sem);
+}
+
+/**
+ * find_anchor - find the newest checkpoint anchor PEB.
+ * @ubi: UBI device description object
+ * @vid_hdr: buffer for VID headers
+ * @ec: erase counter of the anchor is returned here
+ *
+ * This function returns the anchor PEB number, %-ENOENT if there is none and
+ * %-ENOMEM if out of memory.
+ */
+static int find_anchor(struct ubi_device *ubi, struct ubi_vid_hdr *vid_hdr,
+		       int *ec)
+{
+	int err, pnum, anchor = -ENOENT, max = UBI_CKPT_MAX_START;
+	unsigned long long sqnum, max_sqnum = 0;
+	struct ubi_ec_hdr *ec_hdr;
+
+	ec_hdr = kzalloc(ubi->ec_hdr_alsize, GFP_KERNEL);
+	if (!ec_hdr)
+		return -ENOMEM;
+
+	if (max > ubi->peb_count)
+		max = ubi->peb_count;
+
+	/* Whatever cannot be read here is left to scanning */
+	for (pnum = 0; pnum < max; pnum++) {
+		if (ubi_io_is_bad(ubi, pnum))
+			continue;
+
+		err = ubi_io_read_ec_hdr(ubi, pnum, ec_hdr, 0);
+		if (err && err != UBI_IO_BITFLIPS)
+			continue;
+
+		err = ubi_io_read_vid_hdr(ubi, pnum, vid_hdr, 0);
+		if (err && err != UBI_IO_BITFLIPS)
+			continue;
+
+		if (be32_to_cpu(vid_hdr->vol_id) != UBI_CKPT_VOLUME_ID ||
+		    be32_to_cpu(vid_hdr->lnum) != 0)
+			continue;
+
+		sqnum = be64_to_cpu(vid_hdr->sqnum);
+		if (anchor >= 0 && sqnum <= max_sqnum)
+			continue;
+
+		anchor = pnum;
+		max_sqnum = sqnum;
+		*ec = be64_to_cpu(ec_hdr->ec);
+		ubi->image_seq = be32_to_cpu(ec_hdr->image_seq);
+	}
+
+	kfree(ec_hdr);
+	return anchor;
+}
+
+/**
+ * read_ckpt - read and check the checkpoint.
+ * @ubi: UBI device description object
+ * @anchor: the anchor PEB
+ * @hdr: buffer of @ckpt->hdr_len bytes for the header
+ * @vid_hdr: buffer for VID headers
+ * @data: the checkpoint data is returned here
+ *
+ * This function returns zero in case of success, %1 if the checkpoint is
+ * stale, broken or unreadable and %-ENOMEM if out of memory. The caller has
+ * to vfree() @data if zero was returned.
+ */
+static int read_ckpt(struct ubi_device *ubi, int anchor,
+		     struct ubi_ckpt_hdr *hdr, struct ubi_vid_hdr *vid_hdr,
+		     void **data)
+{
+	struct ubi_ckpt *ckpt = ubi->ckpt;
+	int err, i, pnum = anchor, len, nr_blocks, data_size, peb_count;
+	int vol_count;
+	void *buf;
+
+	err = ubi_io_read_data(ubi, hdr, anchor, 0, ckpt->hdr_len);
+	if (err && err != UBI_IO_BITFLIPS)
+		return 1;
+
+	if (be32_to_cpu(hdr->magic) != UBI_CKPT_HDR_MAGIC ||
+	    hdr->version != UBI_CKPT_VERSION ||
+	    be32_to_cpu(hdr->hdr_crc) !=
+			crc32(UBI_CRC32_INIT, hdr, UBI_CKPT_HDR_SIZE_CRC)) {
+		ubi_warn("bad checkpoint header in PEB %d", anchor);
+		return 1;
+	}
+
+	nr_blocks = be32_to_cpu(hdr->nr_blocks);
+	data_size = be32_to_cpu(hdr->data_size);
+	peb_count = be32_to_cpu(hdr->peb_count);
+	vol_count = be32_to_cpu(hdr->vol_count);
+	if (be32_to_cpu(hdr->image_seq) != ubi->image_seq ||
+	    peb_count != ubi->peb_count || nr_blocks != ckpt->nr_blocks ||
+	    vol_count < 0 || vol_count > UBI_MAX_VOLUMES + UBI_INT_VOL_COUNT ||
+	    data_size != vol_count * sizeof(struct ubi_ckpt_vol) +
+			 peb_count * sizeof(struct ubi_ckpt_peb) ||
+	    data_size > nr_blocks * ubi->leb_size) {
+		ubi_warn("checkpoint does not match this device");
+		return 1;
+	}
+
+	/* Has anything changed since the checkpoint was written? */
+	buf = ubi->peb_buf1;
+	mutex_lock(&ubi->buf_mutex);
+	err = ubi_io_read_data(ubi, buf, anchor, ckpt->hdr_len,
+			       ubi->min_io_size);
+	if (!err || err == UBI_IO_BITFLIPS)
+		err = !ubi_check_pattern(buf, 0xFF, ubi->min_io_size);
+	mutex_unlock(&ubi->buf_mutex);
+	if (err) {
+		ubi_msg("checkpoint is stale");
+		return 1;
+	}
+
+	buf = vmalloc(data_size);
+	if (!buf)
+		return -ENOMEM;
+
+	for (i = 0; i < nr_blocks; i++) {
+		pnum = be32_to_cpu(hdr->block_pnum[i]);
+		if (pnum < 0 || pnum >= ubi->peb_count)
+			goto bad;
+
+		err = ubi_io_read_vid_hdr(ubi, pnum, vid_hdr, 0);
+		if (err && err != UBI_IO_BITFLIPS)
+			goto bad;
+		if (be32_to_cpu(vid_hdr->vol_id) != UBI_CKPT_VOLUME_ID ||
+		    be32_to_cpu(vid_hdr->lnum) != i + 1)
+			goto bad;
+
+		len = min(data_size - i * ubi->leb_size, ubi->leb_size);
+		if (len <= 0)
+			continue;
+
+		err = ubi_io_read_data(ubi, buf + i * ubi->leb_size, pnum, 0,
+				       len);
+		if (err && err != UBI_IO_BITFLIPS)
+			goto bad;
+	}
+
+	if (be32_to_cpu(hdr->data_crc) != crc32(UBI_CRC32_INIT, buf, data_size))
+		goto bad;
+
+	*data = buf;
+	return 0;
+
+bad:
+	ubi_warn("bad checkpoint data in PEB %d", pnum);
+	vfree(buf);
+	return 1;
+}
+
+/**
+ * build_si - build scanning information from the checkpoint.
+ * @ubi: UBI device description object
+ * @si: scanning information to fill
+ * @hdr: the checkpoint header
+ * @data: the checkpoint data
+ * @vid_hdr: buffer to make up VID headers in
+ *
+ * This function also sets up @ubi->ckpt for the checkpoint which was read.
+ * Returns zero in case of success, %1 if the checkpoint turned out to be
+ * inconsistent and a negative error code in case of failure.
+ */
+static int build_si(struct ubi_device *ubi, struct ubi_scan_info *si,
+		    const struct ubi_ckpt_hdr *hdr, const void *data,
+		    struct ubi_vid_hdr *vid_hdr)
+{
+	struct ubi_ckpt *ckpt = ubi->ckpt;
+	int i, j, err, pnum, ec, vol_count, found = 0;
+	const struct ubi_ckpt_vol *vols = data, *v;
+	const struct ubi_ckpt_peb *peb;
+	struct ubi_scan_leb *seb;
+
+	vol_count = be32_to_cpu(hdr->vol_count);
+	peb = data + vol_count * sizeof(struct ubi_ckpt_vol);
+
+	si->peb_reads = kcalloc(ubi->peb_count, sizeof(unsigned int),
+				GFP_KERNEL);
+	if (!si->peb_reads)
+		return -ENOMEM;
+	ckpt->reads = 0;
+
+	ckpt->pnum[0] = -1;
+	for (i = 0; i < ckpt->nr_blocks; i++)
+		ckpt->pnum[i + 1] = be32_to_cpu(hdr->block_pnum[i]);
+
+	si->min_ec = UBI_MAX_ERASECOUNTER;
+	for (pnum = 0; pnum < ubi->peb_count; pnum++, peb++) {
+		cond_resched();
+
+		err = ubi_io_is_bad(ubi, pnum);
+		if (err < 0)
+			return err;
+		if (!!err != (peb->state == UBI_CKPT_PEB_BAD)) {
+			ubi_warn("PEB %d bad state is not as checkpointed",
+				 pnum);
+			return 1;
+		}
+
+		ckpt->state[pnum] = peb->state;
+		ec = be32_to_cpu(peb->ec);
+		if (ec < 0)
+			ec = UBI_SCAN_UNKNOWN_EC;
+
+		switch (peb->state) {
+		case UBI_CKPT_PEB_BAD:
+			si->bad_peb_count += 1;
+			continue;
+		case UBI_CKPT_PEB_FREE:
+			err = ubi_scan_add_to_list(si, pnum, ec, 0, &si->free);
+			break;
+		case UBI_CKPT_PEB_ERASE:
+			err = ubi_scan_add_to_list(si, pnum, ec, 0, &si->erase);
+			break;
+		case UBI_CKPT_PEB_CORR:
+			err = ubi_scan_add_corrupted(si, pnum, ec);
+			break;
+		case UBI_CKPT_PEB_ALIEN:
+			/* This also counts it in @si->alien_peb_count */
+			err = ubi_scan_add_to_list(si, pnum, ec, 0, &si->alien);
+			break;
+		case UBI_CKPT_PEB_USED:
+			for (j = 0, v = vols; j < vol_count; j++, v++)
+				if (v->vol_id == peb->vol_id)
+					break;
+			if (j == vol_count)
+				return 1;
+
+			memset(vid_hdr, 0, UBI_VID_HDR_SIZE);
+			vid_hdr->vol_type = v->vol_type;
+			vid_hdr->compat = v->compat;
+			vid_hdr->vol_id = v->vol_id;
+			vid_hdr->lnum = peb->lnum;
+			vid_hdr->data_size = v->last_data_size;
+			vid_hdr->used_ebs = v->used_ebs;
+			vid_hdr->data_pad = v->data_pad;
+			err = ubi_scan_add_used(ubi, si, pnum, ec, vid_hdr,
+						peb->flags & UBI_CKPT_PEB_SCRUB);
+			si->peb_reads[pnum] = be16_to_cpu(peb->reads) <<
+					      UBI_CKPT_READS_SHIFT;
+			ckpt->reads += be16_to_cpu(peb->reads);
+			break;
+		case UBI_CKPT_PEB_CKPT:
+			for (j = 0; j <= ckpt->nr_blocks; j++)
+				if (ckpt->pnum[j] == pnum)
+					break;
+			if (j > ckpt->nr_blocks) {
+				if (ckpt->pnum[0] != -1)
+					return 1;
+				j = 0;
+			}
+			ckpt->pnum[j] = pnum;
+			ckpt->ec[j] = ec;
+			found += 1;
+			err = 0;
+			break;
+		default:
+			return 1;
+		}
+		if (err)
+			return err;
+
+		if (ec == UBI_SCAN_UNKNOWN_EC)
+			continue;
+		si->ec_sum += ec;
+		si->ec_count += 1;
+		if (ec > si->max_ec)
+			si->max_ec = ec;
+		if (ec < si->min_ec)
+			si->min_ec = ec;
+	}
+
+	if (found != ckpt->nr_blocks + 1)
+		return 1;
+
+	if (si->ec_count)
+		si->mean_ec = div_u64(si->ec_sum, si->ec_count);
+	list_for_each_entry(seb, &si->corr, u.list)
+		if (seb->ec == UBI_SCAN_UNKNOWN_EC)
+			seb->ec = si->mean_ec;
+	list_for_each_entry(seb, &si->alien, u.list)
+		if (seb->ec == UBI_SCAN_UNKNOWN_EC)
+			seb->ec = si->mean_ec;
+
+	si->max_sqnum = be64_to_cpu(hdr->sqnum);
+	return 0;
+}
+
+/**
+ * ubi_ckpt_scan - get scanning information from the checkpoint.
+ * @ubi: UBI device description object
+ *
+ * This function returns the scanning information built from the checkpoint,
+ * %NULL if there is no usable checkpoint and the MTD device has to be
+ * scanned, or an error pointer in case of failure.
+ */
+struct ubi_scan_info *ubi_ckpt_scan(struct ubi_device *ubi)
+{
+	struct ubi_ckpt *ckpt = ubi->ckpt;
+	struct ubi_scan_info *si = NULL;
+	struct ubi_vid_hdr *vid_hdr;
+	struct ubi_ckpt_hdr *hdr;
+	int err, anchor, anchor_ec = 0;
+	void *data;
+
+	if (!ckpt)
+		return NULL;
+
+	err = -ENOMEM;
+	hdr = kmalloc(ckpt->hdr_len, GFP_KERNEL);
+	if (!hdr)
+		goto out;
+
+	vid_hdr = ubi_zalloc_vid_hdr(ubi, GFP_KERNEL);
+	if (!vid_hdr)
+		goto out_hdr;
+
+	anchor = find_anchor(ubi, vid_hdr, &anchor_ec);
+	if (anchor == -ENOENT) {
+		ubi_msg("no checkpoint found");
+		err = 1;
+		goto out_vid_hdr;
+	}
+	if (anchor < 0) {
+		err = anchor;
+		goto out_vid_hdr;
+	}
+
+	err = read_ckpt(ubi, anchor, hdr, vid_hdr, &data);
+	if (err)
+		goto out_vid_hdr;
+
+	err = -ENOMEM;
+	si = ubi_scan_alloc_si();
+	if (!si)
+		goto out_data;
+
+	err = build_si(ubi, si, hdr, data, vid_hdr);
+	if (!err && ckpt->pnum[0] != anchor)
+		err = 1;
+	if (err) {
+		ubi_scan_destroy_si(si);
+		si = NULL;
+		goto out_data;
+	}
+
+	ckpt->ec[0] = anchor_ec;
+	ckpt->count = ckpt->nr_blocks + 1;
+	ckpt->valid = 1;
+	ubi_msg("attaching from the checkpoint in PEB %d", anchor);
+
+out_data:
+	vfree(data);
+out_vid_hdr:
+	ubi_free_vid_hdr(ubi, vid_hdr);
+out_hdr:
+	kfree(hdr);
+out:
+	if (err > 0) {
+		ubi_msg("scanning is needed");
+		memset(ckpt->state, 0, ubi->peb_count);
+		ckpt->count = 0;
+		return NULL;
+	}
+	if (err < 0) {
+		ubi_err("cannot read the checkpoint, error %d", err);
+		return ERR_PTR(err);
+	}
+	return si;
+}
+
+/**
+ * snapshot - make up the checkpoint.
+ * @ubi: UBI device description object
+ * @buf: buffer for the checkpoint data
+ * @hdr: the checkpoint header to fill in
+ * @pnum: the PEBs the checkpoint is going to be written to
+ * @ec: their erase counters
+ *
+ * This function has to be called with @ckpt->sem and @ubi->work_sem held for
+ * writing. Returns zero in case of success, %-EAGAIN if the checkpoint cannot
+ * be taken right now and other negative error codes in case of failure.
+ */
+static int snapshot(struct ubi_device *ubi, void *buf,
+		    struct ubi_ckpt_hdr *hdr, const int *pnum, const int *ec)
+{
+	struct ubi_ckpt *ckpt = ubi->ckpt;
+	struct ubi_ckpt_vol *v = buf;
+	struct ubi_ckpt_peb *pebs, *peb;
+	struct ubi_volume *vol;
+	int i, lnum, err = 0, vol_count = 0;
+
+	/* Volume records first, up to one per possible volume */
+	pebs = buf + (UBI_MAX_VOLUMES + UBI_INT_VOL_COUNT) *
+		     sizeof(struct ubi_ckpt_vol);
+	memset(pebs, 0xFF, ubi->peb_count * sizeof(struct ubi_ckpt_peb));
+	ubi_wl_ckpt_snapshot(ubi, pebs);
+
+	spin_lock(&ubi->volumes_lock);
+	for (i = 0; i < ubi->vtbl_slots + UBI_INT_VOL_COUNT; i++) {
+		vol = ubi->volumes[i];
+		if (!vol)
+			continue;
+		if (vol->updating || vol->changing_leb || vol->upd_marker ||
+		    vol->corrupted) {
+			err = -EAGAIN;
+			break;
+		}
+
+		memset(v, 0, sizeof(struct ubi_ckpt_vol));
+		v->vol_id = cpu_to_be32(vol->vol_id);
+		v->data_pad = cpu_to_be32(vol->data_pad);
+		if (vol->vol_type == UBI_STATIC_VOLUME) {
+			v->vol_type = UBI_VID_STATIC;
+			v->used_ebs = cpu_to_be32(vol->used_ebs);
+			v->last_data_size = cpu_to_be32(vol->last_eb_bytes);
+		} else
+			v->vol_type = UBI_VID_DYNAMIC;
+		if (vol->vol_id == UBI_LAYOUT_VOLUME_ID)
+			v->compat = UBI_LAYOUT_VOLUME_COMPAT;
+		v++;
+		vol_count += 1;
+
+		for (lnum = 0; lnum < vol->reserved_pebs; lnum++) {
+			if (vol->eba_tbl[lnum] < 0)
+				continue;
+
+			peb = &pebs[vol->eba_tbl[lnum]];
+			if (peb->state != UBI_CKPT_PEB_USED ||
+			    peb->lnum != cpu_to_be32(UBI_LEB_UNMAPPED)) {
+				err = -EAGAIN;
+				break;
+			}
+			peb->vol_id = cpu_to_be32(vol->vol_id);
+			peb->lnum = cpu_to_be32(lnum);
+		}
+		if (err)
+			break;
+	}
+	spin_unlock(&ubi->volumes_lock);
+	if (err) {
+		dbg_gen("volumes are changing, no checkpoint now");
+		return err;
+	}
+
+	/* Everything the WL sub-system does not know about */
+	for (i = 0; i < ubi->peb_count; i++) {
+		peb = &pebs[i];
+		if (peb->state == UBI_CKPT_PEB_USED) {
+			if (peb->lnum == cpu_to_be32(UBI_LEB_UNMAPPED)) {
+				dbg_gen("PEB %d is used but not mapped", i);
+				return -EAGAIN;
+			}
+			peb->reads = cpu_to_be16(ckpt_reads(ubi->peb_reads[i]));
+			continue;
+		}
+		peb->vol_id = peb->lnum = 0;
+		peb->reads = 0;
+		if (peb->state != 0xFF)
+			continue;
+
+		peb->flags = 0;
+		peb->ec = cpu_to_be32(-1);
+		if (ckpt->state[i] == UBI_CKPT_PEB_CORR ||
+		    ckpt->state[i] == UBI_CKPT_PEB_ALIEN) {
+			peb->state = ckpt->state[i];
+			continue;
+		}
+
+		for (lnum = 0; lnum <= ckpt->nr_blocks; lnum++)
+			if (pnum[lnum] == i)
+				break;
+		if (lnum <= ckpt->nr_blocks) {
+			peb->state = UBI_CKPT_PEB_CKPT;
+			peb->ec = cpu_to_be32(ec[lnum]);
+			continue;
+		}
+
+		for (lnum = 0; lnum < ckpt->count; lnum++)
+			if (ckpt->pnum[lnum] == i)
+				break;
+		if (lnum < ckpt->count) {
+			/* The previous checkpoint goes away */
+			peb->state = UBI_CKPT_PEB_ERASE;
+			peb->ec = cpu_to_be32(ckpt->ec[lnum]);
+			continue;
+		}
+
+		err = ubi_io_is_bad(ubi, i);
+		if (err < 0)
+			return err;
+		if (!err) {
+			ubi_err("PEB %d is not accounted for", i);
+			return -EINVAL;
+		}
+		peb->state = UBI_CKPT_PEB_BAD;
+	}
+
+	/* Close the gap between the volume and the PEB records */
+	memmove(v, pebs, ubi->peb_count * sizeof(struct ubi_ckpt_peb));
+
+	memset(hdr, 0, ckpt->hdr_len);
+	hdr->magic = cpu_to_be32(UBI_CKPT_HDR_MAGIC);
+	hdr->version = UBI_CKPT_VERSION;
+	hdr->image_seq = cpu_to_be32(ubi->image_seq);
+	hdr->peb_count = cpu_to_be32(ubi->peb_count);
+	hdr->vol_count = cpu_to_be32(vol_count);
+	hdr->nr_blocks = cpu_to_be32(ckpt->nr_blocks);
+	hdr->data_size = cpu_to_be32(vol_count * sizeof(struct ubi_ckpt_vol) +
+			ubi->peb_count * sizeof(struct ubi_ckpt_peb));
+	for (i = 0; i < ckpt->nr_blocks; i++) {
+		hdr->block_pnum[i] = cpu_to_be32(pnum[i + 1]);
+		hdr->block_ec[i] = cpu_to_be32(ec[i + 1]);
+	}
+	return 0;
+}
+
+/**
+ * write_blocks - write the checkpoint to the flash.
+ * @ubi: UBI device description object
+ * @buf: checkpoint data
+ * @hdr: checkpoint header
+ * @pnum: PEBs to write to, the anchor first
+ *
+ * The anchor is written last, so the checkpoint only exists once it is
+ * complete. Returns zero in case of success and a negative error code in
+ * case of failure.
+ */
+static int write_blocks(struct ubi_device *ubi, const void *buf,
+			struct ubi_ckpt_hdr *hdr, const int *pnum)
+{
+	struct ubi_ckpt *ckpt = ubi->ckpt;
+	int i, err, len, data_size = be32_to_cpu(hdr->data_size);
+	struct ubi_vid_hdr *vid_hdr;
+
+	vid_hdr = ubi_zalloc_vid_hdr(ubi, GFP_NOFS);
+	if (!vid_hdr)
+		return -ENOMEM;
+
+	vid_hdr->vol_type = UBI_VID_DYNAMIC;
+	vid_hdr->vol_id = cpu_to_be32(UBI_CKPT_VOLUME_ID);
+	vid_hdr->compat = UBI_CKPT_VOLUME_COMPAT;
+
+	for (i = 1; i <= ckpt->nr_blocks; i++) {
+		vid_hdr->lnum = cpu_to_be32(i);
+		vid_hdr->sqnum = cpu_to_be64(ubi_next_sqnum(ubi));
+		err = ubi_io_write_vid_hdr(ubi, pnum[i], vid_hdr);
+		if (err)
+			goto out;
+
+		len = data_size - (i - 1) * ubi->leb_size;
+		if (len <= 0)
+			continue;
+		len = ALIGN(min(len, ubi->leb_size), ubi->min_io_size);
+		err = ubi_io_write_data(ubi, buf + (i - 1) * ubi->leb_size,
+					pnum[i], 0, len);
+		if (err)
+			goto out;
+	}
+
+	/* The sequence number to continue from is above all of ours */
+	vid_hdr->lnum = cpu_to_be32(0);
+	vid_hdr->sqnum = cpu_to_be64(ubi_next_sqnum(ubi));
+	hdr->sqnum = cpu_to_be64(ubi_next_sqnum(ubi));
+	hdr->data_crc = cpu_to_be32(crc32(UBI_CRC32_INIT, buf, data_size));
+	hdr->hdr_crc = cpu_to_be32(crc32(UBI_CRC32_INIT, hdr,
+					 UBI_CKPT_HDR_SIZE_CRC));
+
+	err = ubi_io_write_vid_hdr(ubi, pnum[0], vid_hdr);
+	if (err)
+		goto out;
+	err = ubi_io_write_data(ubi, hdr, pnum[0], 0, ckpt->hdr_len);
+
+out:
+	ubi_free_vid_hdr(ubi, vid_hdr);
+	return err;
+}
+
+/**
+ * ckpt_write - bring the checkpoint on the flash up to date.
+ * @ubi: UBI device description object
+ * @force: write a new checkpoint even if the current one is valid
+ *
+ * This function writes a new checkpoint if the current one is stale, there
+ * is none or @force is set. Returns zero in case of success, %-EAGAIN if it
+ * has to be retried later and other negative error codes in case of failure.
+ */
+static int ckpt_write(struct ubi_device *ubi, int force)
+{
+	struct ubi_ckpt *ckpt = ubi->ckpt;
+	int i, err = 0, count = ckpt->nr_blocks + 1, flushed = 0;
+	int pnum[UBI_CKPT_MAX_BLOCKS + 1], ec[UBI_CKPT_MAX_BLOCKS + 1];
+	int old_pnum[UBI_CKPT_MAX_BLOCKS + 1], old_ec[UBI_CKPT_MAX_BLOCKS + 1];
+	int old_count;
+	struct ubi_ckpt_hdr *hdr;
+	struct ubi_ckpt_peb *pebs;
+	void *buf;
+
+	if ((ckpt->valid && !force) || ubi->ro_mode)
+		return 0;
+
+	hdr = kmalloc(ckpt->hdr_len, GFP_KERNEL);
+	if (!hdr)
+		return -ENOMEM;
+
+	buf = vmalloc(ckpt->nr_blocks * ubi->leb_size);
+	if (!buf) {
+		kfree(hdr);
+		return -ENOMEM;
+	}
+
+	/* Volumes must not be created, removed or re-sized meanwhile */
+	mutex_lock(&ubi->device_mutex);
+
+	for (i = 0; i < count; i++) {
+		pnum[i] = ubi_wl_get_ckpt_peb(ubi, i ? ubi->peb_count :
+					      UBI_CKPT_MAX_START, &ec[i]);
+		if (pnum[i] == -ENOSPC && !flushed) {
+			/* Maybe some PEBs are just waiting to be erased */
+			flushed = 1;
+			err = ubi_wl_flush(ubi);
+			if (err)
+				break;
+			i -= 1;
+			continue;
+		}
+		if (pnum[i] < 0) {
+			err = pnum[i];
+			break;
+		}
+	}
+	if (i < count) {
+		if (err == -ENOSPC)
+			ubi_warn("no free PEBs for the checkpoint");
+		count = i;
+		goto out_put;
+	}
+
+	down_write(&ckpt->sem);
+	down_write(&ubi->work_sem);
+
+	err = snapshot(ubi, buf, hdr, pnum, ec);
+	if (!err)
+		err = write_blocks(ubi, buf, hdr, pnum);
+	if (err) {
+		up_write(&ubi->work_sem);
+		up_write(&ckpt->sem);
+		goto out_put;
+	}
+
+	old_count = ckpt->count;
+	memcpy(old_pnum, ckpt->pnum, sizeof(old_pnum));
+	memcpy(old_ec, ckpt->ec, sizeof(old_ec));
+
+	pebs = buf + be32_to_cpu(hdr->vol_count) * sizeof(struct ubi_ckpt_vol);
+	mutex_lock(&ckpt->mutex);
+	ckpt->reads = 0;
+	for (i = 0; i < ubi->peb_count; i++) {
+		ckpt->state[i] = pebs[i].state;
+		ckpt->reads += be16_to_cpu(pebs[i].reads);
+	}
+	memcpy(ckpt->pnum, pnum, sizeof(pnum));
+	memcpy(ckpt->ec, ec, sizeof(ec));
+	ckpt->count = count;
+	ckpt->valid = 1;
+	ckpt->dirty = 0;
+	mutex_unlock(&ckpt->mutex);
+
+	up_write(&ubi->work_sem);
+	up_write(&ckpt->sem);
+	mutex_unlock(&ubi->device_mutex);
+
+	dbg_gen("checkpoint written, anchor PEB %d", pnum[0]);
+
+	/* The new checkpoint records these as "to be erased" */
+	for (i = 0; i < old_count; i++)
+		ubi_wl_put_ckpt_peb(ubi, old_pnum[i], old_ec[i], 0);
+
+	vfree(buf);
+	kfree(hdr);
+	return 0;
+
+out_put:
+	for (i = 0; i < count; i++)
+		ubi_wl_put_ckpt_peb(ubi, pnum[i], ec[i], err == -EIO);
+	mutex_unlock(&ubi->device_mutex);
+	vfree(buf);
+	kfree(hdr);
+	return err;
+}
+
+static void ckpt_work(struct work_struct *work)
+{
+	struct ubi_ckpt *ckpt = container_of(work, struct ubi_ckpt, work.work);
+	int err;
+
+	if (!ckpt->dirty)
+		goto out;
+
+	err = ckpt_write(ckpt->ubi, 0);
+	if (err && err != -EAGAIN)
+		ubi_warn("cannot write the checkpoint, error %d", err);
+
+out:
+
+	if (ckpt_interval)
+		schedule_delayed_work(&ckpt->work, ckpt_interval * HZ);
+}
+
+static int ckpt_reboot(struct notifier_block *nb, unsigned long event,
+		       void *unused)
+{
+	struct ubi_ckpt *ckpt = container_of(nb, struct ubi_ckpt, reboot);
+	struct ubi_device *ubi = ckpt->ubi;
+	int err;
+
+	cancel_delayed_work_sync(&ckpt->work);
+	err = ckpt_write(ubi, reads_changed(ubi));
+	if (err)
+		ubi_warn("cannot write the checkpoint, error %d", err);
+	return NOTIFY_DONE;
+}
+
+/**
+ * ubi_ckpt_init - initialize the checkpoint sub-system.
+ * @ubi: UBI device description object
+ *
+ * This function is called before attaching. If the checkpoint would not fit
+ * into %UBI_CKPT_MAX_BLOCKS PEBs, the sub-system stays disabled. Returns
+ * zero in case of success and a negative error code in case of failure.
+ */
+int ubi_ckpt_init(struct ubi_device *ubi)
+{
+	struct ubi_ckpt *ckpt;
+	int nr_blocks, hdr_len;
+
+	nr_blocks = DIV_ROUND_UP((UBI_MAX_VOLUMES + UBI_INT_VOL_COUNT) *
+				 sizeof(struct ubi_ckpt_vol) +
+				 ubi->peb_count * sizeof(struct ubi_ckpt_peb),
+				 ubi->leb_size);
+	hdr_len = ALIGN(sizeof(struct ubi_ckpt_hdr), ubi->min_io_size);
+	if (nr_blocks > UBI_CKPT_MAX_BLOCKS ||
+	    hdr_len + ubi->min_io_size > ubi->leb_size) {
+		ubi_warn("checkpoint does not fit, fast attach disabled");
+		return 0;
+	}
+
+	ckpt = kzalloc(sizeof(struct ubi_ckpt), GFP_KERNEL);
+	if (!ckpt)
+		return -ENOMEM;
+
+	ckpt->state = kzalloc(ubi->peb_count, GFP_KERNEL);
+	ckpt->marker = kzalloc(ubi->min_io_size, GFP_KERNEL);
+	if (!ckpt->state || !ckpt->marker) {
+		kfree(ckpt->state);
+		kfree(ckpt->marker);
+		kfree(ckpt);
+		return -ENOMEM;
+	}
+
+	ckpt->ubi = ubi;
+	ckpt->nr_blocks = nr_blocks;
+	ckpt->hdr_len = hdr_len;
+	init_rwsem(&ckpt->sem);
+	mutex_init(&ckpt->mutex);
+	INIT_DELAYED_WORK(&ckpt->work, ckpt_work);
+	ubi->ckpt = ckpt;
+	return 0;
+}
+
+/**
+ * ubi_ckpt_attach - start maintaining the checkpoint.
+ * @ubi: UBI device description object
+ * @si: scanning information
+ *
+ * This function is called once the EBA and WL sub-systems are initialized.
+ * It reserves PEBs for the checkpoint, or disables fast attach if there are
+ * not enough of them. Returns zero in case of success and a negative error
+ * code in case of failure.
+ */
+int ubi_ckpt_attach(struct ubi_device *ubi, struct ubi_scan_info *si)
+{
+	struct ubi_ckpt *ckpt = ubi->ckpt;
+	struct ubi_scan_leb *seb;
+	int i, err, reserve;
+
+	if (!ckpt)
+		return 0;
+
+	/* Room for the current checkpoint and for the one replacing it */
+	reserve = 2 * (ckpt->nr_blocks + 1);
+	if (ubi->avail_pebs < reserve) {
+		ubi_warn("no PEBs for the checkpoint (%d, need %d), "
+			 "fast attach disabled", ubi->avail_pebs, reserve);
+		if (ckpt->valid) {
+			err = mark_stale(ubi);
+			if (err)
+				return err;
+		}
+		for (i = 0; i < ckpt->count; i++) {
+			err = ubi_wl_put_ckpt_peb(ubi, ckpt->pnum[i],
+						  ckpt->ec[i], 0);
+			if (err)
+				return err;
+		}
+		ubi_ckpt_free(ubi);
+		return 0;
+	}
+	ubi->avail_pebs -= reserve;
+	ubi->rsvd_pebs += reserve;
+
+	/* These stay as they are until the next scan */
+	list_for_each_entry(seb, &si->corr, u.list)
+		ckpt->state[seb->pnum] = UBI_CKPT_PEB_CORR;
+	list_for_each_entry(seb, &si->alien, u.list)
+		ckpt->state[seb->pnum] = UBI_CKPT_PEB_ALIEN;
+
+	ckpt->reboot.notifier_call = ckpt_reboot;
+	register_reboot_notifier(&ckpt->reboot);
+
+	if (ckpt_interval)
+		schedule_delayed_work(&ckpt->work, ckpt_interval * HZ);
+	return 0;
+}
+
+/**
+ * ubi_ckpt_close - write the final checkpoint and close the sub-system.
+ * @ubi: UBI device description object
+ *
+ * This function is called when the device is detached, after all users are
+ * gone but while the EBA and WL sub-systems are still there.
+ */
+void ubi_ckpt_close(struct ubi_device *ubi)
+{
+	struct ubi_ckpt *ckpt = ubi->ckpt;
+	int err;
+
+	if (!ckpt)
+		return;
+
+	/* Make sure a reboot does not write it meanwhile */
+	if (ckpt->reboot.notifier_call) {
+		unregister_reboot_notifier(&ckpt->reboot);
+		ckpt->reboot.notifier_call = NULL;
+	}
+	cancel_delayed_work_sync(&ckpt->work);
+	err = ckpt_write(ubi, reads_changed(ubi));
+	if (err)
+		ubi_warn("cannot write the checkpoint, error %d", err);
+	ubi_ckpt_free(ubi);
+}
+
+/**
+ * ubi_ckpt_free - free checkpoint information.
+ * @ubi: UBI device description object
+ */
+void ubi_ckpt_free(struct ubi_device *ubi)
+{
+	struct ubi_ckpt *ckpt = ubi->ckpt;
+
+	if (!ckpt)
+		return;
+
+	if (ckpt->reboot.notifier_call)
+		unregister_reboot_notifier(&ckpt->reboot);
+	cancel_delayed_work_sync(&ckpt->work);
+	ubi->ckpt = NULL;
+	kfree(ckpt->state);
+	kfree(ckpt->marker);
+	kfree(ckpt);
+}
@@ -50,14 +50,14 @@
 #define EBA_RESERVED_PEBS 1
 
 /**
- * next_sqnum - get next sequence number.
+ * ubi_next_sqnum - get next sequence number.
  * @ubi: UBI device description object
  *
  * This function returns next sequence number to use, which is just the current
  * global sequence counter value. It also increases the global sequence
  * counter.
  */
-static unsigned long long next_sqnum(struct ubi_device *ubi)
+unsigned long long ubi_next_sqnum(struct ubi_device *ubi)
 {
 	unsigned long long sqnum;
 
@@ -311,6 +311,40 @@ static void leb_write_unlock(struct ubi_device *ubi, int vol_id, int lnum)
 	spin_unlock(&ubi->ltree_lock);
 }
 
+/**
+ * leb_map_lock - lock logical eraseblock for changing its mapping.
+ * @ubi: UBI device description object
+ * @vol_id: volume ID
+ * @lnum: logical eraseblock number
+ *
+ * This is 'leb_write_lock()' which also keeps the checkpoint from being
+ * written while the LEB is being (re-)mapped. Returns zero in case of
+ * success and a negative error code in case of failure.
+ */
+static int leb_map_lock(struct ubi_device *ubi, int vol_id, int lnum)
+{
+	int err;
+
+	err = leb_write_lock(ubi, vol_id, lnum);
+	if (err)
+		return err;
+
+	ubi_ckpt_read_lock(ubi);
+	return 0;
+}
+
+/**
+ * leb_map_unlock - unlock logical eraseblock locked by 'leb_map_lock()'.
+ * @ubi: UBI device description object
+ * @vol_id: volume ID
+ * @lnum: logical eraseblock number
+ */
+static void leb_map_unlock(struct ubi_device *ubi, int vol_id, int lnum)
+{
+	ubi_ckpt_read_unlock(ubi);
+	leb_write_unlock(ubi, vol_id, lnum);
+}
+
 /**
  * ubi_eba_unmap_leb - un-map logical eraseblock.
  * @ubi: UBI device description object
@@ -329,7 +363,7 @@ int ubi_eba_unmap_leb(struct ubi_device *ubi, struct ubi_volume *vol,
 	if (ubi->ro_mode)
 		return -EROFS;
 
-	err = leb_write_lock(ubi, vol_id, lnum);
+	err = leb_map_lock(ubi, vol_id, lnum);
 	if (err)
 		return err;
 
@@ -344,7 +378,7 @@ int ubi_eba_unmap_leb(struct ubi_device *ubi, struct ubi_volume *vol,
 	err = ubi_wl_put_peb(ubi, pnum, 0);
 
 out_unlock:
-	leb_write_unlock(ubi, vol_id, lnum);
+	leb_map_unlock(ubi, vol_id, lnum);
 	return err;
 }
 
@@ -439,6 +473,7 @@ retry:
 	}
 
 	err = ubi_io_read_data(ubi, buf, pnum, offset, len);
+	ubi_wl_read_done(ubi, pnum, len);
 	if (err) {
 		if (err == UBI_IO_BITFLIPS) {
 			scrub = 1;
@@ -522,7 +557,7 @@ retry:
 		goto out_put;
 	}
 
-	vid_hdr->sqnum = cpu_to_be64(next_sqnum(ubi));
+	vid_hdr->sqnum = cpu_to_be64(ubi_next_sqnum(ubi));
 	err = ubi_io_write_vid_hdr(ubi, new_pnum, vid_hdr);
 	if (err)
 		goto write_error;
@@ -600,8 +635,9 @@ int ubi_eba_write_leb(struct ubi_device *ubi, struct ubi_volume *vol, int lnum,
 
 	if (ubi->ro_mode)
 		return -EROFS;
+	ubi->last_io = jiffies;
 
-	err = leb_write_lock(ubi, vol_id, lnum);
+	err = leb_map_lock(ubi, vol_id, lnum);
 	if (err)
 		return err;
 
@@ -619,7 +655,7 @@ int ubi_eba_write_leb(struct ubi_device *ubi, struct ubi_volume *vol, int lnum,
 			if (err)
 				ubi_ro_mode(ubi);
 		}
-		leb_write_unlock(ubi, vol_id, lnum);
+		leb_map_unlock(ubi, vol_id, lnum);
 		return err;
 	}
 
@@ -629,12 +665,12 @@ int ubi_eba_write_leb(struct ubi_device *ubi, struct ubi_volume *vol, int lnum,
 	 */
 	vid_hdr = ubi_zalloc_vid_hdr(ubi, GFP_NOFS);
 	if (!vid_hdr) {
-		leb_write_unlock(ubi, vol_id, lnum);
+		leb_map_unlock(ubi, vol_id, lnum);
 		return -ENOMEM;
 	}
 
 	vid_hdr->vol_type = UBI_VID_DYNAMIC;
-	vid_hdr->sqnum = cpu_to_be64(next_sqnum(ubi));
+	vid_hdr->sqnum = cpu_to_be64(ubi_next_sqnum(ubi));
 	vid_hdr->vol_id = cpu_to_be32(vol_id);
 	vid_hdr->lnum = cpu_to_be32(lnum);
 	vid_hdr->compat = ubi_get_compat(ubi, vol_id);
@@ -644,7 +680,7 @@ retry:
 	pnum = ubi_wl_get_peb(ubi, dtype);
 	if (pnum < 0) {
 		ubi_free_vid_hdr(ubi, vid_hdr);
-		leb_write_unlock(ubi, vol_id, lnum);
+		leb_map_unlock(ubi, vol_id, lnum);
 		return pnum;
 	}
 
@@ -670,14 +706,14 @@ retry:
 
 	vol->eba_tbl[lnum] = pnum;
 
-	leb_write_unlock(ubi, vol_id, lnum);
+	leb_map_unlock(ubi, vol_id, lnum);
 	ubi_free_vid_hdr(ubi, vid_hdr);
 	return 0;
 
 write_error:
 	if (err != -EIO || !ubi->bad_allowed) {
 		ubi_ro_mode(ubi);
-		leb_write_unlock(ubi, vol_id, lnum);
+		leb_map_unlock(ubi, vol_id, lnum);
 		ubi_free_vid_hdr(ubi, vid_hdr);
 		return err;
 	}
@@ -690,12 +726,12 @@ write_error:
 	err = ubi_wl_put_peb(ubi, pnum, 1);
 	if (err || ++tries > UBI_IO_RETRIES) {
 		ubi_ro_mode(ubi);
-		leb_write_unlock(ubi, vol_id, lnum);
+		leb_map_unlock(ubi, vol_id, lnum);
 		ubi_free_vid_hdr(ubi, vid_hdr);
 		return err;
 	}
 
-	vid_hdr->sqnum = cpu_to_be64(next_sqnum(ubi));
+	vid_hdr->sqnum = cpu_to_be64(ubi_next_sqnum(ubi));
 	ubi_msg("try another PEB");
 	goto retry;
 }
@@ -733,6 +769,7 @@ int ubi_eba_write_leb_st(struct ubi_device *ubi, struct ubi_volume *vol,
 
 	if (ubi->ro_mode)
 		return -EROFS;
+	ubi->last_io = jiffies;
 
 	if (lnum == used_ebs - 1)
 		/* If this is the last LEB @len may be unaligned */
@@ -744,13 +781,13 @@ int ubi_eba_write_leb_st(struct ubi_device *ubi, struct ubi_volume *vol,
 	if (!vid_hdr)
 		return -ENOMEM;
 
-	err = leb_write_lock(ubi, vol_id, lnum);
+	err = leb_map_lock(ubi, vol_id, lnum);
 	if (err) {
 		ubi_free_vid_hdr(ubi, vid_hdr);
 		return err;
 	}
 
-	vid_hdr->sqnum = cpu_to_be64(next_sqnum(ubi));
+	vid_hdr->sqnum = cpu_to_be64(ubi_next_sqnum(ubi));
 	vid_hdr->vol_id = cpu_to_be32(vol_id);
 	vid_hdr->lnum = cpu_to_be32(lnum);
 	vid_hdr->compat = ubi_get_compat(ubi, vol_id);
@@ -766,7 +803,7 @@ retry:
 	pnum = ubi_wl_get_peb(ubi, dtype);
 	if (pnum < 0) {
 		ubi_free_vid_hdr(ubi, vid_hdr);
-		leb_write_unlock(ubi, vol_id, lnum);
+		leb_map_unlock(ubi, vol_id, lnum);
 		return pnum;
 	}
 
@@ -790,7 +827,7 @@ retry:
 	ubi_assert(vol->eba_tbl[lnum] < 0);
 	vol->eba_tbl[lnum] = pnum;
 
-	leb_write_unlock(ubi, vol_id, lnum);
+	leb_map_unlock(ubi, vol_id, lnum);
 	ubi_free_vid_hdr(ubi, vid_hdr);
 	return 0;
 
@@ -802,7 +839,7 @@ write_error:
 		 * mode just in case.
 		 */
 		ubi_ro_mode(ubi);
-		leb_write_unlock(ubi, vol_id, lnum);
+		leb_map_unlock(ubi, vol_id, lnum);
 		ubi_free_vid_hdr(ubi, vid_hdr);
 		return err;
 	}
@@ -810,12 +847,12 @@ write_error:
 	err = ubi_wl_put_peb(ubi, pnum, 1);
 	if (err || ++tries > UBI_IO_RETRIES) {
 		ubi_ro_mode(ubi);
-		leb_write_unlock(ubi, vol_id, lnum);
+		leb_map_unlock(ubi, vol_id, lnum);
 		ubi_free_vid_hdr(ubi, vid_hdr);
 		return err;
 	}
 
-	vid_hdr->sqnum = cpu_to_be64(next_sqnum(ubi));
+	vid_hdr->sqnum = cpu_to_be64(ubi_next_sqnum(ubi));
 	ubi_msg("try another PEB");
 	goto retry;
 }
@@ -847,6 +884,7 @@ int ubi_eba_atomic_leb_change(struct ubi_device *ubi, struct ubi_volume *vol,
 
 	if (ubi->ro_mode)
 		return -EROFS;
+	ubi->last_io = jiffies;
 
 	if (len == 0) {
 		/*
@@ -864,11 +902,11 @@ int ubi_eba_atomic_leb_change(struct ubi_device *ubi, struct ubi_volume *vol,
 		return -ENOMEM;
 
 	mutex_lock(&ubi->alc_mutex);
-	err = leb_write_lock(ubi, vol_id, lnum);
+	err = leb_map_lock(ubi, vol_id, lnum);
 	if (err)
 		goto out_mutex;
 
-	vid_hdr->sqnum = cpu_to_be64(next_sqnum(ubi));
+	vid_hdr->sqnum = cpu_to_be64(ubi_next_sqnum(ubi));
 	vid_hdr->vol_id = cpu_to_be32(vol_id);
 	vid_hdr->lnum = cpu_to_be32(lnum);
 	vid_hdr->compat = ubi_get_compat(ubi, vol_id);
@@ -913,7 +951,7 @@ retry:
 	vol->eba_tbl[lnum] = pnum;
 
 out_leb_unlock:
-	leb_write_unlock(ubi, vol_id, lnum);
+	leb_map_unlock(ubi, vol_id, lnum);
 out_mutex:
 	mutex_unlock(&ubi->alc_mutex);
 	ubi_free_vid_hdr(ubi, vid_hdr);
@@ -936,7 +974,7 @@ write_error:
 		goto out_leb_unlock;
 	}
 
-	vid_hdr->sqnum = cpu_to_be64(next_sqnum(ubi));
+	vid_hdr->sqnum = cpu_to_be64(ubi_next_sqnum(ubi));
 	ubi_msg("try another PEB");
 	goto retry;
 }
@@ -1096,7 +1134,7 @@ int ubi_eba_copy_leb(struct ubi_device *ubi, int from, int to,
 		vid_hdr->data_size = cpu_to_be32(data_size);
 		vid_hdr->data_crc = cpu_to_be32(crc);
 	}
-	vid_hdr->sqnum = cpu_to_be64(next_sqnum(ubi));
+	vid_hdr->sqnum = cpu_to_be64(ubi_next_sqnum(ubi));
 
 	err = ubi_io_write_vid_hdr(ubi, to, vid_hdr);
 	if (err) {
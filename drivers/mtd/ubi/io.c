@@ -598,6 +598,10 @@ int ubi_io_sync_erase(struct ubi_device *ubi, int pnum, int torture)
 		return -EROFS;
 	}
 
+	err = ubi_ckpt_invalidate(ubi, pnum, 1);
+	if (err)
+		return err;
+
 	if (ubi->nor_flash) {
 		err = nor_erase_prepare(ubi, pnum);
 		if (err)
@@ -654,7 +658,7 @@ int ubi_io_is_bad(const struct ubi_device *ubi, int pnum)
  * This function returns zero in case of success and a negative error code in
  * case of failure.
  */
-int ubi_io_mark_bad(const struct ubi_device *ubi, int pnum)
+int ubi_io_mark_bad(struct ubi_device *ubi, int pnum)
 {
 	int err;
 	struct mtd_info *mtd = ubi->mtd;
@@ -669,6 +673,10 @@ int ubi_io_mark_bad(const struct ubi_device *ubi, int pnum)
 	if (!ubi->bad_allowed)
 		return 0;
 
+	err = ubi_ckpt_invalidate(ubi, pnum, 0);
+	if (err)
+		return err;
+
 	err = mtd_block_markbad(mtd, (loff_t)pnum * ubi->peb_size);
 	if (err)
 		ubi_err("cannot mark PEB %d bad, error %d", pnum, err);
@@ -1125,6 +1133,10 @@ int ubi_io_write_vid_hdr(struct ubi_device *ubi, int pnum,
 	if (err)
 		return err;
 
+	err = ubi_ckpt_invalidate(ubi, pnum, 0);
+	if (err)
+		return err;
+
 	p = (char *)vid_hdr - ubi->vid_hdr_shift;
 	err = ubi_io_write(ubi, p, pnum, ubi->vid_hdr_aloffset,
 			   ubi->vid_hdr_alsize);
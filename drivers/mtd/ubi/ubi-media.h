@@ -312,6 +312,15 @@ struct ubi_vid_hdr {
 #define UBI_LAYOUT_VOLUME_NAME   "layout volume"
 #define UBI_LAYOUT_VOLUME_COMPAT UBI_COMPAT_REJECT
 
+/*
+ * The checkpoint volume holds a copy of the attach information (see
+ * &struct ubi_ckpt_hdr). It is not a real volume: it has no volume table
+ * record and its physical eraseblocks are not managed by the wear-leveling
+ * sub-system. Implementations which do not know about it simply erase it.
+ */
+#define UBI_CKPT_VOLUME_ID     (UBI_LAYOUT_VOLUME_ID + 1)
+#define UBI_CKPT_VOLUME_COMPAT UBI_COMPAT_DELETE
+
 /* The maximum number of volumes per one UBI device */
 #define UBI_MAX_VOLUMES 128
 
@@ -375,4 +384,136 @@ struct ubi_vtbl_record {
 	__be32  crc;
 } __packed;
 
+/* Checkpoint header magic number (ASCII "UBIC") */
+#define UBI_CKPT_HDR_MAGIC 0x55424943
+
+/* Version of the checkpoint format */
+#define UBI_CKPT_VERSION 1
+
+/* The checkpoint anchor must be one of the first so many PEBs */
+#define UBI_CKPT_MAX_START 64
+
+/* Maximum count of PEBs holding checkpoint data */
+#define UBI_CKPT_MAX_BLOCKS 32
+
+/* Size of the checkpoint header without the ending CRC */
+#define UBI_CKPT_HDR_SIZE_CRC (sizeof(struct ubi_ckpt_hdr) - sizeof(__be32))
+
+/*
+ * States of physical eraseblocks in the checkpoint.
+ *
+ * @UBI_CKPT_PEB_FREE: erased, has a valid EC header
+ * @UBI_CKPT_PEB_ERASE: has to be erased
+ * @UBI_CKPT_PEB_USED: maps a logical eraseblock
+ * @UBI_CKPT_PEB_CORR: corrupted
+ * @UBI_CKPT_PEB_ALIEN: belongs to a preserved unknown internal volume
+ * @UBI_CKPT_PEB_BAD: bad
+ * @UBI_CKPT_PEB_CKPT: holds this checkpoint
+ */
+enum {
+	UBI_CKPT_PEB_FREE = 1,
+	UBI_CKPT_PEB_ERASE,
+	UBI_CKPT_PEB_USED,
+	UBI_CKPT_PEB_CORR,
+	UBI_CKPT_PEB_ALIEN,
+	UBI_CKPT_PEB_BAD,
+	UBI_CKPT_PEB_CKPT,
+};
+
+/* Flags of checkpoint PEB records: the PEB has to be scrubbed */
+#define UBI_CKPT_PEB_SCRUB 0x01
+
+/* Checkpoint PEB records count pages read in units of 1 << this */
+#define UBI_CKPT_READS_SHIFT 4
+
+/**
+ * struct ubi_ckpt_hdr - checkpoint header.
+ * @magic: checkpoint header magic number (%UBI_CKPT_HDR_MAGIC)
+ * @version: checkpoint format version (%UBI_CKPT_VERSION)
+ * @padding1: reserved for future, zeroes
+ * @image_seq: image sequence number of the UBI device
+ * @peb_count: count of PEB records
+ * @vol_count: count of volume records
+ * @nr_blocks: how many PEBs hold checkpoint data
+ * @data_size: size of the checkpoint data
+ * @data_crc: CRC32 checksum of the checkpoint data
+ * @sqnum: the sequence number to continue from after attaching
+ * @padding2: reserved for future, zeroes
+ * @block_pnum: PEBs holding the checkpoint data, in order
+ * @block_ec: erase counters of those PEBs
+ * @hdr_crc: header CRC checksum
+ *
+ * A checkpoint is a snapshot of what the scanning code would have found on
+ * the flash, so that attaching does not have to read the headers of every
+ * PEB. The header lives at the start of the data area of the "anchor" PEB,
+ * which maps logical eraseblock 0 of the checkpoint volume and has to be one
+ * of the first %UBI_CKPT_MAX_START PEBs. The data PEBs map logical
+ * eraseblocks 1 and up and contain @vol_count &struct ubi_ckpt_vol records
+ * followed by @peb_count &struct ubi_ckpt_peb records.
+ *
+ * The checkpoint is only correct as long as nothing changes on the flash,
+ * so the first change after writing it (a VID header write, an erasure or a
+ * PEB being marked bad) writes the min. I/O unit following the header in
+ * the anchor PEB. A checkpoint whose anchor has anything but 0xFF bytes
+ * there is stale, and UBI falls back to scanning.
+ */
+struct ubi_ckpt_hdr {
+	__be32  magic;
+	__u8    version;
+	__u8    padding1[3];
+	__be32  image_seq;
+	__be32  peb_count;
+	__be32  vol_count;
+	__be32  nr_blocks;
+	__be32  data_size;
+	__be32  data_crc;
+	__be64  sqnum;
+	__u8    padding2[24];
+	__be32  block_pnum[UBI_CKPT_MAX_BLOCKS];
+	__be32  block_ec[UBI_CKPT_MAX_BLOCKS];
+	__be32  hdr_crc;
+} __packed;
+
+/**
+ * struct ubi_ckpt_vol - a volume record in the checkpoint.
+ * @vol_id: volume ID
+ * @used_ebs: total number of used LEBs (static volumes only)
+ * @data_pad: how many bytes at the end of LEBs are not used
+ * @last_data_size: bytes of data in the last LEB (static volumes only)
+ * @vol_type: %UBI_VID_DYNAMIC or %UBI_VID_STATIC
+ * @compat: compatibility flags of internal volumes
+ * @padding: reserved for future, zeroes
+ */
+struct ubi_ckpt_vol {
+	__be32  vol_id;
+	__be32  used_ebs;
+	__be32  data_pad;
+	__be32  last_data_size;
+	__u8    vol_type;
+	__u8    compat;
+	__u8    padding[14];
+} __packed;
+
+/**
+ * struct ubi_ckpt_peb - a physical eraseblock record in the checkpoint.
+ * @ec: erase counter, or %-1 if unknown
+ * @vol_id: volume ID (%UBI_CKPT_PEB_USED only)
+ * @lnum: logical eraseblock number (%UBI_CKPT_PEB_USED only)
+ * @state: one of the %UBI_CKPT_PEB_* states
+ * @flags: %UBI_CKPT_PEB_SCRUB
+ * @reads: pages read since the PEB was erased, in units of
+ *         (1 << %UBI_CKPT_READS_SHIFT) and saturating (%UBI_CKPT_PEB_USED
+ *         only, zero otherwise)
+ *
+ * Records are indexed by PEB number.
+ */
+struct ubi_ckpt_peb {
+	__be32  ec;
+	__be32  vol_id;
+	__be32  lnum;
+	__u8    state;
+	__u8    flags;
+	__be16  reads;
+} __packed;
+
 #endif /* !__UBI_MEDIA_H__ */
@@ -343,7 +343,7 @@ struct ubi_wl_entry;
  * @pq_head: protection queue head
  * @wl_lock: protects the @used, @free, @pq, @pq_head, @lookuptbl, @move_from,
  *	     @move_to, @move_to_put @erase_pending, @wl_scheduled, @works,
- *	     @erroneous, and @erroneous_peb_count fields
+ *	     @erroneous, @erroneous_peb_count and @read_scrubs fields
  * @move_mutex: serializes eraseblock moves
  * @work_sem: synchronizes the WL worker with use tasks
  * @wl_scheduled: non-zero if the wear-leveling was scheduled
@@ -357,6 +357,10 @@ struct ubi_wl_entry;
  * @bgt_thread: background thread description object
  * @thread_enabled: if the background thread is enabled
  * @bgt_name: background thread name
+ * @peb_reads: per-PEB count of pages read since the last erasure
+ * @last_io: time (in jiffies) of the last read or write through the EBA
+ *           sub-system, used to find idle periods for read scrubbing
+ * @read_scrubs: how many PEBs were scrubbed because of their read count
  *
  * @flash_size: underlying MTD device size (in bytes)
  * @peb_count: count of physical eraseblocks on the MTD device
@@ -392,6 +396,8 @@ struct ubi_wl_entry;
  * @buf_mutex: protects @peb_buf1 and @peb_buf2
  * @ckvol_mutex: serializes static volume checking when opening
  *
+ * @ckpt: fast attach checkpoint information (%NULL if not used)
+ *
  * @dbg: debugging information for this UBI device
  */
 struct ubi_device {
@@ -446,6 +452,9 @@ struct ubi_device {
 	struct task_struct *bgt_thread;
 	int thread_enabled;
 	char bgt_name[sizeof(UBI_BGT_NAME_PATTERN)+2];
+	unsigned int *peb_reads;
+	unsigned long last_io;
+	int read_scrubs;
 
 	/* I/O sub-system's stuff */
 	long long flash_size;
@@ -476,6 +485,8 @@ struct ubi_device {
 	struct mutex buf_mutex;
 	struct mutex ckvol_mutex;
 
+	struct ubi_ckpt *ckpt;
+
 	struct ubi_debug_info *dbg;
 };
 
@@ -522,6 +533,7 @@ void ubi_calculate_reserved(struct ubi_device *ubi);
 int ubi_check_pattern(const void *buf, uint8_t patt, int size);
 
 /* eba.c */
+unsigned long long ubi_next_sqnum(struct ubi_device *ubi);
 int ubi_eba_unmap_leb(struct ubi_device *ubi, struct ubi_volume *vol,
 		      int lnum);
 int ubi_eba_read_leb(struct ubi_device *ubi, struct ubi_volume *vol, int lnum,
@@ -542,9 +554,15 @@ int ubi_wl_get_peb(struct ubi_device *ubi, int dtype);
 int ubi_wl_put_peb(struct ubi_device *ubi, int pnum, int torture);
 int ubi_wl_flush(struct ubi_device *ubi);
 int ubi_wl_scrub_peb(struct ubi_device *ubi, int pnum);
+void ubi_wl_read_done(struct ubi_device *ubi, int pnum, int len);
 int ubi_wl_init_scan(struct ubi_device *ubi, struct ubi_scan_info *si);
 void ubi_wl_close(struct ubi_device *ubi);
 int ubi_thread(void *u);
+#ifdef CONFIG_MTD_UBI_CHECKPOINT
+int ubi_wl_get_ckpt_peb(struct ubi_device *ubi, int max_pnum, int *ec);
+int ubi_wl_put_ckpt_peb(struct ubi_device *ubi, int pnum, int ec, int torture);
+void ubi_wl_ckpt_snapshot(struct ubi_device *ubi, struct ubi_ckpt_peb *pebs);
+#endif
 
 /* io.c */
 int ubi_io_read(const struct ubi_device *ubi, void *buf, int pnum, int offset,
@@ -553,7 +571,7 @@ int ubi_io_write(struct ubi_device *ubi, const void *buf, int pnum, int offset,
 		 int len);
 int ubi_io_sync_erase(struct ubi_device *ubi, int pnum, int torture);
 int ubi_io_is_bad(const struct ubi_device *ubi, int pnum);
-int ubi_io_mark_bad(const struct ubi_device *ubi, int pnum);
+int ubi_io_mark_bad(struct ubi_device *ubi, int pnum);
 int ubi_io_read_ec_hdr(struct ubi_device *ubi, int pnum,
 		       struct ubi_ec_hdr *ec_hdr, int verbose);
 int ubi_io_write_ec_hdr(struct ubi_device *ubi, int pnum,
@@ -563,6 +581,32 @@ int ubi_io_read_vid_hdr(struct ubi_device *ubi, int pnum,
 int ubi_io_write_vid_hdr(struct ubi_device *ubi, int pnum,
 			 struct ubi_vid_hdr *vid_hdr);
 
+/* ckpt.c */
+#ifdef CONFIG_MTD_UBI_CHECKPOINT
+int ubi_ckpt_init(struct ubi_device *ubi);
+struct ubi_scan_info *ubi_ckpt_scan(struct ubi_device *ubi);
+int ubi_ckpt_attach(struct ubi_device *ubi, struct ubi_scan_info *si);
+void ubi_ckpt_close(struct ubi_device *ubi);
+void ubi_ckpt_free(struct ubi_device *ubi);
+int ubi_ckpt_invalidate(struct ubi_device *ubi, int pnum, int erase);
+void ubi_ckpt_read_lock(struct ubi_device *ubi);
+void ubi_ckpt_read_unlock(struct ubi_device *ubi);
+#else
+static inline int ubi_ckpt_init(struct ubi_device *ubi) { return 0; }
+static inline struct ubi_scan_info *ubi_ckpt_scan(struct ubi_device *ubi)
+{
+	return NULL;
+}
+static inline int ubi_ckpt_attach(struct ubi_device *ubi,
+				  struct ubi_scan_info *si) { return 0; }
+static inline void ubi_ckpt_close(struct ubi_device *ubi) {}
+static inline void ubi_ckpt_free(struct ubi_device *ubi) {}
+static inline int ubi_ckpt_invalidate(struct ubi_device *ubi, int pnum,
+				      int erase) { return 0; }
+static inline void ubi_ckpt_read_lock(struct ubi_device *ubi) {}
+static inline void ubi_ckpt_read_unlock(struct ubi_device *ubi) {}
+#endif
+
 /* build.c */
 int ubi_attach_mtd_dev(struct mtd_info *mtd, int ubi_num, int vid_hdr_offset);
 int ubi_detach_mtd_dev(int ubi_num, int anyway);
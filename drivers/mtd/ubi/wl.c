@@ -54,6 +54,16 @@
  * in a physical eraseblock, it has to be moved. Technically this is the same
  * as moving it for wear-leveling reasons.
  *
+ * Reading NAND pages slowly disturbs the other pages of the eraseblock, so
+ * eraseblocks which are read very often eventually develop bit-flips even if
+ * they are never written. The WL sub-system counts the pages read from each
+ * physical eraseblock since it was last erased (kept across attaches only by
+ * the checkpoint sub-system), and when the device has been idle for a while,
+ * the background thread scrubs the most-read eraseblock which crossed the
+ * @read_scrub_threshold module parameter, at most one per
+ * @read_scrub_interval seconds. This way such eraseblocks are refreshed before
+ * they become uncorrectable, and without competing with foreground I/O.
+ *
  * As it was said, for the UBI sub-system all physical eraseblocks are either
  * "free" or "used". Free eraseblock are kept in the @wl->free RB-tree, while
  * used eraseblocks are kept in @wl->used, @wl->erroneous, or @wl->scrub
@@ -106,12 +116,30 @@
  * room for future re-works of the WL sub-system.
  */
 
+#include <linux/module.h>
 #include <linux/slab.h>
 #include <linux/crc32.h>
 #include <linux/freezer.h>
 #include <linux/kthread.h>
 #include "ubi.h"
 
+/*
+ * The read counts live in RAM only. With the checkpoint sub-system they are
+ * saved on detach and restored on the next fast attach; otherwise, and after
+ * an unclean shutdown or a full scan, they restart from zero, so a PEB may be
+ * read up to this many pages more than intended before it is scrubbed. Pick
+ * the threshold with that margin in mind if the device is attached often.
+ */
+static unsigned int read_scrub_threshold = 100000;
+module_param(read_scrub_threshold, uint, 0644);
+MODULE_PARM_DESC(read_scrub_threshold, "pages read from a PEB after which it "
+		 "is scrubbed in idle time (0 to disable)");
+
+static unsigned int read_scrub_interval = 10;
+module_param(read_scrub_interval, uint, 0644);
+MODULE_PARM_DESC(read_scrub_interval, "minimum seconds between idle-time "
+		 "scrubs of PEBs which were read many times");
+
 /* Number of physical eraseblocks reserved for wear-leveling purposes */
 #define WL_RESERVED_PEBS 1
 
@@ -142,6 +170,13 @@
  */
 #define WL_MAX_FAILURES 32
 
+/*
+ * How long there has to be no I/O through the EBA sub-system before the
+ * background thread considers the device idle and scrubs PEBs which were read
+ * too many times.
+ */
+#define WL_READ_SCRUB_IDLE HZ
+
 /**
  * struct ubi_work - UBI work description data structure.
  * @list: a link in the list of pending works
@@ -548,6 +583,7 @@ static int sync_erase(struct ubi_device *ubi, struct ubi_wl_entry *e,
 		goto out_free;
 
 	e->ec = ec;
+	ubi->peb_reads[e->pnum] = 0;
 	spin_lock(&ubi->wl_lock);
 	if (e->ec > ubi->max_ec)
 		ubi->max_ec = e->ec;
@@ -1347,6 +1383,79 @@ static void tree_destroy(struct rb_root *root)
 	}
 }
 
+/**
+ * ubi_wl_read_done - account for data read from a physical eraseblock.
+ * @ubi: UBI device description object
+ * @pnum: the physical eraseblock which was read
+ * @len: how many bytes were read
+ *
+ * The read counters are not protected by any lock, so concurrent readers may
+ * lose an increment once in a while, which does not matter for this purpose.
+ */
+void ubi_wl_read_done(struct ubi_device *ubi, int pnum, int len)
+{
+	ubi->peb_reads[pnum] += DIV_ROUND_UP(len, ubi->min_io_size);
+	ubi->last_io = jiffies;
+}
+
+/**
+ * read_scrub - scrub the most-read physical eraseblock if the device is idle.
+ * @ubi: UBI device description object
+ *
+ * This function is called by the background thread when it has had nothing
+ * to do for @read_scrub_interval seconds. If there was no I/O for
+ * %WL_READ_SCRUB_IDLE either, it picks the used physical eraseblock with the
+ * highest read count at or above @read_scrub_threshold and schedules it for
+ * scrubbing. Its read count is reset when it is erased after the move.
+ */
+static void read_scrub(struct ubi_device *ubi)
+{
+	int pnum, err;
+	unsigned int reads, max = 0;
+	struct ubi_wl_entry *e, *hot = NULL;
+
+	if (!time_after(jiffies, ubi->last_io + WL_READ_SCRUB_IDLE))
+		return;
+
+	spin_lock(&ubi->wl_lock);
+	if (!list_empty(&ubi->works) || ubi->ro_mode || !ubi->thread_enabled) {
+		spin_unlock(&ubi->wl_lock);
+		return;
+	}
+
+	for (pnum = 0; pnum < ubi->peb_count; pnum++) {
+		reads = ubi->peb_reads[pnum];
+		if (reads < read_scrub_threshold || reads <= max)
+			continue;
+
+		e = ubi->lookuptbl[pnum];
+		if (!e || e == ubi->move_from || e == ubi->move_to ||
+		    !in_wl_tree(e, &ubi->used))
+			continue;
+
+		hot = e;
+		max = reads;
+	}
+
+	if (!hot) {
+		spin_unlock(&ubi->wl_lock);
+		return;
+	}
+
+	paranoid_check_in_wl_tree(ubi, hot, &ubi->used);
+	rb_erase(&hot->u.rb, &ubi->used);
+	wl_tree_add(hot, &ubi->scrub);
+	ubi->read_scrubs += 1;
+	spin_unlock(&ubi->wl_lock);
+
+	dbg_wl("PEB %d had %u pages read, schedule it for scrubbing",
+	       hot->pnum, max);
+	err = ensure_wear_leveling(ubi);
+	if (err)
+		ubi_err("%s: cannot schedule scrubbing of PEB %d, error %d",
+			ubi->bgt_name, hot->pnum, err);
+}
+
 /**
  * ubi_thread - UBI background thread.
  * @u: the UBI device description object pointer
@@ -1374,7 +1483,19 @@ int ubi_thread(void *u)
 		    !ubi->thread_enabled || ubi_dbg_is_bgt_disabled(ubi)) {
 			set_current_state(TASK_INTERRUPTIBLE);
 			spin_unlock(&ubi->wl_lock);
-			schedule();
+			if (!read_scrub_threshold || !read_scrub_interval ||
+			    ubi_dbg_is_bgt_disabled(ubi)) {
+				schedule();
+				continue;
+			}
+
+			/*
+			 * Nothing to do: sleep for a while, and if we are not
+			 * woken up for real work meanwhile, use the idle time
+			 * to refresh PEBs which were read too many times.
+			 */
+			if (!schedule_timeout(read_scrub_interval * HZ))
+				read_scrub(ubi);
 			continue;
 		}
 		spin_unlock(&ubi->wl_lock);
@@ -1451,6 +1572,20 @@ int ubi_wl_init_scan(struct ubi_device *ubi, struct ubi_scan_info *si)
 	if (!ubi->lookuptbl)
 		return err;
 
+	if (si->peb_reads) {
+		/* Restored from the checkpoint */
+		ubi->peb_reads = si->peb_reads;
+		si->peb_reads = NULL;
+	} else {
+		ubi->peb_reads = kzalloc(ubi->peb_count * sizeof(unsigned int),
+					 GFP_KERNEL);
+	}
+	if (!ubi->peb_reads) {
+		kfree(ubi->lookuptbl);
+		return err;
+	}
+	ubi->last_io = jiffies;
+
 	for (i = 0; i < UBI_PROT_QUEUE_LEN; i++)
 		INIT_LIST_HEAD(&ubi->pq[i]);
 	ubi->pq_head = 0;
@@ -1532,6 +1667,7 @@ out_free:
 	tree_destroy(&ubi->free);
 	tree_destroy(&ubi->scrub);
 	kfree(ubi->lookuptbl);
+	kfree(ubi->peb_reads);
 	return err;
 }
 
@@ -1566,8 +1702,153 @@ void ubi_wl_close(struct ubi_device *ubi)
 	tree_destroy(&ubi->free);
 	tree_destroy(&ubi->scrub);
 	kfree(ubi->lookuptbl);
+	kfree(ubi->peb_reads);
 }
 
+#ifdef CONFIG_MTD_UBI_CHECKPOINT
+
+/**
+ * ubi_wl_get_ckpt_peb - take a free physical eraseblock for the checkpoint.
+ * @ubi: UBI device description object
+ * @max_pnum: the physical eraseblock has to be below this number
+ * @ec: the erase counter of the physical eraseblock is returned here
+ *
+ * Checkpoint PEBs are not managed by the WL sub-system, so unlike
+ * 'ubi_wl_get_peb()' this function removes the PEB from the WL sub-system
+ * altogether. It does not wait for PEBs to be erased either. The checkpoint
+ * is short term data, so the free PEB with the lowest erase counter is taken.
+ *
+ * If @max_pnum limits the choice (the anchor), the PEBs below it which hold
+ * data would never be offered, and the few free ones would take all the
+ * wear. So if one of the used PEBs has an erase counter at least
+ * %UBI_WL_THRESHOLD lower than the taken one, it is scheduled for scrubbing
+ * to move its data elsewhere and make it available for the next anchor.
+ *
+ * Returns the physical eraseblock number in case of success, and %-ENOSPC if
+ * there is no suitable free PEB.
+ */
+int ubi_wl_get_ckpt_peb(struct ubi_device *ubi, int max_pnum, int *ec)
+{
+	struct ubi_wl_entry *e;
+	struct rb_node *rb;
+	int pnum = -ENOSPC, scrub = 0;
+
+	spin_lock(&ubi->wl_lock);
+	ubi_rb_for_each_entry(rb, e, &ubi->free, u.rb) {
+		if (e->pnum >= max_pnum)
+			continue;
+
+		rb_erase(&e->u.rb, &ubi->free);
+		ubi->lookuptbl[e->pnum] = NULL;
+		pnum = e->pnum;
+		*ec = e->ec;
+		kmem_cache_free(ubi_wl_entry_slab, e);
+		break;
+	}
+
+	if (pnum >= 0 && max_pnum < ubi->peb_count) {
+		/* The used tree is ordered by erase counter */
+		ubi_rb_for_each_entry(rb, e, &ubi->used, u.rb) {
+			if (*ec - e->ec < UBI_WL_THRESHOLD)
+				break;
+			if (e->pnum < max_pnum) {
+				dbg_wl("scrub PEB %d, EC %d to free it for the "
+				       "next anchor", e->pnum, e->ec);
+				rb_erase(&e->u.rb, &ubi->used);
+				wl_tree_add(e, &ubi->scrub);
+				scrub = 1;
+				break;
+			}
+		}
+	}
+	spin_unlock(&ubi->wl_lock);
+
+	dbg_wl("PEB %d for the checkpoint", pnum);
+	if (scrub)
+		ensure_wear_leveling(ubi);
+	return pnum;
+}
+
+/**
+ * ubi_wl_put_ckpt_peb - return a checkpoint PEB to the WL sub-system.
+ * @ubi: UBI device description object
+ * @pnum: the physical eraseblock to return
+ * @ec: its erase counter
+ * @torture: if the physical eraseblock has to be tortured
+ *
+ * The physical eraseblock is scheduled for erasure and becomes an ordinary
+ * free PEB afterwards. Returns zero in case of success and %-ENOMEM in case
+ * of failure.
+ */
+int ubi_wl_put_ckpt_peb(struct ubi_device *ubi, int pnum, int ec, int torture)
+{
+	struct ubi_wl_entry *e;
+
+	dbg_wl("return checkpoint PEB %d, EC %d", pnum, ec);
+
+	e = kmem_cache_alloc(ubi_wl_entry_slab, GFP_NOFS);
+	if (!e)
+		return -ENOMEM;
+
+	e->pnum = pnum;
+	e->ec = ec;
+
+	spin_lock(&ubi->wl_lock);
+	ubi_assert(!ubi->lookuptbl[pnum]);
+	ubi->lookuptbl[pnum] = e;
+	spin_unlock(&ubi->wl_lock);
+
+	return schedule_erase(ubi, e, torture);
+}
+
+static void ckpt_set(struct ubi_ckpt_peb *pebs, const struct ubi_wl_entry *e,
+		     int state, int flags)
+{
+	pebs[e->pnum].ec = cpu_to_be32(e->ec);
+	pebs[e->pnum].state = state;
+	pebs[e->pnum].flags = flags;
+}
+
+/**
+ * ubi_wl_ckpt_snapshot - record the state of PEBs for the checkpoint.
+ * @ubi: UBI device description object
+ * @pebs: checkpoint PEB records indexed by PEB number
+ *
+ * This function fills in the state and erase counter of every physical
+ * eraseblock known to the WL sub-system and leaves the other records alone.
+ * The caller has to hold @ubi->work_sem for writing, so that no PEB is in
+ * the middle of being moved or erased.
+ */
+void ubi_wl_ckpt_snapshot(struct ubi_device *ubi, struct ubi_ckpt_peb *pebs)
+{
+	struct ubi_wl_entry *e;
+	struct ubi_work *wrk;
+	struct rb_node *rb;
+	int i;
+
+	spin_lock(&ubi->wl_lock);
+	ubi_assert(!ubi->move_from && !ubi->move_to);
+
+	ubi_rb_for_each_entry(rb, e, &ubi->free, u.rb)
+		ckpt_set(pebs, e, UBI_CKPT_PEB_FREE, 0);
+	ubi_rb_for_each_entry(rb, e, &ubi->used, u.rb)
+		ckpt_set(pebs, e, UBI_CKPT_PEB_USED, 0);
+	ubi_rb_for_each_entry(rb, e, &ubi->erroneous, u.rb)
+		ckpt_set(pebs, e, UBI_CKPT_PEB_USED, 0);
+	ubi_rb_for_each_entry(rb, e, &ubi->scrub, u.rb)
+		ckpt_set(pebs, e, UBI_CKPT_PEB_USED, UBI_CKPT_PEB_SCRUB);
+	for (i = 0; i < UBI_PROT_QUEUE_LEN; i++)
+		list_for_each_entry(e, &ubi->pq[i], u.list)
+			ckpt_set(pebs, e, UBI_CKPT_PEB_USED, 0);
+	list_for_each_entry(wrk, &ubi->works, list)
+		if (wrk->func == &erase_worker)
+			ckpt_set(pebs, wrk->e, UBI_CKPT_PEB_ERASE, 0);
+
+	spin_unlock(&ubi->wl_lock);
+}
+
+#endif /* CONFIG_MTD_UBI_CHECKPOINT */
+
 #ifdef CONFIG_MTD_UBI_DEBUG
 
 /**
@@ -30,6 +30,7 @@
 #include <linux/spi/spi_bitbang.h>
 #include <linux/slab.h>
 #include <linux/cpufreq.h>
+#include <linux/pm_runtime.h>
 
 #include <mach/spi.h>
 #include <mach/edma.h>
@@ -38,6 +39,8 @@
 
 #define SPI_MAX_CHIPSELECT	2
 
+#define SPI_AUTOSUSPEND_MS	100	/* idle time before gating the clock */
+
 #define CS_DEFAULT	0xFF
 
 #define SPIFMT_PHASE_MASK	BIT(16)
@@ -149,6 +152,7 @@ struct davinci_spi {
 	u32			speed;
 	u32			cs_num;
 	bool			in_use;
+	bool			cs_held;	/* runtime PM ref while CS active */
 
 #ifdef CONFIG_CPU_FREQ
 	struct notifier_block   freq_transition;
@@ -227,6 +231,16 @@ static void davinci_spi_chipselect(struct spi_device *spi, int value)
 	dspi = spi_master_get_devdata(spi->master);
 	pdata = dspi->pdata;
 
+	/*
+	 * Keep the controller powered from chip select assertion until the
+	 * matching deselect; bitbang may leave the chip selected between
+	 * messages, so this is not the same as per-message.
+	 */
+	if (!dspi->cs_held) {
+		pm_runtime_get_sync(spi->master->dev.parent);
+		dspi->cs_held = value == BITBANG_CS_ACTIVE;
+	}
+
 	if (pdata->chip_sel && chip_sel < pdata->num_chipselect &&
 				pdata->chip_sel[chip_sel] != SPI_INTERN_CS)
 		gpio_chipsel = true;
@@ -248,6 +262,12 @@ static void davinci_spi_chipselect(struct spi_device *spi, int value)
 
 		iowrite16(spidat1, dspi->base + SPIDAT1 + 2);
 	}
+
+	if (value != BITBANG_CS_ACTIVE) {
+		dspi->cs_held = false;
+		pm_runtime_mark_last_busy(spi->master->dev.parent);
+		pm_runtime_put_autosuspend(spi->master->dev.parent);
+	}
 }
 
 /**
@@ -282,7 +302,7 @@ static inline int davinci_spi_get_prescale(struct davinci_spi *dspi,
  * It will also set the SPI Clock Control register according to
  * SPI slave device freq.
  */
-static int davinci_spi_setup_transfer(struct spi_device *spi,
+static int __davinci_spi_setup_transfer(struct spi_device *spi,
 		struct spi_transfer *t)
 {
 
@@ -394,6 +414,20 @@ static int davinci_spi_setup_transfer(struct spi_device *spi,
 	return 0;
 }
 
+static int davinci_spi_setup_transfer(struct spi_device *spi,
+		struct spi_transfer *t)
+{
+	struct device *sdev = spi->master->dev.parent;
+	int ret;
+
+	pm_runtime_get_sync(sdev);
+	ret = __davinci_spi_setup_transfer(spi, t);
+	pm_runtime_mark_last_busy(sdev);
+	pm_runtime_put_autosuspend(sdev);
+
+	return ret;
+}
+
 /**
  * davinci_spi_setup - This functions will set default transfer method
  * @spi: spi device on which data transfer to be done
@@ -413,6 +447,8 @@ static int davinci_spi_setup(struct spi_device *spi)
 	if (!spi->bits_per_word)
 		spi->bits_per_word = 8;
 
+	pm_runtime_get_sync(spi->master->dev.parent);
+
 	if (!(spi->mode & SPI_NO_CS)) {
 		if ((pdata->chip_sel == NULL) ||
 		    (pdata->chip_sel[spi->chip_select] == SPI_INTERN_CS))
@@ -428,6 +464,9 @@ static int davinci_spi_setup(struct spi_device *spi)
 	else
 		clear_io_bits(dspi->base + SPIGCR1, SPIGCR1_LOOPBACK_MASK);
 
+	pm_runtime_mark_last_busy(spi->master->dev.parent);
+	pm_runtime_put_autosuspend(spi->master->dev.parent);
+
 	return retval;
 }
 
@@ -819,9 +858,11 @@ static int davinci_spi_cpufreq_transition(struct notifier_block *nb,
 		if (dspi->in_use)
 			wait_for_completion(&dspi->done);
 	} else if (val == CPUFREQ_POSTCHANGE) {
+		pm_runtime_get_sync(dspi->bitbang.master->dev.parent);
 		prescale = davinci_spi_get_prescale(dspi, dspi->speed);
 		clear_io_bits(dspi->base + SPIFMT0, 0x0000ff00);
 		set_io_bits(dspi->base + SPIFMT0, prescale << 8);
+		pm_runtime_put_autosuspend(dspi->bitbang.master->dev.parent);
 	}
 	return 0;
 }
@@ -937,6 +978,13 @@ static int __devinit davinci_spi_probe(struct platform_device *pdev)
 	}
 	clk_enable(dspi->clk);
 
+	/* runtime PM gates the module clock whenever the bus is idle */
+	pm_runtime_set_autosuspend_delay(&pdev->dev, SPI_AUTOSUSPEND_MS);
+	pm_runtime_use_autosuspend(&pdev->dev);
+	pm_runtime_get_noresume(&pdev->dev);
+	pm_runtime_set_active(&pdev->dev);
+	pm_runtime_enable(&pdev->dev);
+
 	master->bus_num = pdev->id;
 	master->num_chipselect = pdata->num_chipselect;
 	master->setup = davinci_spi_setup;
@@ -1020,6 +1068,9 @@ static int __devinit davinci_spi_probe(struct platform_device *pdev)
 
 	dev_info(&pdev->dev, "Controller at 0x%p\n", dspi->base);
 
+	pm_runtime_mark_last_busy(&pdev->dev);
+	pm_runtime_put_autosuspend(&pdev->dev);
+
 	return ret;
 
 free_dma:
@@ -1027,6 +1078,9 @@ free_dma:
 	edma_free_channel(dspi->dma.rx_channel);
 	edma_free_slot(dspi->dma.dummy_param_slot);
 free_clk:
+	pm_runtime_disable(&pdev->dev);
+	pm_runtime_put_noidle(&pdev->dev);
+	pm_runtime_set_suspended(&pdev->dev);
 	clk_disable(dspi->clk);
 	clk_put(dspi->clk);
 put_master:
@@ -1063,6 +1117,11 @@ static int __devexit davinci_spi_remove(struct platform_device *pdev)
 
 	spi_bitbang_stop(&dspi->bitbang);
 
+	pm_runtime_get_sync(&pdev->dev);
+	pm_runtime_disable(&pdev->dev);
+	pm_runtime_put_noidle(&pdev->dev);
+	pm_runtime_set_suspended(&pdev->dev);
+
 	clk_disable(dspi->clk);
 	clk_put(dspi->clk);
 	spi_master_put(master);
@@ -1076,15 +1135,34 @@ static int __devexit davinci_spi_remove(struct platform_device *pdev)
 
 #ifdef CONFIG_PM
 #define DAVINCI_SPI_MAX_TRANSFER_TIME	5000
-static int davinci_spi_suspend(struct platform_device *pdev, pm_message_t pmsg)
+
+#ifdef CONFIG_PM_RUNTIME
+static int davinci_spi_runtime_suspend(struct device *dev)
+{
+	struct spi_master *master = dev_get_drvdata(dev);
+	struct davinci_spi *dspi = spi_master_get_devdata(master);
+
+	clk_disable(dspi->clk);
+	return 0;
+}
+
+static int davinci_spi_runtime_resume(struct device *dev)
+{
+	struct spi_master *master = dev_get_drvdata(dev);
+	struct davinci_spi *dspi = spi_master_get_devdata(master);
+
+	clk_enable(dspi->clk);
+	return 0;
+}
+#endif
+
+static int davinci_spi_suspend(struct device *dev)
 {
 	struct davinci_spi *dspi;
 	struct spi_master *master;
-	struct davinci_spi_platform_data *pdata = NULL;
 	int ret;
 
-	pdata = pdev->dev.platform_data;
-	master = dev_get_drvdata(&(pdev)->dev);
+	master = dev_get_drvdata(dev);
 	dspi = spi_master_get_devdata(master);
 
 	if (dspi->in_use) {
@@ -1093,11 +1171,15 @@ static int davinci_spi_suspend(struct platform_device *pdev, pm_message_t pmsg)
 		if (ret < 0)
 			return ret;
 		if (ret == 0) {
-			dev_err(&pdev->dev, "controller timed out\n");
+			dev_err(dev, "controller timed out\n");
 			return -ETIMEDOUT;
 		}
 	}
 
+	/* nothing to do if runtime PM already gated us */
+	if (pm_runtime_status_suspended(dev))
+		return 0;
+
 	/* disable SPI */
 	clear_io_bits(dspi->base + SPIGCR1, SPIGCR1_POWERDOWN_MASK);
 	clk_disable(dspi->clk);
@@ -1105,36 +1187,44 @@ static int davinci_spi_suspend(struct platform_device *pdev, pm_message_t pmsg)
 	return 0;
 }
 
-static int davinci_spi_resume(struct platform_device *pdev)
+static int davinci_spi_resume(struct device *dev)
 {
 	struct davinci_spi *dspi;
 	struct spi_master *master;
-	struct davinci_spi_platform_data *pdata = NULL;
 
-	pdata = pdev->dev.platform_data;
-	master = dev_get_drvdata(&(pdev)->dev);
+	master = dev_get_drvdata(dev);
 	dspi = spi_master_get_devdata(master);
 
+	if (pm_runtime_status_suspended(dev))
+		return 0;
+
 	clk_enable(dspi->clk);
 	/* enable SPI */
 	set_io_bits(dspi->base + SPIGCR1, SPIGCR1_SPIENA_MASK);
 
 	return 0;
 }
+
+static const struct dev_pm_ops davinci_spi_pm = {
+	.suspend	= davinci_spi_suspend,
+	.resume		= davinci_spi_resume,
+	SET_RUNTIME_PM_OPS(davinci_spi_runtime_suspend,
+			   davinci_spi_runtime_resume, NULL)
+};
+
+#define davinci_spi_pm_ops (&davinci_spi_pm)
 #else
-#define davinci_spi_suspend NULL
-#define davinci_spi_resume NULL
+#define davinci_spi_pm_ops NULL
 #endif
 
 static struct platform_driver davinci_spi_driver = {
 	.driver = {
 		.name = "spi_davinci",
 		.owner = THIS_MODULE,
+		.pm = davinci_spi_pm_ops,
 	},
 	.probe = davinci_spi_probe,
 	.remove = __devexit_p(davinci_spi_remove),
-	.suspend = davinci_spi_suspend,
-	.resume = davinci_spi_resume,
 };
 module_platform_driver(davinci_spi_driver);
 
@@ -0,0 +1,638 @@
+/*
+ * davinci_pru_gpio.c - sample a DA8xx GPIO bank pair from a PRU
+ *
+ * A PRU core reads one 32-bit GPIO IN_DATA register (two 16-bit banks)
+ * at a fixed rate and writes the samples to a ring in shared RAM, so
+ * fast digital signals can be captured without an ARM interrupt per
+ * edge.  The ARM is only told when another 'watermark' samples are
+ * waiting, and reads drain the ring directly, as for a hardware
+ * buffer.  The firmware is firmware/davinci/pru_gpio_sample.p.
+ *
+ * The PRU clock follows PLL0, so the sampling period is recomputed
+ * whenever cpufreq changes the rate, and the firmware picks the new
+ * value up from the next sample on.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/module.h>
+#include <linux/platform_device.h>
+#include <linux/slab.h>
+#include <linux/io.h>
+#include <linux/clk.h>
+#include <linux/err.h>
+#include <linux/delay.h>
+#include <linux/sched.h>
+#include <linux/uaccess.h>
+#include <linux/dma-mapping.h>
+#include <linux/cpufreq.h>
+#include <linux/davinci_pruss.h>
+
+#include <mach/common.h>
+#include <mach/sram.h>
+
+#include "../iio.h"
+#include "../sysfs.h"
+#include "../buffer.h"
+#include "../ring_hw.h"
+
+/* Parameter block at the start of the PRU data RAM */
+#define PG_RUN			0x00
+#define PG_GPIO_IN		0x04
+#define PG_PERIOD		0x08
+#define PG_RING			0x0c
+#define PG_MASK			0x10
+#define PG_WATERMARK		0x14
+#define PG_PRU_CTRL		0x18
+#define PG_SIGNAL		0x1c
+#define PG_HEAD			0x20
+#define PG_TAIL			0x24
+#define PG_OVERRUNS		0x28
+
+/* PRU-local address of each PRU's control registers */
+#define PG_PRU_CTRL_ADDR(p)	(0x7000 + (p) * 0x800)
+
+/* IN_DATA of GPIO banks 2n and 2n + 1 */
+#define PG_GPIO_IN_DATA(n)	(0x20 + (n) * 0x28)
+#define PG_NUM_BANK_PAIRS	5
+
+/* Cycles the sampling loop takes outside the counted period */
+#define PG_LOOP_OVERHEAD	3
+/* Worst case loop body, GPIO read included, as measured on DA850 */
+#define PG_MIN_PERIOD		64
+
+#define PG_DEFAULT_LENGTH	4096
+#define PG_MAX_LENGTH		SZ_64K
+
+static unsigned pru = 1;
+module_param(pru, uint, 0444);
+MODULE_PARM_DESC(pru, "PRU core to sample with (0 or 1)");
+
+static char *firmware = "davinci/pru_gpio_sample.bin";
+module_param(firmware, charp, 0444);
+MODULE_PARM_DESC(firmware, "sampling firmware image");
+
+struct pru_gpio_state {
+	struct device		*dev;
+	struct mutex		lock;
+	struct pruss_chan	*chan;
+	void __iomem		*dram;
+	void __iomem		*gpio;
+	struct clk		*clk;
+
+	u32			*ring;
+	dma_addr_t		ring_phys;
+	unsigned		ring_len;	/* allocated, in samples */
+	unsigned		length;		/* requested */
+	bool			in_sram;
+
+	unsigned		bank_pair;
+	unsigned		rate;		/* Hz */
+	bool			running;
+#ifdef CONFIG_CPU_FREQ
+	struct notifier_block	freq_transition;
+#endif
+};
+
+static void pru_gpio_ring_free(struct pru_gpio_state *st)
+{
+	if (!st->ring)
+		return;
+
+	if (st->in_sram)
+		davinci_sram_free(st->ring);
+	else
+		dma_free_coherent(NULL, st->ring_len * 4, st->ring,
+				  st->ring_phys);
+	st->ring = NULL;
+	st->ring_len = 0;
+}
+
+static int pru_gpio_ring_alloc(struct pru_gpio_state *st)
+{
+	size_t size = st->length * 4;
+	phys_addr_t phys;
+
+	if (st->ring && st->ring_len == st->length)
+		return 0;
+	pru_gpio_ring_free(st);
+
+	st->ring = davinci_sram_alloc("pru-gpio", size,
+				      DAVINCI_SRAM_PRIO_NORMAL, &phys);
+	if (st->ring) {
+		st->ring_phys = phys;
+		st->in_sram = true;
+	} else {
+		st->ring = dma_alloc_coherent(NULL, size, &st->ring_phys,
+					      GFP_KERNEL);
+		if (!st->ring)
+			return -ENOMEM;
+		st->in_sram = false;
+	}
+	st->ring_len = st->length;
+
+	return 0;
+}
+
+/* Called in hard irq context every 'watermark' samples */
+static void pru_gpio_notify(struct pruss_chan *chan, void *data)
+{
+	struct iio_dev *indio_dev = data;
+	struct iio_buffer *buffer = indio_dev->buffer;
+
+	buffer->stufftoread = true;
+	wake_up_interruptible(&buffer->pollq);
+}
+
+static int pru_gpio_read_first_n(struct iio_buffer *r, size_t n,
+				 char __user *buf)
+{
+	struct iio_hw_buffer *hw_ring = iio_to_hw_buf(r);
+	struct iio_dev *indio_dev = hw_ring->private;
+	struct pru_gpio_state *st = iio_priv(indio_dev);
+	unsigned head, tail, avail, chunk, count, copied = 0;
+	int ret = 0;
+
+	mutex_lock(&st->lock);
+
+	if (!st->ring || n < 4) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	head = __raw_readl(st->dram + PG_HEAD);
+	tail = __raw_readl(st->dram + PG_TAIL);
+	avail = (head - tail) & (st->ring_len - 1);
+	count = min_t(unsigned, avail, n / 4);
+	rmb();
+
+	while (copied < count) {
+		chunk = min(count - copied, st->ring_len - tail);
+		if (copy_to_user(buf + copied * 4, st->ring + tail,
+				 chunk * 4)) {
+			ret = -EFAULT;
+			break;
+		}
+		copied += chunk;
+		tail = (tail + chunk) & (st->ring_len - 1);
+	}
+
+	mb();
+	__raw_writel(tail, st->dram + PG_TAIL);
+	if (tail == head)
+		r->stufftoread = false;
+out:
+	mutex_unlock(&st->lock);
+
+	return copied ? copied * 4 : ret;
+}
+
+static int pru_gpio_get_length(struct iio_buffer *r)
+{
+	return r->length;
+}
+
+static int pru_gpio_set_length(struct iio_buffer *r, int length)
+{
+	struct iio_dev *indio_dev = iio_to_hw_buf(r)->private;
+	struct pru_gpio_state *st = iio_priv(indio_dev);
+
+	if (length < 2)
+		return -EINVAL;
+
+	/* Takes effect at the next enable */
+	r->length = min_t(unsigned, roundup_pow_of_two(length), PG_MAX_LENGTH);
+	st->length = r->length;
+	return 0;
+}
+
+static int pru_gpio_get_bytes_per_datum(struct iio_buffer *r)
+{
+	return 4;
+}
+
+static const struct iio_buffer_access_funcs pru_gpio_access_funcs = {
+	.read_first_n		= &pru_gpio_read_first_n,
+	.get_length		= &pru_gpio_get_length,
+	.set_length		= &pru_gpio_set_length,
+	.get_bytes_per_datum	= &pru_gpio_get_bytes_per_datum,
+};
+
+/*
+ * Program the sampling period for the current PRU clock.  Called with
+ * st->lock held.  If the clock has become too slow for the requested
+ * rate, sample as fast as the firmware can.
+ */
+static void pru_gpio_set_period(struct pru_gpio_state *st)
+{
+	unsigned period = clk_get_rate(st->clk) / st->rate;
+
+	if (period < PG_MIN_PERIOD) {
+		dev_warn(st->dev, "PRU clock too slow for %u Hz\n", st->rate);
+		period = PG_MIN_PERIOD;
+	}
+	__raw_writel(period - PG_LOOP_OVERHEAD, st->dram + PG_PERIOD);
+}
+
+static int pru_gpio_preenable(struct iio_dev *indio_dev)
+{
+	struct pru_gpio_state *st = iio_priv(indio_dev);
+	void __iomem *dram = st->dram;
+	int ret;
+
+	mutex_lock(&st->lock);
+
+	if (clk_get_rate(st->clk) / st->rate < PG_MIN_PERIOD) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	ret = pru_gpio_ring_alloc(st);
+	if (ret)
+		goto out;
+
+	__raw_writel(1, dram + PG_RUN);
+	__raw_writel(davinci_soc_info.gpio_base +
+		     PG_GPIO_IN_DATA(st->bank_pair), dram + PG_GPIO_IN);
+	pru_gpio_set_period(st);
+	__raw_writel(st->ring_phys, dram + PG_RING);
+	__raw_writel(st->ring_len - 1, dram + PG_MASK);
+	__raw_writel(max(st->ring_len / 4, 1U), dram + PG_WATERMARK);
+	__raw_writel(PG_PRU_CTRL_ADDR(pru), dram + PG_PRU_CTRL);
+	/* Channel 0 of the PRU raises system event 32 + pru * 4 */
+	__raw_writel(BIT(5) | (pru * PRUSS_CHANS_PER_PRU), dram + PG_SIGNAL);
+	__raw_writel(0, dram + PG_HEAD);
+	__raw_writel(0, dram + PG_TAIL);
+	__raw_writel(0, dram + PG_OVERRUNS);
+	indio_dev->buffer->stufftoread = false;
+	wmb();
+
+	ret = pruss_boot(pru, firmware);
+	st->running = !ret;
+out:
+	mutex_unlock(&st->lock);
+	return ret;
+}
+
+static int pru_gpio_postdisable(struct iio_dev *indio_dev)
+{
+	struct pru_gpio_state *st = iio_priv(indio_dev);
+
+	mutex_lock(&st->lock);
+	/* Let the firmware finish its current sample, then make sure */
+	__raw_writel(0, st->dram + PG_RUN);
+	udelay(10);
+	pruss_halt(pru);
+	st->running = false;
+	mutex_unlock(&st->lock);
+
+	return 0;
+}
+
+static const struct iio_buffer_setup_ops pru_gpio_setup_ops = {
+	.preenable	= &pru_gpio_preenable,
+	.postdisable	= &pru_gpio_postdisable,
+};
+
+static IIO_BUFFER_ENABLE_ATTR;
+static IIO_BUFFER_LENGTH_ATTR;
+
+static ssize_t pru_gpio_show_overruns(struct device *dev,
+				      struct device_attribute *attr,
+				      char *buf)
+{
+	struct iio_dev *indio_dev = dev_get_drvdata(dev);
+	struct pru_gpio_state *st = iio_priv(indio_dev);
+
+	return sprintf(buf, "%u\n", __raw_readl(st->dram + PG_OVERRUNS));
+}
+
+static IIO_DEVICE_ATTR(overruns, S_IRUGO, pru_gpio_show_overruns, NULL, 0);
+
+static struct attribute *pru_gpio_ring_attributes[] = {
+	&dev_attr_length.attr,
+	&dev_attr_enable.attr,
+	&iio_dev_attr_overruns.dev_attr.attr,
+	NULL,
+};
+
+static struct attribute_group pru_gpio_ring_attr = {
+	.attrs = pru_gpio_ring_attributes,
+	.name = "buffer",
+};
+
+static ssize_t pru_gpio_show_freq(struct device *dev,
+				  struct device_attribute *attr, char *buf)
+{
+	struct iio_dev *indio_dev = dev_get_drvdata(dev);
+	struct pru_gpio_state *st = iio_priv(indio_dev);
+
+	return sprintf(buf, "%u\n", st->rate);
+}
+
+static ssize_t pru_gpio_store_freq(struct device *dev,
+				   struct device_attribute *attr,
+				   const char *buf, size_t len)
+{
+	struct iio_dev *indio_dev = dev_get_drvdata(dev);
+	struct pru_gpio_state *st = iio_priv(indio_dev);
+	unsigned long val;
+	int ret;
+
+	ret = strict_strtoul(buf, 10, &val);
+	if (ret)
+		return ret;
+	if (!val || clk_get_rate(st->clk) / val < PG_MIN_PERIOD)
+		return -EINVAL;
+
+	mutex_lock(&indio_dev->mlock);
+	if (iio_buffer_enabled(indio_dev)) {
+		mutex_unlock(&indio_dev->mlock);
+		return -EBUSY;
+	}
+	st->rate = val;
+	mutex_unlock(&indio_dev->mlock);
+
+	return len;
+}
+
+static IIO_DEV_ATTR_SAMP_FREQ(S_IRUGO | S_IWUSR,
+			      pru_gpio_show_freq, pru_gpio_store_freq);
+
+/* Pair n samples GPIO banks 2n (bits 0-15) and 2n + 1 (bits 16-31) */
+static ssize_t pru_gpio_show_bank_pair(struct device *dev,
+				       struct device_attribute *attr,
+				       char *buf)
+{
+	struct iio_dev *indio_dev = dev_get_drvdata(dev);
+	struct pru_gpio_state *st = iio_priv(indio_dev);
+
+	return sprintf(buf, "%u\n", st->bank_pair);
+}
+
+static ssize_t pru_gpio_store_bank_pair(struct device *dev,
+					struct device_attribute *attr,
+					const char *buf, size_t len)
+{
+	struct iio_dev *indio_dev = dev_get_drvdata(dev);
+	struct pru_gpio_state *st = iio_priv(indio_dev);
+	unsigned long val;
+	int ret;
+
+	ret = strict_strtoul(buf, 10, &val);
+	if (ret)
+		return ret;
+	if (val >= PG_NUM_BANK_PAIRS)
+		return -EINVAL;
+
+	mutex_lock(&indio_dev->mlock);
+	if (iio_buffer_enabled(indio_dev)) {
+		mutex_unlock(&indio_dev->mlock);
+		return -EBUSY;
+	}
+	st->bank_pair = val;
+	mutex_unlock(&indio_dev->mlock);
+
+	return len;
+}
+
+static IIO_DEVICE_ATTR(bank_pair, S_IRUGO | S_IWUSR,
+		       pru_gpio_show_bank_pair, pru_gpio_store_bank_pair, 0);
+
+static struct attribute *pru_gpio_attributes[] = {
+	&iio_dev_attr_sampling_frequency.dev_attr.attr,
+	&iio_dev_attr_bank_pair.dev_attr.attr,
+	NULL,
+};
+
+static const struct attribute_group pru_gpio_attribute_group = {
+	.attrs = pru_gpio_attributes,
+};
+
+static const struct iio_chan_spec pru_gpio_channels[] = {
+	IIO_CHAN(IIO_DIGITAL, 0, 1, 0, NULL, 0, 0, 0,
+		 0, 0, IIO_ST('u', 32, 32, 0), 0),
+};
+
+/* Direct reads return the bank pair as it is right now */
+static int pru_gpio_read_raw(struct iio_dev *indio_dev,
+			     struct iio_chan_spec const *chan,
+			     int *val, int *val2, long m)
+{
+	struct pru_gpio_state *st = iio_priv(indio_dev);
+
+	if (m)
+		return -EINVAL;
+
+	*val = __raw_readl(st->gpio + PG_GPIO_IN_DATA(st->bank_pair));
+	return IIO_VAL_INT;
+}
+
+static const struct iio_info pru_gpio_info = {
+	.attrs		= &pru_gpio_attribute_group,
+	.read_raw	= &pru_gpio_read_raw,
+	.driver_module	= THIS_MODULE,
+};
+
+static int pru_gpio_configure_ring(struct iio_dev *indio_dev)
+{
+	struct pru_gpio_state *st = iio_priv(indio_dev);
+	struct iio_hw_buffer *ring;
+
+	ring = kzalloc(sizeof(*ring), GFP_KERNEL);
+	if (!ring)
+		return -ENOMEM;
+
+	ring->private = indio_dev;
+	ring->buf.attrs = &pru_gpio_ring_attr;
+	ring->buf.access = &pru_gpio_access_funcs;
+	ring->buf.bytes_per_datum = 4;
+	ring->buf.length = st->length;
+	iio_buffer_init(&ring->buf);
+
+	indio_dev->buffer = &ring->buf;
+	indio_dev->modes |= INDIO_BUFFER_HARDWARE;
+	indio_dev->setup_ops = &pru_gpio_setup_ops;
+
+	return 0;
+}
+
+#ifdef CONFIG_CPU_FREQ
+static int pru_gpio_cpufreq_transition(struct notifier_block *nb,
+				       unsigned long val, void *data)
+{
+	struct pru_gpio_state *st;
+
+	if (val != CPUFREQ_POSTCHANGE)
+		return 0;
+
+	st = container_of(nb, struct pru_gpio_state, freq_transition);
+	mutex_lock(&st->lock);
+	if (st->running)
+		pru_gpio_set_period(st);
+	mutex_unlock(&st->lock);
+
+	return 0;
+}
+
+static inline int pru_gpio_cpufreq_register(struct pru_gpio_state *st)
+{
+	st->freq_transition.notifier_call = pru_gpio_cpufreq_transition;
+
+	return cpufreq_register_notifier(&st->freq_transition,
+					 CPUFREQ_TRANSITION_NOTIFIER);
+}
+
+static inline void pru_gpio_cpufreq_deregister(struct pru_gpio_state *st)
+{
+	cpufreq_unregister_notifier(&st->freq_transition,
+				    CPUFREQ_TRANSITION_NOTIFIER);
+}
+#else
+static inline int pru_gpio_cpufreq_register(struct pru_gpio_state *st)
+{
+	return 0;
+}
+
+static inline void pru_gpio_cpufreq_deregister(struct pru_gpio_state *st)
+{
+}
+#endif
+
+/*
+ * Board code registers our device as a child of davinci_pruss, which
+ * exports the symbols we use and so is always probed first.
+ */
+static int __devinit pru_gpio_probe(struct platform_device *pdev)
+{
+	struct pru_gpio_state *st;
+	struct iio_dev *indio_dev;
+	int ret;
+
+	if (pru >= PRUSS_NUM_PRU)
+		return -EINVAL;
+
+	indio_dev = iio_allocate_device(sizeof(*st));
+	if (!indio_dev)
+		return -ENOMEM;
+
+	st = iio_priv(indio_dev);
+	st->dev = &pdev->dev;
+	mutex_init(&st->lock);
+	st->length = PG_DEFAULT_LENGTH;
+	st->rate = 1000000;
+	st->dram = pruss_dram(pru);
+	if (!st->dram) {
+		ret = -ENODEV;
+		goto error_free_dev;
+	}
+
+	st->clk = clk_get(pdev->dev.parent, "pruss");
+	if (IS_ERR(st->clk)) {
+		ret = PTR_ERR(st->clk);
+		goto error_free_dev;
+	}
+
+	st->gpio = ioremap(davinci_soc_info.gpio_base, SZ_4K);
+	if (!st->gpio) {
+		ret = -ENOMEM;
+		goto error_put_clk;
+	}
+
+	st->chan = pruss_chan_request(pru, 0, 2, 4, pru_gpio_notify,
+				      indio_dev);
+	if (IS_ERR(st->chan)) {
+		ret = PTR_ERR(st->chan);
+		goto error_unmap;
+	}
+
+	indio_dev->name = "davinci-pru-gpio";
+	indio_dev->dev.parent = &pdev->dev;
+	indio_dev->info = &pru_gpio_info;
+	indio_dev->channels = pru_gpio_channels;
+	indio_dev->num_channels = ARRAY_SIZE(pru_gpio_channels);
+	indio_dev->modes = INDIO_DIRECT_MODE;
+
+	ret = pru_gpio_configure_ring(indio_dev);
+	if (ret)
+		goto error_free_chan;
+
+	ret = pru_gpio_cpufreq_register(st);
+	if (ret)
+		goto error_free_ring;
+
+	ret = iio_device_register(indio_dev);
+	if (ret)
+		goto error_cpufreq;
+
+	ret = iio_buffer_register(indio_dev, pru_gpio_channels,
+				  ARRAY_SIZE(pru_gpio_channels));
+	if (ret)
+		goto error_unregister_dev;
+
+	platform_set_drvdata(pdev, indio_dev);
+	return 0;
+
+error_unregister_dev:
+	iio_device_unregister(indio_dev);
+error_cpufreq:
+	pru_gpio_cpufreq_deregister(st);
+error_free_ring:
+	kfree(iio_to_hw_buf(indio_dev->buffer));
+error_free_chan:
+	pruss_chan_free(st->chan);
+error_unmap:
+	iounmap(st->gpio);
+error_put_clk:
+	clk_put(st->clk);
+error_free_dev:
+	iio_free_device(indio_dev);
+	return ret;
+}
+
+static int __devexit pru_gpio_remove(struct platform_device *pdev)
+{
+	struct iio_dev *indio_dev = platform_get_drvdata(pdev);
+	struct pru_gpio_state *st = iio_priv(indio_dev);
+
+	iio_device_unregister(indio_dev);
+	iio_buffer_unregister(indio_dev);
+	pru_gpio_cpufreq_deregister(st);
+
+	pruss_halt(pru);
+	pruss_chan_free(st->chan);
+	pru_gpio_ring_free(st);
+	kfree(iio_to_hw_buf(indio_dev->buffer));
+	iounmap(st->gpio);
+	clk_put(st->clk);
+	platform_set_drvdata(pdev, NULL);
+	iio_free_device(indio_dev);
+
+	return 0;
+}
+
+static struct platform_driver pru_gpio_driver = {
+	.probe		= pru_gpio_probe,
+	.remove		= __devexit_p(pru_gpio_remove),
+	.driver		= {
+		.name	= "davinci_pru_gpio",
+		.owner	= THIS_MODULE,
+	},
+};
+
+static int __init pru_gpio_init(void)
+{
+	return platform_driver_register(&pru_gpio_driver);
+}
+module_init(pru_gpio_init);
+
+static void __exit pru_gpio_exit(void)
+{
+	platform_driver_unregister(&pru_gpio_driver);
+}
+module_exit(pru_gpio_exit);
+
+MODULE_DESCRIPTION("DA8xx PRU based GPIO sampler");
+MODULE_LICENSE("GPL v2");
+MODULE_ALIAS("platform:davinci_pru_gpio");
@@ -0,0 +1,53 @@
+/*
+ * Compressed RAM block device
+ *
+ * This code is released using a dual license strategy: BSD/GPL
+ * You can choose the licence that better fits your requirements.
+ *
+ * Released under the terms of 3-clause BSD License
+ * Released under the terms of GNU General Public License Version 2.0
+ */
+
+#ifndef _ZCOMP_H_
+#define _ZCOMP_H_
+
+#include <linux/crypto.h>
+#include <linux/list.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+
+/* Compression stream: a crypto tfm and a buffer to compress into */
+struct zcomp_strm {
+	struct crypto_comp *tfm;
+	/* compression output, two pages in case a page expands */
+	void *buffer;
+	struct list_head list;
+};
+
+/*
+ * Pool of compression streams.  Streams are allocated when the device
+ * is initialised, so the swap-out path never has to allocate them.
+ */
+struct zcomp {
+	spinlock_t strm_lock;		/* protects idle_strm */
+	struct list_head idle_strm;
+	wait_queue_head_t strm_wait;
+	int num_strm;
+};
+
+#define ZCOMP_BUF_SIZE	(2 * PAGE_SIZE)
+
+extern struct zcomp *zcomp_create(const char *name, int max_strm);
+extern void zcomp_destroy(struct zcomp *comp);
+
+extern struct zcomp_strm *zcomp_strm_find(struct zcomp *comp);
+extern void zcomp_strm_release(struct zcomp *comp, struct zcomp_strm *zstrm);
+
+extern int zcomp_compress(struct zcomp_strm *zstrm, const void *src,
+		size_t *dst_len);
+extern int zcomp_decompress(struct zcomp_strm *zstrm, const void *src,
+		size_t src_len, void *dst);
+
+extern int zcomp_available(const char *name);
+
+#endif
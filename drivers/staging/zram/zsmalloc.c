@@ -0,0 +1,594 @@
+/*
+ * zsmalloc memory allocator
+ *
+ * This code is released using a dual license strategy: BSD/GPL
+ * You can choose the licence that better fits your requirements.
+ *
+ * Released under the terms of 3-clause BSD License
+ * Released under the terms of GNU General Public License Version 2.0
+ */
+
+/*
+ * zsmalloc is a size-class allocator for compressed pages.  Unlike
+ * xvmalloc, which carves variable sized blocks out of single pages and
+ * loses the tail of every page, objects of a size class are packed back
+ * to back into zspages spanning several pages, so objects may cross a
+ * page boundary.  Such objects are copied into a per-cpu buffer while
+ * mapped.
+ *
+ * Users get an opaque handle rather than a <page, offset> pair, which
+ * lets zs_compact() move objects out of sparsely used zspages and free
+ * them.
+ */
+
+#ifdef CONFIG_ZRAM_DEBUG
+#define DEBUG
+#endif
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/bit_spinlock.h>
+#include <linux/errno.h>
+#include <linux/highmem.h>
+#include <linux/init.h>
+#include <linux/percpu.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+
+#include "zsmalloc.h"
+#include "zsmalloc_int.h"
+
+static struct kmem_cache *zs_handle_cache;
+
+/* Per-cpu state of the object currently mapped by zs_map_object() */
+struct mapping_area {
+	char *buf;		/* copy of an object spanning two pages */
+	void *vaddr;		/* kmap_atomic() address otherwise */
+};
+
+static DEFINE_PER_CPU(struct mapping_area, zs_map_area);
+
+static struct size_class *get_size_class(struct zs_pool *pool, size_t size)
+{
+	int idx = 0;
+
+	if (size > ZS_MIN_ALLOC_SIZE)
+		idx = DIV_ROUND_UP(size - ZS_MIN_ALLOC_SIZE,
+				ZS_SIZE_CLASS_DELTA);
+
+	return &pool->size_class[idx];
+}
+
+/*
+ * Find the number of pages per zspage that leaves least of the zspage
+ * unused for the given object size.
+ */
+static unsigned int get_pages_per_zspage(unsigned int size)
+{
+	unsigned int i, best = 1, max_usedpc = 0;
+
+	for (i = 1; i <= ZS_MAX_PAGES_PER_ZSPAGE; i++) {
+		unsigned int zspage_size = i * PAGE_SIZE;
+		unsigned int usedpc = (zspage_size - zspage_size % size) * 100 /
+					zspage_size;
+
+		if (usedpc > max_usedpc) {
+			max_usedpc = usedpc;
+			best = i;
+		}
+	}
+
+	return best;
+}
+
+static enum fullness_group get_fullness_group(struct size_class *class,
+					struct zspage *zspage)
+{
+	if (zspage->inuse == 0)
+		return ZS_EMPTY;
+	if (zspage->inuse == class->objs_per_zspage)
+		return ZS_FULL;
+	if (zspage->inuse * 100 > class->objs_per_zspage * ZS_ALMOST_FULL_PERC)
+		return ZS_ALMOST_FULL;
+	return ZS_ALMOST_EMPTY;
+}
+
+/*
+ * Move zspage to the list matching its fullness.  Empty zspages are
+ * taken off the lists; the caller frees them.
+ */
+static enum fullness_group fix_fullness_group(struct size_class *class,
+					struct zspage *zspage)
+{
+	enum fullness_group newfg = get_fullness_group(class, zspage);
+
+	if (newfg == zspage->fullness)
+		return newfg;
+
+	list_del(&zspage->list);
+	if (newfg != ZS_EMPTY)
+		list_add(&zspage->list, &class->fullness_list[newfg]);
+	zspage->fullness = newfg;
+
+	return newfg;
+}
+
+static void free_zspage(struct zs_pool *pool, struct size_class *class,
+			struct zspage *zspage)
+{
+	unsigned int i;
+
+	for (i = 0; i < class->pages_per_zspage; i++)
+		__free_page(zspage->pages[i]);
+	kfree(zspage);
+
+	class->zspages--;
+	atomic_long_sub(class->pages_per_zspage, &pool->pages_allocated);
+}
+
+static struct zspage *alloc_zspage(struct zs_pool *pool,
+				struct size_class *class)
+{
+	unsigned int i;
+	struct zspage *zspage;
+
+	zspage = kzalloc(sizeof(*zspage) +
+			class->objs_per_zspage * sizeof(zspage->objs[0]),
+			pool->flags & ~__GFP_HIGHMEM);
+	if (!zspage)
+		return NULL;
+
+	for (i = 0; i < class->pages_per_zspage; i++) {
+		zspage->pages[i] = alloc_page(pool->flags);
+		if (!zspage->pages[i])
+			goto fail;
+	}
+
+	/* Chain all objects on the free list */
+	for (i = 0; i < class->objs_per_zspage; i++)
+		zspage->objs[i] = ((i + 1) << 1) | OBJ_FREE_TAG;
+
+	INIT_LIST_HEAD(&zspage->list);
+	zspage->class = class;
+	zspage->fullness = ZS_EMPTY;
+	zspage->freeobj = 0;
+
+	return zspage;
+
+fail:
+	while (i--)
+		__free_page(zspage->pages[i]);
+	kfree(zspage);
+	return NULL;
+}
+
+/* Take a free object from zspage; called with class->lock held */
+static unsigned int obj_alloc(struct size_class *class, struct zspage *zspage,
+			struct zs_handle *handle)
+{
+	unsigned int idx = zspage->freeobj;
+
+	BUG_ON(!(zspage->objs[idx] & OBJ_FREE_TAG));
+
+	zspage->freeobj = zspage->objs[idx] >> 1;
+	zspage->objs[idx] = (unsigned long)handle;
+	zspage->inuse++;
+	class->objs_inuse++;
+
+	handle->zspage = zspage;
+	handle->idx = idx;
+
+	return idx;
+}
+
+static void obj_free(struct size_class *class, struct zspage *zspage,
+			unsigned int idx)
+{
+	zspage->objs[idx] = (zspage->freeobj << 1) | OBJ_FREE_TAG;
+	zspage->freeobj = idx;
+	zspage->inuse--;
+	class->objs_inuse--;
+}
+
+static struct zspage *find_free_zspage(struct size_class *class)
+{
+	if (!list_empty(&class->fullness_list[ZS_ALMOST_FULL]))
+		return list_first_entry(&class->fullness_list[ZS_ALMOST_FULL],
+					struct zspage, list);
+	if (!list_empty(&class->fullness_list[ZS_ALMOST_EMPTY]))
+		return list_first_entry(&class->fullness_list[ZS_ALMOST_EMPTY],
+					struct zspage, list);
+	return NULL;
+}
+
+/*
+ * Copy len bytes between an object and a linear buffer, one page at a
+ * time.  Called with preemption disabled.
+ */
+static void copy_object(struct size_class *class, struct zspage *zspage,
+			unsigned int idx, char *buf, int to_obj)
+{
+	unsigned long off = (unsigned long)idx * class->size;
+	unsigned int len = class->size;
+
+	while (len) {
+		struct page *page = zspage->pages[off >> PAGE_SHIFT];
+		unsigned int pg_off = off & ~PAGE_MASK;
+		unsigned int n = min_t(unsigned int, len, PAGE_SIZE - pg_off);
+		char *vaddr = kmap_atomic(page, KM_USER0);
+
+		if (to_obj)
+			memcpy(vaddr + pg_off, buf, n);
+		else
+			memcpy(buf, vaddr + pg_off, n);
+		kunmap_atomic(vaddr, KM_USER0);
+
+		off += n;
+		buf += n;
+		len -= n;
+	}
+}
+
+static int obj_spans_pages(struct size_class *class, unsigned int idx)
+{
+	unsigned long off = (unsigned long)idx * class->size;
+
+	return (off & ~PAGE_MASK) + class->size > PAGE_SIZE;
+}
+
+static void pin_handle(struct zs_handle *handle)
+{
+	bit_spin_lock(HANDLE_PIN_BIT, &handle->pin);
+}
+
+static int trypin_handle(struct zs_handle *handle)
+{
+	return bit_spin_trylock(HANDLE_PIN_BIT, &handle->pin);
+}
+
+static void unpin_handle(struct zs_handle *handle)
+{
+	bit_spin_unlock(HANDLE_PIN_BIT, &handle->pin);
+}
+
+/**
+ * zs_create_pool - Create a memory pool.
+ * @name: pool name, for messages
+ * @flags: allocation flags for the pages backing the pool
+ *
+ * Returns the new pool or NULL when out of memory.
+ */
+struct zs_pool *zs_create_pool(const char *name, gfp_t flags)
+{
+	int i, j;
+	struct zs_pool *pool;
+
+	if (!zs_handle_cache)
+		return NULL;
+
+	pool = kzalloc(sizeof(*pool), GFP_KERNEL);
+	if (!pool)
+		return NULL;
+
+	for (i = 0; i < ZS_SIZE_CLASSES; i++) {
+		struct size_class *class = &pool->size_class[i];
+
+		spin_lock_init(&class->lock);
+		for (j = 0; j < _ZS_NR_FULLNESS_GROUPS; j++)
+			INIT_LIST_HEAD(&class->fullness_list[j]);
+
+		class->size = ZS_MIN_ALLOC_SIZE + i * ZS_SIZE_CLASS_DELTA;
+		class->pages_per_zspage = get_pages_per_zspage(class->size);
+		class->objs_per_zspage = class->pages_per_zspage * PAGE_SIZE /
+					class->size;
+	}
+
+	pool->flags = flags;
+	pool->name = name;
+	atomic_long_set(&pool->pages_allocated, 0);
+
+	return pool;
+}
+EXPORT_SYMBOL_GPL(zs_create_pool);
+
+/*
+ * All objects must have been freed by now; anything left is leaked
+ * by the user and is freed here with a warning.
+ */
+void zs_destroy_pool(struct zs_pool *pool)
+{
+	int i, fg;
+
+	for (i = 0; i < ZS_SIZE_CLASSES; i++) {
+		struct size_class *class = &pool->size_class[i];
+		struct zspage *zspage, *tmp;
+
+		for (fg = 0; fg < _ZS_NR_FULLNESS_GROUPS; fg++) {
+			list_for_each_entry_safe(zspage, tmp,
+					&class->fullness_list[fg], list) {
+				pr_info("%s: freeing non-empty zspage, class "
+					"size %u\n", pool->name, class->size);
+				free_zspage(pool, class, zspage);
+			}
+		}
+	}
+
+	kfree(pool);
+}
+EXPORT_SYMBOL_GPL(zs_destroy_pool);
+
+/**
+ * zs_malloc - Allocate an object from the pool.
+ * @pool: pool to allocate from
+ * @size: object size, at most ZS_MAX_ALLOC_SIZE
+ *
+ * Returns a handle to the object, or 0 on failure.  The object must be
+ * mapped with zs_map_object() to access it.
+ */
+unsigned long zs_malloc(struct zs_pool *pool, size_t size)
+{
+	struct size_class *class;
+	struct zs_handle *handle;
+	struct zspage *zspage;
+
+	if (unlikely(!size || size > ZS_MAX_ALLOC_SIZE))
+		return 0;
+
+	handle = kmem_cache_zalloc(zs_handle_cache,
+				pool->flags & ~__GFP_HIGHMEM);
+	if (!handle)
+		return 0;
+
+	class = get_size_class(pool, size);
+
+	spin_lock(&class->lock);
+	zspage = find_free_zspage(class);
+	if (!zspage) {
+		spin_unlock(&class->lock);
+
+		zspage = alloc_zspage(pool, class);
+		if (unlikely(!zspage)) {
+			kmem_cache_free(zs_handle_cache, handle);
+			return 0;
+		}
+		atomic_long_add(class->pages_per_zspage,
+				&pool->pages_allocated);
+
+		spin_lock(&class->lock);
+		class->zspages++;
+	}
+
+	obj_alloc(class, zspage, handle);
+	fix_fullness_group(class, zspage);
+	spin_unlock(&class->lock);
+
+	return (unsigned long)handle;
+}
+EXPORT_SYMBOL_GPL(zs_malloc);
+
+void zs_free(struct zs_pool *pool, unsigned long obj)
+{
+	struct zs_handle *handle = (struct zs_handle *)obj;
+	struct size_class *class;
+	struct zspage *zspage;
+
+	if (unlikely(!handle))
+		return;
+
+	/* Keep compaction from moving the object while we free it */
+	pin_handle(handle);
+	zspage = handle->zspage;
+	class = zspage->class;
+
+	spin_lock(&class->lock);
+	obj_free(class, zspage, handle->idx);
+	if (fix_fullness_group(class, zspage) == ZS_EMPTY)
+		free_zspage(pool, class, zspage);
+	spin_unlock(&class->lock);
+	unpin_handle(handle);
+
+	kmem_cache_free(zs_handle_cache, handle);
+}
+EXPORT_SYMBOL_GPL(zs_free);
+
+/**
+ * zs_map_object - Get a pointer to an object.
+ * @pool: pool the object was allocated from
+ * @obj: handle returned by zs_malloc()
+ *
+ * The object stays mapped, and in place, until zs_unmap_object().  As
+ * with kmap_atomic(), the caller must not sleep meanwhile, and only one
+ * object can be mapped at a time.
+ */
+void *zs_map_object(struct zs_pool *pool, unsigned long obj)
+{
+	struct zs_handle *handle = (struct zs_handle *)obj;
+	struct mapping_area *area;
+	struct size_class *class;
+	unsigned long off;
+
+	pin_handle(handle);
+
+	area = &__get_cpu_var(zs_map_area);
+	class = handle->zspage->class;
+
+	if (unlikely(obj_spans_pages(class, handle->idx))) {
+		copy_object(class, handle->zspage, handle->idx, area->buf, 0);
+		return area->buf;
+	}
+
+	off = (unsigned long)handle->idx * class->size;
+	area->vaddr = kmap_atomic(handle->zspage->pages[off >> PAGE_SHIFT],
+				KM_USER1);
+	return area->vaddr + (off & ~PAGE_MASK);
+}
+EXPORT_SYMBOL_GPL(zs_map_object);
+
+void zs_unmap_object(struct zs_pool *pool, unsigned long obj)
+{
+	struct zs_handle *handle = (struct zs_handle *)obj;
+	struct mapping_area *area = &__get_cpu_var(zs_map_area);
+	struct size_class *class = handle->zspage->class;
+
+	if (unlikely(obj_spans_pages(class, handle->idx)))
+		copy_object(class, handle->zspage, handle->idx, area->buf, 1);
+	else
+		kunmap_atomic(area->vaddr, KM_USER1);
+
+	unpin_handle(handle);
+}
+EXPORT_SYMBOL_GPL(zs_unmap_object);
+
+/* Size of all pages backing the pool */
+u64 zs_get_total_size_bytes(struct zs_pool *pool)
+{
+	return (u64)atomic_long_read(&pool->pages_allocated) << PAGE_SHIFT;
+}
+EXPORT_SYMBOL_GPL(zs_get_total_size_bytes);
+
+/* Size of all objects in the pool, counting their size class rounding */
+u64 zs_get_obj_size_bytes(struct zs_pool *pool)
+{
+	int i;
+	u64 bytes = 0;
+
+	for (i = 0; i < ZS_SIZE_CLASSES; i++) {
+		struct size_class *class = &pool->size_class[i];
+
+		bytes += (u64)ACCESS_ONCE(class->objs_inuse) * class->size;
+	}
+
+	return bytes;
+}
+EXPORT_SYMBOL_GPL(zs_get_obj_size_bytes);
+
+/*
+ * Move one object from src to dst.  Fails if the object is mapped or
+ * being freed.  Called with class->lock held.
+ */
+static int migrate_object(struct size_class *class, struct zspage *src,
+			unsigned int idx, struct zspage *dst)
+{
+	struct zs_handle *handle = (struct zs_handle *)src->objs[idx];
+	struct mapping_area *area;
+
+	if (!trypin_handle(handle))
+		return 0;
+
+	area = &get_cpu_var(zs_map_area);
+	copy_object(class, src, idx, area->buf, 0);
+	obj_alloc(class, dst, handle);
+	copy_object(class, dst, handle->idx, area->buf, 1);
+	put_cpu_var(zs_map_area);
+
+	obj_free(class, src, idx);
+	unpin_handle(handle);
+
+	return 1;
+}
+
+/*
+ * Empty the almost empty zspages of a class into its other zspages, as
+ * long as the free objects add up to at least one whole zspage.
+ * Returns the number of pages freed.
+ */
+static unsigned long compact_class(struct zs_pool *pool,
+				struct size_class *class)
+{
+	unsigned long freed = 0;
+	struct zspage *src, *dst;
+	unsigned int idx;
+
+	spin_lock(&class->lock);
+	while (class->zspages * class->objs_per_zspage - class->objs_inuse >=
+			class->objs_per_zspage) {
+		struct list_head *empty =
+			&class->fullness_list[ZS_ALMOST_EMPTY];
+
+		if (list_empty(empty))
+			break;
+
+		/* Take the source off the lists so it is not a target */
+		src = list_entry(empty->prev, struct zspage, list);
+		list_del_init(&src->list);
+
+		for (idx = 0; idx < class->objs_per_zspage && src->inuse;
+				idx++) {
+			if (src->objs[idx] & OBJ_FREE_TAG)
+				continue;
+
+			dst = find_free_zspage(class);
+			if (!dst || !migrate_object(class, src, idx, dst))
+				break;
+			fix_fullness_group(class, dst);
+		}
+
+		if (src->inuse == 0) {
+			free_zspage(pool, class, src);
+			freed += class->pages_per_zspage;
+		} else {
+			/* Could not move everything, give up on this class */
+			list_add(&src->list, &class->fullness_list[src->fullness]);
+			fix_fullness_group(class, src);
+			break;
+		}
+
+		spin_unlock(&class->lock);
+		cond_resched();
+		spin_lock(&class->lock);
+	}
+	spin_unlock(&class->lock);
+
+	return freed;
+}
+
+/**
+ * zs_compact - Compact the pool.
+ * @pool: pool to compact
+ *
+ * Moves objects out of sparsely used zspages so they can be freed.
+ * Returns the number of pages freed.
+ */
+unsigned long zs_compact(struct zs_pool *pool)
+{
+	int i;
+	unsigned long freed = 0;
+
+	for (i = ZS_SIZE_CLASSES - 1; i >= 0; i--) {
+		freed += compact_class(pool, &pool->size_class[i]);
+		cond_resched();
+	}
+
+	return freed;
+}
+EXPORT_SYMBOL_GPL(zs_compact);
+
+static int __init zs_init(void)
+{
+	int cpu;
+
+	zs_handle_cache = kmem_cache_create("zs_handle",
+				sizeof(struct zs_handle), 0, 0, NULL);
+	if (!zs_handle_cache)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		struct mapping_area *area = &per_cpu(zs_map_area, cpu);
+
+		area->buf = kmalloc(ZS_MAX_ALLOC_SIZE, GFP_KERNEL);
+		if (!area->buf)
+			goto fail;
+	}
+
+	return 0;
+
+fail:
+	for_each_possible_cpu(cpu)
+		kfree(per_cpu(zs_map_area, cpu).buf);
+	kmem_cache_destroy(zs_handle_cache);
+	zs_handle_cache = NULL;
+	return -ENOMEM;
+}
+
+module_init(zs_init);
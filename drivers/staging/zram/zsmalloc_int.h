@@ -0,0 +1,100 @@
+/*
+ * zsmalloc memory allocator
+ *
+ * This code is released using a dual license strategy: BSD/GPL
+ * You can choose the licence that better fits your requirements.
+ *
+ * Released under the terms of 3-clause BSD License
+ * Released under the terms of GNU General Public License Version 2.0
+ */
+
+#ifndef _ZS_MALLOC_INT_H_
+#define _ZS_MALLOC_INT_H_
+
+#include <linux/kernel.h>
+#include <linux/list.h>
+#include <linux/spinlock.h>
+#include <linux/types.h>
+
+/*
+ * Objects are packed into "zspages" of up to ZS_MAX_PAGES_PER_ZSPAGE
+ * order-0 pages, which need not be physically contiguous.  An object
+ * may span two of the pages.  Each size class uses the number of pages
+ * per zspage that wastes least space at the end of the zspage.
+ */
+#define ZS_MAX_PAGES_PER_ZSPAGE	4
+
+#define ZS_MIN_ALLOC_SIZE	32
+#define ZS_MAX_ALLOC_SIZE	PAGE_SIZE
+
+/* Size classes are ZS_SIZE_CLASS_DELTA bytes apart */
+#define ZS_SIZE_CLASS_DELTA	(PAGE_SIZE >> 8)
+#define ZS_SIZE_CLASSES		((ZS_MAX_ALLOC_SIZE - ZS_MIN_ALLOC_SIZE) / \
+					ZS_SIZE_CLASS_DELTA + 1)
+
+/*
+ * A zspage is almost full when more than 3/4 of its objects are in use.
+ * Allocations are served from almost full zspages first, compaction
+ * moves objects out of almost empty ones.
+ */
+#define ZS_ALMOST_FULL_PERC	75
+
+enum fullness_group {
+	ZS_EMPTY,
+	ZS_ALMOST_EMPTY,
+	ZS_ALMOST_FULL,
+	ZS_FULL,
+	_ZS_NR_FULLNESS_GROUPS,
+};
+
+/*
+ * Each slot of zspage->objs holds either the handle of the object
+ * allocated there, or, tagged with OBJ_FREE_TAG, the index of the next
+ * free object shifted left by one.  Handles are pointers and so never
+ * have the tag bit set.
+ */
+#define OBJ_FREE_TAG		1UL
+
+struct size_class;
+
+struct zspage {
+	struct list_head list;		/* in class->fullness_list */
+	struct size_class *class;
+	enum fullness_group fullness;
+	unsigned int inuse;		/* objects in use */
+	unsigned int freeobj;		/* first free object */
+	struct page *pages[ZS_MAX_PAGES_PER_ZSPAGE];
+	unsigned long objs[0];
+};
+
+/*
+ * The handle returned to users.  It stays valid while the object is
+ * moved by compaction; the pin bit keeps the object in place while it
+ * is mapped.
+ */
+struct zs_handle {
+	struct zspage *zspage;
+	unsigned int idx;
+	unsigned long pin;
+};
+
+#define HANDLE_PIN_BIT		0
+
+struct size_class {
+	spinlock_t lock;		/* protects everything below */
+	struct list_head fullness_list[_ZS_NR_FULLNESS_GROUPS];
+	unsigned int size;		/* object size */
+	unsigned int pages_per_zspage;
+	unsigned int objs_per_zspage;
+	unsigned long zspages;		/* zspages allocated */
+	unsigned long objs_inuse;	/* objects allocated */
+};
+
+struct zs_pool {
+	struct size_class size_class[ZS_SIZE_CLASSES];
+	gfp_t flags;			/* allocation flags for data pages */
+	atomic_long_t pages_allocated;
+	const char *name;
+};
+
+#endif
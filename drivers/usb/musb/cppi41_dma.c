@@ -21,6 +21,7 @@
 
 #include <linux/errno.h>
 #include <linux/dma-mapping.h>
+#include <linux/scatterlist.h>
 #include <linux/module.h>
 
 #include "cppi41.h"
@@ -101,6 +102,12 @@ struct cppi41_channel {
 	u8  inf_mode;
 	u8  tx_complete;
 	u8  hb_mult;
+
+	/* Tx scatterlist position, sg is NULL for a linear buffer */
+	struct scatterlist *sg;
+	struct scatterlist *curr_sg;
+	u32 curr_sg_offset;
+	unsigned sgs_left;
 };
 
 /**
@@ -170,6 +177,32 @@ static void usb_put_free_pd(struct cppi41 *cppi, struct usb_pkt_desc *free_pd)
 	cppi->pd_pool_head = free_pd;
 }
 
+static struct usb_pkt_desc *usb_get_pd_ptr(struct cppi41 *cppi,
+					   unsigned long pd_addr)
+{
+	if (pd_addr >= cppi->pd_mem_phys && pd_addr < cppi->pd_mem_phys +
+	    USB_CPPI41_MAX_PD * USB_CPPI41_DESC_ALIGN)
+		return pd_addr - cppi->pd_mem_phys + cppi->pd_mem;
+	else
+		return NULL;
+}
+
+/*
+ * Return a packet descriptor together with any host buffer descriptors
+ * linked behind it (scatter-gather Tx packets) to the free pool.
+ */
+static void usb_put_free_pd_chain(struct cppi41 *cppi,
+				  struct usb_pkt_desc *free_pd)
+{
+	struct usb_pkt_desc *next_pd;
+
+	while (free_pd != NULL) {
+		next_pd = usb_get_pd_ptr(cppi, free_pd->hw_desc.next_desc_ptr);
+		usb_put_free_pd(cppi, free_pd);
+		free_pd = next_pd;
+	}
+}
+
 /**
  * cppi41_controller_start - start DMA controller
  * @controller: the controller
@@ -477,6 +510,8 @@ static struct dma_channel *cppi41_channel_alloc(struct dma_controller
 	cppi_ch->channel.status = MUSB_DMA_STATUS_FREE;
 	cppi_ch->channel.max_len = is_tx ?
 				CPPI41_TXDMA_MAXLEN : CPPI41_RXDMA_MAXLEN;
+	/* one descriptor per sg entry, from this channel's share of the pool */
+	cppi_ch->channel.max_sgs = is_tx ? USB_CPPI41_CH_NUM_PD : 0;
 
 	dev_dbg(musb->controller, "Allocated DMA %cx channel %d for EP%d\n", is_tx ? 'T' : 'R',
 	    ch_num, ep_num);
@@ -549,17 +584,125 @@ static void cppi41_mode_update(struct cppi41_channel *cppi_ch, u8 mode)
  *
  */
 
+/**
+ * usb_tx_fill_buffers - attach the next @len bytes of a Tx buffer to a PD
+ * @cppi:	the controller
+ * @tx_ch:	Tx channel
+ * @pd:		packet descriptor being built
+ * @len:	packet length
+ *
+ * A linear buffer always fits in the packet descriptor itself.  Packets
+ * spanning several scatterlist entries get host buffer descriptors, taken
+ * from the PD pool, linked behind the packet descriptor; the DMA sends the
+ * whole chain as one packet and, with the linked return policy, hands it
+ * back to the completion queue as one unit.
+ *
+ * Returns 0, or -ENOMEM if the pool ran dry, in which case the channel's
+ * scatterlist position is left untouched.
+ *
+ * Context: controller IRQ-locked
+ */
+static int usb_tx_fill_buffers(struct cppi41 *cppi,
+			       struct cppi41_channel *tx_ch,
+			       struct usb_pkt_desc *pd, u32 len)
+{
+	struct cppi41_host_pkt_desc *hw_desc = &pd->hw_desc;
+	struct scatterlist *sg = tx_ch->curr_sg;
+	u32 offset = tx_ch->curr_sg_offset;
+	unsigned sgs_left = tx_ch->sgs_left;
+	u32 *link = &hw_desc->next_desc_ptr;
+	u32 chunk;
+
+	hw_desc->next_desc_ptr = 0;
+
+	if (tx_ch->sg == NULL) {
+		hw_desc->buf_ptr = tx_ch->start_addr + tx_ch->curr_offset;
+		hw_desc->buf_len = len;
+		hw_desc->orig_buf_len = len;
+		return 0;
+	}
+
+	chunk = sg ? min(len, sg_dma_len(sg) - offset) : 0;
+	hw_desc->buf_ptr = sg ? sg_dma_address(sg) + offset : 0;
+	hw_desc->buf_len = chunk;
+	hw_desc->orig_buf_len = chunk;
+
+	for (;;) {
+		struct cppi41_host_buf_desc *buf_desc;
+		struct usb_pkt_desc *bd;
+
+		len -= chunk;
+		offset += chunk;
+		if (sg != NULL && offset == sg_dma_len(sg)) {
+			sg = --sgs_left ? sg_next(sg) : NULL;
+			offset = 0;
+		}
+		if (!len || sg == NULL)
+			break;
+
+		bd = usb_get_free_pd(cppi);
+		if (bd == NULL) {
+			usb_put_free_pd_chain(cppi, usb_get_pd_ptr(cppi,
+						hw_desc->next_desc_ptr));
+			hw_desc->next_desc_ptr = 0;
+			return -ENOMEM;
+		}
+
+		chunk = min(len, sg_dma_len(sg) - offset);
+
+		buf_desc = (struct cppi41_host_buf_desc *)&bd->hw_desc;
+		buf_desc->buf_recl_info = hw_desc->pkt_info &
+			(CPPI41_RETURN_QMGR_MASK | CPPI41_RETURN_QNUM_MASK);
+		buf_desc->buf_ptr = sg_dma_address(sg) + offset;
+		buf_desc->buf_len = chunk;
+		buf_desc->next_desc_ptr = 0;
+		buf_desc->orig_buf_ptr = buf_desc->buf_ptr;
+		buf_desc->orig_buf_len = chunk;
+
+		bd->ch_num = tx_ch->ch_num;
+		bd->ep_num = tx_ch->end_pt->epnum;
+
+		*link = bd->dma_addr;
+		link = &buf_desc->next_desc_ptr;
+	}
+
+	tx_ch->curr_sg = sg;
+	tx_ch->curr_sg_offset = offset;
+	tx_ch->sgs_left = sgs_left;
+	return 0;
+}
+
+static void usb_tx_push_pd(struct cppi41_channel *tx_ch,
+			   struct usb_pkt_desc *pd, u8 intr)
+{
+	struct cppi41_host_pkt_desc *hw_desc = &pd->hw_desc;
+
+	if (intr)
+		hw_desc->orig_buf_len |= CPPI41_PKT_INTR_FLAG;
+
+	/* make sure descriptor details are updated to memory*/
+	dsb();
+
+	cppi41_queue_push(&tx_ch->queue_obj, pd->dma_addr,
+			  USB_CPPI41_DESC_ALIGN,
+			  hw_desc->desc_info & CPPI41_PKT_LEN_MASK);
+}
+
 /**
  * cppi41_next_tx_segment - DMA write for the next chunk of a buffer
  * @tx_ch:	Tx channel
  *
+ * Each PD is pushed only once the next one has been built, so that with
+ * BD interrupts enabled only the last PD queued by a call asks for a
+ * completion interrupt, even if the PD pool runs dry half way.
+ *
  * Context: controller IRQ-locked
  */
 static unsigned cppi41_next_tx_segment(struct cppi41_channel *tx_ch)
 {
 	struct cppi41 *cppi = tx_ch->channel.private_data;
 	struct musb *musb = cppi->musb;
-	struct usb_pkt_desc *curr_pd;
+	struct usb_pkt_desc *curr_pd, *prev_pd = NULL;
 	u32 length = tx_ch->length - tx_ch->curr_offset;
 	u32 pkt_size = tx_ch->pkt_size;
 	unsigned num_pds, n;
@@ -614,10 +757,11 @@ static unsigned cppi41_next_tx_segment(struct cppi41_channel *tx_ch)
 		hw_desc->pkt_info |= ((q_mgr << CPPI41_RETURN_QMGR_SHIFT) |
 				(tx_comp_q << CPPI41_RETURN_QNUM_SHIFT));
 
-		hw_desc->buf_ptr = tx_ch->start_addr + tx_ch->curr_offset;
-		hw_desc->buf_len = pkt_size;
-		hw_desc->next_desc_ptr = 0;
-		hw_desc->orig_buf_len = pkt_size;
+		if (usb_tx_fill_buffers(cppi, tx_ch, curr_pd, pkt_size)) {
+			dev_dbg(musb->controller, "No Tx BDs\n");
+			usb_put_free_pd(cppi, curr_pd);
+			break;
+		}
 
 		curr_pd->ch_num = tx_ch->ch_num;
 		curr_pd->ep_num = tx_ch->end_pt->epnum;
@@ -628,19 +772,17 @@ static unsigned cppi41_next_tx_segment(struct cppi41_channel *tx_ch)
 		if (pkt_size == 0)
 			tx_ch->zlp_queued = 1;
 
-		if (en_bd_intr)
-			hw_desc->orig_buf_len |= CPPI41_PKT_INTR_FLAG;
-
 		dev_dbg(musb->controller, "TX PD %p: buf %08x, len %08x, pkt info %08x\n", curr_pd,
 		    hw_desc->buf_ptr, hw_desc->buf_len, hw_desc->pkt_info);
 
-		/* make sure descriptor details are updated to memory*/
-		dsb();
-
-		cppi41_queue_push(&tx_ch->queue_obj, curr_pd->dma_addr,
-				  USB_CPPI41_DESC_ALIGN, pkt_size);
+		if (prev_pd != NULL)
+			usb_tx_push_pd(tx_ch, prev_pd, 0);
+		prev_pd = curr_pd;
 	}
 
+	if (prev_pd != NULL)
+		usb_tx_push_pd(tx_ch, prev_pd, en_bd_intr);
+
 	return n;
 }
 
@@ -831,6 +973,7 @@ static unsigned cppi41_next_rx_segment(struct cppi41_channel *rx_ch)
 				      CPPI41_DESC_TYPE_SHIFT);
 		hw_desc->orig_buf_ptr = rx_ch->start_addr + rx_ch->curr_offset;
 		hw_desc->orig_buf_len = pkt_len;
+		hw_desc->next_desc_ptr = 0;
 
 		/* buf_len field of buffer descriptor updated by dma
 		 * after reception of data is completed
@@ -893,21 +1036,10 @@ sched:
 	return 1;
 }
 
-/**
- * cppi41_channel_program - program channel for data transfer
- * @channel:	the channel
- * @maxpacket:	max packet size
- * @mode:	for Rx, 1 unless the USB protocol driver promised to treat
- *		all short reads as errors and kick in high level fault recovery;
- *		for Tx, 0 unless the protocol driver _requires_ short-packet
- *		termination mode
- * @dma_addr:	DMA address of buffer
- * @length:	length of buffer
- *
- * Context: controller IRQ-locked
- */
-static int cppi41_channel_program(struct dma_channel *channel,	u16 maxpacket,
-				  u8 mode, dma_addr_t dma_addr, u32 length)
+static int __cppi41_channel_program(struct dma_channel *channel,
+				    u16 maxpacket, u8 mode, dma_addr_t dma_addr,
+				    struct scatterlist *sg, unsigned num_sgs,
+				    u32 length)
 {
 	struct cppi41_channel *cppi_ch;
 	unsigned queued;
@@ -944,6 +1076,10 @@ static int cppi41_channel_program(struct dma_channel *channel,	u16 maxpacket,
 	cppi_ch->transfer_mode = mode;
 	cppi_ch->zlp_queued = 0;
 	cppi_ch->channel.actual_len = 0;
+	cppi_ch->sg = sg;
+	cppi_ch->curr_sg = sg;
+	cppi_ch->curr_sg_offset = 0;
+	cppi_ch->sgs_left = num_sgs;
 
 	/* Tx or Rx channel? */
 	if (cppi_ch->transmit)
@@ -954,14 +1090,55 @@ static int cppi41_channel_program(struct dma_channel *channel,	u16 maxpacket,
 	return	queued > 0;
 }
 
-static struct usb_pkt_desc *usb_get_pd_ptr(struct cppi41 *cppi,
-					   unsigned long pd_addr)
+/**
+ * cppi41_channel_program - program channel for data transfer
+ * @channel:	the channel
+ * @maxpacket:	max packet size
+ * @mode:	for Rx, 1 unless the USB protocol driver promised to treat
+ *		all short reads as errors and kick in high level fault recovery;
+ *		for Tx, 0 unless the protocol driver _requires_ short-packet
+ *		termination mode
+ * @dma_addr:	DMA address of buffer
+ * @length:	length of buffer
+ *
+ * Context: controller IRQ-locked
+ */
+static int cppi41_channel_program(struct dma_channel *channel,	u16 maxpacket,
+				  u8 mode, dma_addr_t dma_addr, u32 length)
 {
-	if (pd_addr >= cppi->pd_mem_phys && pd_addr < cppi->pd_mem_phys +
-	    USB_CPPI41_MAX_PD * USB_CPPI41_DESC_ALIGN)
-		return pd_addr - cppi->pd_mem_phys + cppi->pd_mem;
-	else
-		return NULL;
+	return __cppi41_channel_program(channel, maxpacket, mode, dma_addr,
+					NULL, 0, length);
+}
+
+/**
+ * cppi41_channel_program_sg - program channel for a scatter-gather transfer
+ * @channel:	the channel
+ * @maxpacket:	max packet size
+ * @mode:	as for cppi41_channel_program()
+ * @sg:		DMA-mapped scatterlist
+ * @num_sgs:	number of mapped entries in @sg
+ * @length:	total length of the transfer
+ *
+ * Only Tx is supported: in generic RNDIS mode the whole list goes out as a
+ * single packet descriptor with linked buffer descriptors, so the transfer
+ * completes with one completion queue entry.  Rx would need the DMA to
+ * pull differently sized free buffers per packet, which it can't.
+ *
+ * Context: controller IRQ-locked
+ */
+static int cppi41_channel_program_sg(struct dma_channel *channel,
+				     u16 maxpacket, u8 mode,
+				     struct scatterlist *sg, unsigned num_sgs,
+				     u32 length)
+{
+	struct cppi41_channel *cppi_ch;
+
+	cppi_ch = container_of(channel, struct cppi41_channel, channel);
+	if (!cppi_ch->transmit || !num_sgs)
+		return 0;
+
+	return __cppi41_channel_program(channel, maxpacket, mode, 0,
+					sg, num_sgs, length);
 }
 
 static int usb_check_teardown(struct cppi41_channel *cppi_ch,
@@ -1058,7 +1235,7 @@ static void usb_tx_ch_teardown(struct cppi41_channel *tx_ch)
 		dev_dbg(musb->controller, "ch(%d)epnum(%d)len(%d)\n", curr_pd->ch_num,
 			curr_pd->ep_num, curr_pd->hw_desc.buf_len);
 
-		usb_put_free_pd(cppi, curr_pd);
+		usb_put_free_pd_chain(cppi, curr_pd);
 	}
 }
 
@@ -1291,7 +1468,7 @@ static int cppi41_channel_abort(struct dma_channel *channel)
 		 * this is protected by critical section.
 		 */
 		dprintk("Returning PD %p to the free PD list\n", curr_pd);
-		usb_put_free_pd(cppi, curr_pd);
+		usb_put_free_pd_chain(cppi, curr_pd);
 	}
 
 #ifdef DEBUG_CPPI_TD
@@ -1385,6 +1562,7 @@ cppi41_dma_controller_create(struct musb  *musb, void __iomem *mregs)
 	cppi->controller.channel_alloc = cppi41_channel_alloc;
 	cppi->controller.channel_release = cppi41_channel_release;
 	cppi->controller.channel_program = cppi41_channel_program;
+	cppi->controller.channel_program_sg = cppi41_channel_program_sg;
 	cppi->controller.channel_abort = cppi41_channel_abort;
 	cppi->cppi_info = (struct usb_cppi41_info *)&usb_cppi41_info[0];;
 	cppi->en_bd_intr = cppi->cppi_info->bd_intr_ctrl;
@@ -1424,26 +1602,30 @@ void cppi41_dma_controller_destroy(struct dma_controller *controller)
 }
 EXPORT_SYMBOL(cppi41_dma_controller_destroy);
 
-static void usb_process_tx_queue(struct cppi41 *cppi, unsigned index)
+static unsigned usb_process_tx_queue(struct cppi41 *cppi, unsigned index,
+				     unsigned budget)
 {
 	struct cppi41_queue_obj tx_queue_obj;
 	unsigned long pd_addr;
 	struct usb_cppi41_info *cppi_info = cppi->cppi_info;
 	struct musb *musb = cppi->musb;
+	unsigned done = 0;
 
 	if (cppi41_queue_init(&tx_queue_obj, cppi_info->q_mgr,
 			      cppi_info->tx_comp_q[index])) {
 		dev_dbg(musb->controller, "ERROR: cppi41_queue_init failed for "
 		    "Tx completion queue");
-		return;
+		return 0;
 	}
 
-	while ((pd_addr = cppi41_queue_pop(&tx_queue_obj)) != 0) {
+	while (done < budget &&
+	       (pd_addr = cppi41_queue_pop(&tx_queue_obj)) != 0) {
 		struct usb_pkt_desc *curr_pd;
 		struct cppi41_channel *tx_ch;
 		u8 ch_num, ep_num;
 		u32 length;
 
+		done++;
 		curr_pd = usb_get_pd_ptr(cppi, pd_addr);
 		if (curr_pd == NULL) {
 			ERR("Invalid PD popped from Tx completion queue\n");
@@ -1453,16 +1635,16 @@ static void usb_process_tx_queue(struct cppi41 *cppi, unsigned index)
 		/* Extract the data from received packet descriptor */
 		ch_num = curr_pd->ch_num;
 		ep_num = curr_pd->ep_num;
-		length = curr_pd->hw_desc.buf_len;
+		length = curr_pd->hw_desc.desc_info & CPPI41_PKT_LEN_MASK;
 
 		tx_ch = &cppi->tx_cppi_ch[ch_num];
 		tx_ch->channel.actual_len += length;
 
 		/*
-		 * Return Tx PD to the software list --
-		 * this is protected by critical section
+		 * Return Tx PD and its buffer descriptors to the software
+		 * list -- this is protected by critical section
 		 */
-		usb_put_free_pd(cppi, curr_pd);
+		usb_put_free_pd_chain(cppi, curr_pd);
 
 		if ((tx_ch->curr_offset < tx_ch->length) ||
 		    (tx_ch->transfer_mode && !tx_ch->zlp_queued))
@@ -1480,28 +1662,34 @@ static void usb_process_tx_queue(struct cppi41 *cppi, unsigned index)
 			schedule_work(&cppi->txdma_work);
 		}
 	}
+
+	return done;
 }
 
-static void usb_process_rx_queue(struct cppi41 *cppi, unsigned index)
+static unsigned usb_process_rx_queue(struct cppi41 *cppi, unsigned index,
+				     unsigned budget)
 {
 	struct cppi41_queue_obj rx_queue_obj;
 	unsigned long pd_addr;
 	struct usb_cppi41_info *cppi_info = cppi->cppi_info;
 	struct musb *musb = cppi->musb;
 	u8 en_bd_intr = cppi->en_bd_intr;
+	unsigned done = 0;
 
 	if (cppi41_queue_init(&rx_queue_obj, cppi_info->q_mgr,
 			      cppi_info->rx_comp_q[index])) {
 		dev_dbg(musb->controller, "ERROR: cppi41_queue_init failed for Rx queue\n");
-		return;
+		return 0;
 	}
 
-	while ((pd_addr = cppi41_queue_pop(&rx_queue_obj)) != 0) {
+	while (done < budget &&
+	       (pd_addr = cppi41_queue_pop(&rx_queue_obj)) != 0) {
 		struct usb_pkt_desc *curr_pd;
 		struct cppi41_channel *rx_ch;
 		u8 ch_num, ep_num;
 		u32 length = 0, orig_buf_len, timeout = 50;
 
+		done++;
 		curr_pd = usb_get_pd_ptr(cppi, pd_addr);
 		if (curr_pd == NULL) {
 			ERR("Invalid PD popped from Rx completion queue\n");
@@ -1603,30 +1791,48 @@ static void usb_process_rx_queue(struct cppi41 *cppi, unsigned index)
 				cppi41_next_rx_segment(rx_ch);
 		}
 	}
+
+	return done;
 }
 
 /*
- * cppi41_completion - handle interrupts from the Tx/Rx completion queues
+ * cppi41_poll - process at most @budget completed descriptors
+ *
+ * Returns the number of descriptors popped; when that equals @budget
+ * the queues may still hold more.
  *
  * NOTE: since we have to manually prod the Rx process in the transparent mode,
  *	 we certainly want to handle the Rx queues first.
  */
-void cppi41_completion(struct musb *musb, u32 rx, u32 tx)
+unsigned cppi41_poll(struct musb *musb, u32 rx, u32 tx, unsigned budget)
 {
 	struct cppi41 *cppi;
-	unsigned index;
+	unsigned index, done = 0;
 
 	cppi = container_of(musb->dma_controller, struct cppi41, controller);
 
 	/* Process packet descriptors from the Rx queues */
 	for (index = 0; rx != 0; rx >>= 1, index++)
 		if (rx & 1)
-			usb_process_rx_queue(cppi, index);
+			done += usb_process_rx_queue(cppi, index,
+						     budget - done);
 
 	/* Process packet descriptors from the Tx completion queues */
 	for (index = 0; tx != 0; tx >>= 1, index++)
 		if (tx & 1)
-			usb_process_tx_queue(cppi, index);
+			done += usb_process_tx_queue(cppi, index,
+						     budget - done);
+
+	return done;
+}
+EXPORT_SYMBOL(cppi41_poll);
+
+/*
+ * cppi41_completion - handle interrupts from the Tx/Rx completion queues
+ */
+void cppi41_completion(struct musb *musb, u32 rx, u32 tx)
+{
+	cppi41_poll(musb, rx, tx, UINT_MAX);
 }
 EXPORT_SYMBOL(cppi41_completion);
 
@@ -62,4 +62,15 @@ extern struct usb_cppi41_info usb_cppi41_info[];
  * @tx:	bitmask having bit N set if Tx completion queue N is not empty
  */
 void cppi41_completion(struct musb *musb, u32 rx, u32 tx);
+
+/**
+ * cppi41_poll - budgeted Tx/Rx completion queue processing
+ * @musb:	the controller
+ * @rx:	bitmask having bit N set if Rx queue N is not empty
+ * @tx:	bitmask having bit N set if Tx completion queue N is not empty
+ * @budget:	maximum number of descriptors to pop
+ *
+ * Returns the number of descriptors popped.
+ */
+unsigned cppi41_poll(struct musb *musb, u32 rx, u32 tx, unsigned budget);
 #endif	/* _CPPI41_DMA_H_ */
@@ -32,6 +32,8 @@
 #include <linux/io.h>
 #include <linux/platform_device.h>
 #include <linux/dma-mapping.h>
+#include <linux/interrupt.h>
+#include <linux/hrtimer.h>
 
 #include <mach/da8xx.h>
 #include <mach/usb.h>
@@ -87,8 +89,31 @@ struct da8xx_glue {
 	struct device		*dev;
 	struct platform_device	*musb;
 	struct clk		*clk;
+#ifdef CONFIG_USB_TI_CPPI41_DMA
+	/*
+	 * Completion interrupt pacing.  With pacing_us set, the first
+	 * completion queue interrupt masks the endpoint interrupt bits in
+	 * the wrapper and defers queue processing to a tasklet which pops
+	 * at most poll_budget descriptors per run.  The queue manager has
+	 * no per-queue interrupt mask, so the EOI is withheld until the
+	 * queues are drained and pacing_us has passed; a burst of short
+	 * packets then costs one interrupt rather than one per descriptor.
+	 */
+	struct musb		*core;
+	struct tasklet_struct	poll_tasklet;
+	struct hrtimer		pacing_timer;
+	unsigned		pacing_us;
+	unsigned		poll_budget;
+	bool			paced;
+	u32			paced_mask;
+#endif
 };
 
+static inline struct da8xx_glue *musb_to_glue(struct musb *musb)
+{
+	return dev_get_drvdata(musb->controller->parent);
+}
+
 #ifdef CONFIG_USB_TI_CPPI41_DMA
 #define CPPI41_QMGR_REG0SIZE	0x3fff
 /*
@@ -315,6 +340,14 @@ static void da8xx_musb_disable(struct musb *musb)
 	musb_writel(reg_base, DA8XX_USB_INTR_MASK_CLEAR_REG,
 		    DA8XX_INTR_USB_MASK |
 		    DA8XX_INTR_TX_MASK | DA8XX_INTR_RX_MASK);
+#ifdef CONFIG_USB_TI_CPPI41_DMA
+	/* Don't let the end of a pacing window unmask the endpoints. */
+	if (is_cppi41_enabled(musb)) {
+		struct da8xx_glue *glue = musb_to_glue(musb);
+
+		glue->paced_mask = 0;
+	}
+#endif
 	musb_writeb(musb->mregs, MUSB_DEVCTL, 0);
 	musb_writel(reg_base, DA8XX_USB_END_OF_INTR_REG, 0);
 }
@@ -436,6 +469,93 @@ static void da8xx_musb_try_idle(struct musb *musb, unsigned long timeout)
 	mod_timer(&otg_workaround, timeout);
 }
 
+#ifdef CONFIG_USB_TI_CPPI41_DMA
+/* called with musb->lock held */
+static void cppi41_pacing_start(struct da8xx_glue *glue)
+{
+	void __iomem *reg_base = glue->core->ctrl_base;
+
+	if (glue->paced)
+		return;
+
+	glue->paced = true;
+	glue->paced_mask = musb_readl(reg_base, DA8XX_USB_INTR_MASK_REG) &
+			   (DA8XX_INTR_TX_MASK | DA8XX_INTR_RX_MASK);
+	musb_writel(reg_base, DA8XX_USB_INTR_MASK_CLEAR_REG, glue->paced_mask);
+}
+
+/* called with musb->lock held */
+static void cppi41_pacing_stop(struct da8xx_glue *glue)
+{
+	void __iomem *reg_base = glue->core->ctrl_base;
+
+	if (!glue->paced)
+		return;
+
+	glue->paced = false;
+	if (glue->paced_mask)
+		musb_writel(reg_base, DA8XX_USB_INTR_MASK_SET_REG,
+			    glue->paced_mask);
+	glue->paced_mask = 0;
+
+	/* Let the wrapper raise whatever got latched meanwhile. */
+	musb_writel(reg_base, DA8XX_USB_END_OF_INTR_REG, 0);
+}
+
+static enum hrtimer_restart cppi41_pacing_expired(struct hrtimer *timer)
+{
+	struct da8xx_glue *glue = container_of(timer, struct da8xx_glue,
+					       pacing_timer);
+	struct musb *musb = glue->core;
+	unsigned long flags;
+
+	spin_lock_irqsave(&musb->lock, flags);
+	cppi41_pacing_stop(glue);
+	spin_unlock_irqrestore(&musb->lock, flags);
+
+	return HRTIMER_NORESTART;
+}
+
+static bool da8xx_cppi41_paced(struct musb *musb)
+{
+	return is_cppi41_enabled(musb) && musb_to_glue(musb)->paced;
+}
+
+static void cppi41_poll_queues(unsigned long data)
+{
+	struct da8xx_glue *glue = (struct da8xx_glue *)data;
+	struct musb *musb = glue->core;
+	void __iomem *reg_base = musb->ctrl_base;
+	unsigned long flags;
+	unsigned budget, done = 0;
+	u32 pend0;
+
+	spin_lock_irqsave(&musb->lock, flags);
+
+	budget = glue->poll_budget ? : 1;
+	pend0 = musb_readl(reg_base, 0x4000 + QMGR_QUEUE_PENDING_REG(0));
+	if (pend0 & (0xf << 24))
+		done = cppi41_poll(musb, (pend0 >> 26) & 0x3,
+				   (pend0 >> 24) & 0x3, budget);
+
+	if (done == budget)
+		tasklet_schedule(&glue->poll_tasklet);
+	else if (glue->pacing_us)
+		hrtimer_start(&glue->pacing_timer,
+			      ns_to_ktime(glue->pacing_us * NSEC_PER_USEC),
+			      HRTIMER_MODE_REL);
+	else
+		cppi41_pacing_stop(glue);
+
+	spin_unlock_irqrestore(&musb->lock, flags);
+}
+#else
+static inline bool da8xx_cppi41_paced(struct musb *musb)
+{
+	return false;
+}
+#endif
+
 static irqreturn_t da8xx_musb_interrupt(int irq, void *hci)
 {
 	struct musb		*musb = hci;
@@ -448,6 +568,8 @@ static irqreturn_t da8xx_musb_interrupt(int irq, void *hci)
 
 #ifdef CONFIG_USB_TI_CPPI41_DMA
 	if (is_cppi41_enabled(musb)) {
+		struct da8xx_glue *glue = musb_to_glue(musb);
+
 		/*
 		 * Check for the interrupts from Tx/Rx completion queues; they
 		 * are level-triggered and will stay asserted until the queues
@@ -462,7 +584,18 @@ static irqreturn_t da8xx_musb_interrupt(int irq, void *hci)
 			u32 rx = (pend0 >> 26) & 0x3;
 
 			pr_debug("CPPI 4.1 IRQ: Tx %x, Rx %x\n", tx, rx);
-			cppi41_completion(musb, rx, tx);
+			if (glue->pacing_us || glue->paced) {
+				/*
+				 * The queues are level-triggered and can't be
+				 * masked individually; the poll tasklet
+				 * drains them and cppi41_pacing_stop() writes
+				 * the EOI once the pacing window has passed.
+				 */
+				cppi41_pacing_start(glue);
+				tasklet_schedule(&glue->poll_tasklet);
+			} else {
+				cppi41_completion(musb, rx, tx);
+			}
 			ret = IRQ_HANDLED;
 		}
 	}
@@ -543,8 +676,11 @@ static irqreturn_t da8xx_musb_interrupt(int irq, void *hci)
 		ret |= musb_interrupt(musb);
 
  eoi:
-	/* EOI needs to be written for the IRQ to be re-asserted. */
-	if (ret == IRQ_HANDLED || status)
+	/*
+	 * EOI needs to be written for the IRQ to be re-asserted.  While
+	 * completions are being paced that's left to cppi41_pacing_stop().
+	 */
+	if ((ret == IRQ_HANDLED || status) && !da8xx_cppi41_paced(musb))
 		musb_writel(reg_base, DA8XX_USB_END_OF_INTR_REG, 0);
 
 	/* Poll for ID change */
@@ -582,6 +718,9 @@ static int da8xx_musb_set_mode(struct musb *musb, u8 musb_mode)
 static int __devinit da8xx_musb_init(struct musb *musb)
 {
 	void __iomem *reg_base = musb->ctrl_base;
+#ifdef CONFIG_USB_TI_CPPI41_DMA
+	struct da8xx_glue *glue;
+#endif
 	u32 rev;
 
 	musb->mregs += DA8XX_MENTOR_CORE_OFFSET;
@@ -610,6 +749,13 @@ static int __devinit da8xx_musb_init(struct musb *musb)
 	msleep(5);
 
 #ifdef CONFIG_USB_TI_CPPI41_DMA
+	glue = musb_to_glue(musb);
+	glue->core = musb;
+	tasklet_init(&glue->poll_tasklet, cppi41_poll_queues,
+		     (unsigned long)glue);
+	hrtimer_init(&glue->pacing_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	glue->pacing_timer.function = cppi41_pacing_expired;
+
 	cppi41_init(musb);
 #endif
 
@@ -643,9 +789,25 @@ void cppi41_free(void)
 
 static int da8xx_musb_exit(struct musb *musb)
 {
+#ifdef CONFIG_USB_TI_CPPI41_DMA
+	struct da8xx_glue *glue = musb_to_glue(musb);
+#endif
+
 	if (is_host_enabled(musb))
 		del_timer_sync(&otg_workaround);
 
+#ifdef CONFIG_USB_TI_CPPI41_DMA
+	/*
+	 * The ISR can reschedule the poll tasklet, which in turn restarts
+	 * the pacing timer, so quiesce the IRQ before stopping them.  The
+	 * line stays disabled; musb_free() releases it after us.
+	 */
+	if (musb->nIrq >= 0)
+		disable_irq(musb->nIrq);
+	tasklet_kill(&glue->poll_tasklet);
+	hrtimer_cancel(&glue->pacing_timer);
+#endif
+
 	phy_off();
 
 	otg_put_transceiver(musb->xceiv);
@@ -680,6 +842,88 @@ static const struct musb_platform_ops da8xx_ops = {
 	.dis_sof = da8xx_musb_disable_sof,
 };
 
+#ifdef CONFIG_USB_TI_CPPI41_DMA
+static ssize_t cppi41_pacing_us_show(struct device *dev,
+				     struct device_attribute *attr, char *buf)
+{
+	struct da8xx_glue *glue = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%u\n", glue->pacing_us);
+}
+
+static ssize_t cppi41_pacing_us_store(struct device *dev,
+				      struct device_attribute *attr,
+				      const char *buf, size_t n)
+{
+	struct da8xx_glue *glue = dev_get_drvdata(dev);
+	unsigned long val;
+
+	if (strict_strtoul(buf, 0, &val) || val > USEC_PER_SEC)
+		return -EINVAL;
+
+	glue->pacing_us = val;
+	return n;
+}
+static DEVICE_ATTR(cppi41_pacing_us, 0644, cppi41_pacing_us_show,
+		   cppi41_pacing_us_store);
+
+static ssize_t cppi41_poll_budget_show(struct device *dev,
+				       struct device_attribute *attr, char *buf)
+{
+	struct da8xx_glue *glue = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%u\n", glue->poll_budget);
+}
+
+static ssize_t cppi41_poll_budget_store(struct device *dev,
+					struct device_attribute *attr,
+					const char *buf, size_t n)
+{
+	struct da8xx_glue *glue = dev_get_drvdata(dev);
+	unsigned long val;
+
+	if (strict_strtoul(buf, 0, &val) || !val)
+		return -EINVAL;
+
+	glue->poll_budget = val;
+	return n;
+}
+static DEVICE_ATTR(cppi41_poll_budget, 0644, cppi41_poll_budget_show,
+		   cppi41_poll_budget_store);
+
+static struct attribute *da8xx_cppi41_attributes[] = {
+	&dev_attr_cppi41_pacing_us.attr,
+	&dev_attr_cppi41_poll_budget.attr,
+	NULL
+};
+
+static const struct attribute_group da8xx_cppi41_attr_group = {
+	.attrs = da8xx_cppi41_attributes,
+};
+
+static int da8xx_cppi41_sysfs_init(struct da8xx_glue *glue)
+{
+	/* Pacing is off until enabled through sysfs. */
+	glue->poll_budget = 32;
+
+	return sysfs_create_group(&glue->dev->kobj, &da8xx_cppi41_attr_group);
+}
+
+static void da8xx_cppi41_sysfs_exit(struct da8xx_glue *glue)
+{
+	sysfs_remove_group(&glue->dev->kobj, &da8xx_cppi41_attr_group);
+}
+#else
+static inline int da8xx_cppi41_sysfs_init(struct da8xx_glue *glue)
+{
+	return 0;
+}
+
+static inline void da8xx_cppi41_sysfs_exit(struct da8xx_glue *glue)
+{
+}
+#endif
+
 static u64 da8xx_dmamask = DMA_BIT_MASK(32);
 
 static int __init da8xx_probe(struct platform_device *pdev)
@@ -729,29 +973,38 @@ static int __init da8xx_probe(struct platform_device *pdev)
 
 	platform_set_drvdata(pdev, glue);
 
+	ret = da8xx_cppi41_sysfs_init(glue);
+	if (ret) {
+		dev_err(&pdev->dev, "failed to create sysfs attributes\n");
+		goto err4;
+	}
+
 	pdev->resource->parent = NULL;
 
 	ret = platform_device_add_resources(musb, pdev->resource,
 			pdev->num_resources);
 	if (ret) {
 		dev_err(&pdev->dev, "failed to add resources\n");
-		goto err4;
+		goto err5;
 	}
 
 	ret = platform_device_add_data(musb, pdata, sizeof(*pdata));
 	if (ret) {
 		dev_err(&pdev->dev, "failed to add platform_data\n");
-		goto err4;
+		goto err5;
 	}
 
 	ret = platform_device_add(musb);
 	if (ret) {
 		dev_err(&pdev->dev, "failed to register musb device\n");
-		goto err4;
+		goto err5;
 	}
 
 	return 0;
 
+err5:
+	da8xx_cppi41_sysfs_exit(glue);
+
 err4:
 	clk_disable(clk);
 
@@ -774,6 +1027,7 @@ static int __exit da8xx_remove(struct platform_device *pdev)
 
 	platform_device_del(glue->musb);
 	/*platform_device_put(glue->musb);*/
+	da8xx_cppi41_sysfs_exit(glue);
 	clk_disable(glue->clk);
 	clk_put(glue->clk);
 	kfree(glue);
@@ -134,6 +134,8 @@ struct dma_controller;
  * @private_data: channel-private data
  * @max_len: the maximum number of bytes the channel can move in one
  *	transaction (typically representing many USB maximum-sized packets)
+ * @max_sgs: the maximum number of scatterlist entries channel_program_sg()
+ *	accepts in one transaction
  * @actual_len: how many bytes have been transferred
  * @status: current channel status (updated e.g. on interrupt)
  * @desired_mode: true if mode 1 is desired; false if mode 0 is desired
@@ -145,6 +147,7 @@ struct dma_channel {
 	void			*private_data;
 	/* FIXME not void* private_data, but a dma_controller * */
 	size_t			max_len;
+	unsigned		max_sgs;
 	size_t			actual_len;
 	enum dma_channel_status	status;
 	bool			desired_mode;
@@ -172,6 +175,8 @@ dma_channel_status(struct dma_channel *c)
  *	return 0 on success, else negative errno
  * @channel_alloc: call this to allocate a DMA channel
  * @channel_release: call this to release a DMA channel
+ * @channel_program_sg: optional; like channel_program, but for a buffer
+ *	described by a DMA-mapped scatterlist
  * @channel_abort: call this to abort a pending DMA transaction,
  *	returning it to FREE (but allocated) state
  *
@@ -187,6 +192,11 @@ struct dma_controller {
 							u16 maxpacket, u8 mode,
 							dma_addr_t dma_addr,
 							u32 length);
+	int			(*channel_program_sg)(struct dma_channel *channel,
+							u16 maxpacket, u8 mode,
+							struct scatterlist *sg,
+							unsigned num_sgs,
+							u32 length);
 	int			(*channel_abort)(struct dma_channel *);
 	int			(*is_compatible)(struct dma_channel *channel,
 							u16 maxpacket,
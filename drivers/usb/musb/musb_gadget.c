@@ -110,6 +110,19 @@ static inline void map_dma_buffer(struct musb_request *request,
 	 * DMA code must reject the USB request explicitly.
 	 * Default behaviour is to map the request.
 	 */
+	if (request->request.num_sgs) {
+		request->request.num_mapped_sgs = dma_map_sg(
+				musb->controller,
+				request->request.sg,
+				request->request.num_sgs,
+				request->tx
+					? DMA_TO_DEVICE
+					: DMA_FROM_DEVICE);
+		if (request->request.num_mapped_sgs)
+			request->map_state = MUSB_MAPPED_SG;
+		return;
+	}
+
 	if (dma->is_compatible)
 		compatible = dma->is_compatible(musb_ep->dma,
 				musb_ep->packet_sz, request->request.buf,
@@ -144,6 +157,18 @@ static inline void unmap_dma_buffer(struct musb_request *request,
 	if (!is_buffer_mapped(request))
 		return;
 
+	if (request->map_state == MUSB_MAPPED_SG) {
+		dma_unmap_sg(musb->controller,
+			request->request.sg,
+			request->request.num_sgs,
+			request->tx
+				? DMA_TO_DEVICE
+				: DMA_FROM_DEVICE);
+		request->request.num_mapped_sgs = 0;
+		request->map_state = UN_MAPPED;
+		return;
+	}
+
 	if (request->request.dma == DMA_ADDR_INVALID) {
 		dev_vdbg(musb->controller,
 				"not unmapping a never mapped buffer\n");
@@ -354,7 +379,7 @@ static void txstate(struct musb *musb, struct musb_request *req)
 			csr);
 
 #ifndef	CONFIG_MUSB_PIO_ONLY
-	if (is_buffer_mapped(req)) {
+	if (is_buffer_mapped(req) && musb_ep->dma) {
 		struct dma_controller	*c = musb->dma_controller;
 		size_t request_size;
 
@@ -434,7 +459,22 @@ static void txstate(struct musb *musb, struct musb_request *req)
 			/* for zero byte transfer use pio mode */
 			if (request_size == 0)
 					use_dma = 0;
-			else {
+			else if (req->map_state == MUSB_MAPPED_SG) {
+				/* whole request in one go, see musb_gadget_queue */
+				use_dma = c->channel_program_sg(
+					musb_ep->dma, musb_ep->packet_sz,
+					0,
+					request->sg,
+					request->num_mapped_sgs,
+					request->length);
+				if (!use_dma) {
+					c->channel_release(musb_ep->dma);
+					musb_ep->dma = NULL;
+					csr &= ~(MUSB_TXCSR_DMAENAB |
+						 MUSB_TXCSR_DMAMODE);
+					musb_writew(epio, MUSB_TXCSR, csr);
+				}
+			} else {
 				use_dma = use_dma && c->channel_program(
 					musb_ep->dma, musb_ep->packet_sz,
 					0,
@@ -459,6 +499,18 @@ static void txstate(struct musb *musb, struct musb_request *req)
 #endif
 
 	if (!use_dma) {
+		/*
+		 * There is no linear buffer to fall back to PIO with; fail
+		 * the request and go on with the next one.
+		 */
+		if (request->num_sgs) {
+			musb_g_giveback(musb_ep, request, -EIO);
+			req = musb_ep->desc ? next_request(musb_ep) : NULL;
+			if (req && !musb_ep->busy)
+				musb_ep_restart(musb, req);
+			return;
+		}
+
 		/*
 		 * Unmap the dma buffer back to cpu if dma channel
 		 * programming fails
@@ -1286,12 +1338,24 @@ static int musb_gadget_queue(struct usb_ep *ep, struct usb_request *req,
 
 	if (!ep || !req)
 		return -EINVAL;
-	if (!req->buf)
+	if (!req->buf && !req->num_sgs)
 		return -ENODATA;
 
 	musb_ep = to_musb_ep(ep);
 	musb = musb_ep->musb;
 
+	/*
+	 * Scatter-gather requests are only handled by DMA engines that can
+	 * chain buffers, and only for IN transfers: the whole request must
+	 * fit in one DMA program.
+	 */
+	if (req->num_sgs && (!musb_ep->is_in || !is_dma_capable() ||
+			     !musb_ep->dma ||
+			     !musb->dma_controller->channel_program_sg ||
+			     req->length > musb_ep->dma->max_len ||
+			     req->num_sgs > musb_ep->dma->max_sgs))
+		return -EINVAL;
+
 	request = to_musb_request(req);
 	request->musb = musb;
 
@@ -1307,6 +1371,8 @@ static int musb_gadget_queue(struct usb_ep *ep, struct usb_request *req,
 	request->tx = musb_ep->is_in;
 
 	map_dma_buffer(request, musb, musb_ep);
+	if (req->num_sgs && request->map_state != MUSB_MAPPED_SG)
+		return -ENOMEM;
 
 	spin_lock_irqsave(&musb->lock, lockflags);
 
@@ -1835,6 +1901,12 @@ int __devinit musb_gadget_setup(struct musb *musb)
 	musb->g.ops = &musb_gadget_operations;
 	musb->g.max_speed = USB_SPEED_HIGH;
 	musb->g.speed = USB_SPEED_UNKNOWN;
+	/*
+	 * sg_supported would promise scatter-gather in both directions, but
+	 * only IN endpoints take sg requests (see musb_gadget_queue), so it
+	 * stays clear.
+	 */
+	musb->g.sg_supported = 0;
 
 	/* this "gadget" abstracts/virtualizes the controller */
 	dev_set_name(&musb->g.dev, "gadget");
@@ -40,7 +40,8 @@
 enum buffer_map_state {
 	UN_MAPPED = 0,
 	PRE_MAPPED,
-	MUSB_MAPPED
+	MUSB_MAPPED,
+	MUSB_MAPPED_SG
 };
 
 struct musb_request {
@@ -32,8 +32,14 @@
 #include <linux/console.h>
 #include <linux/spinlock.h>
 #include <linux/slab.h>
+#include <linux/workqueue.h>
+#include <linux/jiffies.h>
+#include <linux/completion.h>
+#include <linux/mutex.h>
+#include <linux/log2.h>
 #include <video/da8xx-fb.h>
 #include <asm/div64.h>
+#include <mach/edma.h>
 
 #define DRIVER_NAME "da8xx_lcdc"
 
@@ -123,6 +129,12 @@
 #define LCD_NUM_BUFFERS	2
 
 #define WSI_TIMEOUT	50
+#define IDLE_TIMEOUT_MS	1000
+#define LCD_IDLE_DMA_BURST	16
+
+/* Smaller rectangles are drawn by the CPU, DMA setup would dominate */
+#define BLIT_DMA_MIN_BYTES	2048
+#define BLIT_TIMEOUT		(HZ / 10)
 #define PALETTE_SIZE	256
 #ifdef CONFIG_GLCD_DVI_VGA
 #define LEFT_MARGIN	142
@@ -161,7 +173,7 @@ struct da8xx_fb_par {
 	unsigned int		dma_end;
 	struct clk *lcdc_clk;
 	int irq;
-	unsigned short pseudo_palette[16];
+	u32 pseudo_palette[16];
 	unsigned int palette_sz;
 	unsigned int pxl_clk;
 	int blank;
@@ -180,6 +192,28 @@ struct da8xx_fb_par {
 	unsigned int		lcd_fck_rate;
 #endif
 	void (*panel_power_ctrl)(int);
+
+	/*
+	 * Refresh rate throttling while the screen is static. The pixel
+	 * clock divider is multiplied by idle_refresh_div and the raster
+	 * DMA uses LCD_IDLE_DMA_BURST once no damage has been reported for
+	 * idle_timeout jiffies.
+	 */
+	spinlock_t		refresh_lock;
+	struct delayed_work	idle_work;
+	unsigned long		last_damage;
+	unsigned long		idle_timeout;
+	unsigned int		idle_refresh_div;
+	int			refresh_idle;
+	int			dma_burst_sz;
+
+	/* EDMA channel for rectangle copies and fills, -1 if unavailable */
+	int			blit_chan;
+	struct mutex		blit_lock;
+	struct completion	blit_done;
+	u16			blit_status;
+	void			*fill_virt;	/* one line of fill colour */
+	dma_addr_t		fill_phys;
 };
 
 /* Variable Screen Information */
@@ -512,6 +546,16 @@ static void lcd_blit(int load_mode, struct da8xx_fb_par *par)
 	lcd_enable_raster();
 }
 
+/* Change only the DMA burst size; safe while the raster is running */
+static void lcd_set_dma_burst(int burst_size)
+{
+	u32 reg;
+
+	reg = lcdc_read(LCD_DMA_CTRL_REG) & ~LCD_DMA_BURST_SIZE(0x7);
+	reg |= LCD_DMA_BURST_SIZE(ilog2(burst_size));
+	lcdc_write(reg, LCD_DMA_CTRL_REG);
+}
+
 /* Configure the Burst Size and fifo threhold of DMA */
 static int lcd_cfg_dma(int burst_size,  int fifo_th)
 {
@@ -793,6 +837,8 @@ static void lcd_calc_clk_divider(struct da8xx_fb_par *par)
 
 	lcd_clk = clk_get_rate(par->lcdc_clk);
 	div = lcd_clk / par->pxl_clk;
+	if (par->refresh_idle)
+		div = min_t(unsigned int, div * par->idle_refresh_div, 0xff);
 
 	/* Configure the LCD clock divisor. */
 	lcdc_write(LCD_CLK_DIVISOR(div) |
@@ -826,6 +872,9 @@ static int lcd_init(struct da8xx_fb_par *par, const struct lcd_ctrl_config *cfg,
 	ret = lcd_cfg_dma(cfg->dma_burst_sz, cfg->fifo_th);
 	if (ret < 0)
 		return ret;
+	par->dma_burst_sz = cfg->dma_burst_sz;
+	if (par->refresh_idle)
+		lcd_set_dma_burst(max(par->dma_burst_sz, LCD_IDLE_DMA_BURST));
 
 	/* Configure the AC bias properties. */
 	lcd_cfg_ac_bias(cfg->ac_bias, cfg->ac_bias_intrpt);
@@ -1037,14 +1086,17 @@ static int lcd_da8xx_cpufreq_transition(struct notifier_block *nb,
 				     unsigned long val, void *data)
 {
 	struct da8xx_fb_par *par;
+	unsigned long flags;
 
 	par = container_of(nb, struct da8xx_fb_par, freq_transition);
 	if (val == CPUFREQ_POSTCHANGE) {
 		if (par->lcd_fck_rate != clk_get_rate(par->lcdc_clk)) {
+			spin_lock_irqsave(&par->refresh_lock, flags);
 			par->lcd_fck_rate = clk_get_rate(par->lcdc_clk);
 			lcd_disable_raster();
 			lcd_calc_clk_divider(par);
 			lcd_enable_raster();
+			spin_unlock_irqrestore(&par->refresh_lock, flags);
 		}
 	}
 
@@ -1066,6 +1118,426 @@ static inline void lcd_da8xx_cpufreq_deregister(struct da8xx_fb_par *par)
 }
 #endif
 
+/*
+ * The raster DMA fetches the complete frame from DDR on every refresh, which
+ * competes with EDMA for the memory bus. While nothing on screen changes the
+ * refresh rate is lowered by idle_refresh_div, and the slower FIFO drain
+ * leaves room for longer, more DDR-efficient bursts; reported damage to the
+ * visible area restores the nominal settings immediately. Both are changed
+ * in place, without stopping the raster, as a raster restart shows up as a
+ * flicker. Must be called with refresh_lock held.
+ */
+static void lcd_set_refresh_idle(struct da8xx_fb_par *par, int idle)
+{
+	if (par->refresh_idle == idle)
+		return;
+
+	par->refresh_idle = idle;
+	lcd_calc_clk_divider(par);
+	lcd_set_dma_burst(idle ? max(par->dma_burst_sz, LCD_IDLE_DMA_BURST) :
+			  par->dma_burst_sz);
+}
+
+static void lcd_idle_work(struct work_struct *work)
+{
+	struct da8xx_fb_par *par = container_of(work, struct da8xx_fb_par,
+						idle_work.work);
+	unsigned long expires;
+	unsigned long flags;
+
+	spin_lock_irqsave(&par->refresh_lock, flags);
+	expires = par->last_damage + par->idle_timeout;
+	if (time_before(jiffies, expires)) {
+		/* Damage arrived since the work was queued */
+		spin_unlock_irqrestore(&par->refresh_lock, flags);
+		schedule_delayed_work(&par->idle_work, expires - jiffies);
+		return;
+	}
+
+	if (par->idle_refresh_div > 1)
+		lcd_set_refresh_idle(par, 1);
+	spin_unlock_irqrestore(&par->refresh_lock, flags);
+}
+
+/* Note a change of the visible frame; safe to call from atomic context */
+static void da8xx_fb_damage(struct da8xx_fb_par *par)
+{
+	unsigned long flags;
+
+	if (par->idle_refresh_div <= 1)
+		return;
+
+	spin_lock_irqsave(&par->refresh_lock, flags);
+	par->last_damage = jiffies;
+	lcd_set_refresh_idle(par, 0);
+	spin_unlock_irqrestore(&par->refresh_lock, flags);
+
+	schedule_delayed_work(&par->idle_work, par->idle_timeout);
+}
+
+static int da8xx_fb_report_damage(struct fb_info *info,
+				  const struct da8xx_fb_damage *rect)
+{
+	struct fb_var_screeninfo *var = &info->var;
+
+	if (!rect->width || !rect->height ||
+	    rect->x >= var->xres_virtual || rect->y >= var->yres_virtual ||
+	    rect->width > var->xres_virtual - rect->x ||
+	    rect->height > var->yres_virtual - rect->y)
+		return -EINVAL;
+
+	/*
+	 * Drawing into a buffer that is not being scanned out does not need
+	 * the full refresh rate; panning to it reports the damage instead.
+	 */
+	if (rect->y >= var->yoffset + var->yres ||
+	    rect->y + rect->height <= var->yoffset)
+		return 0;
+
+	da8xx_fb_damage(info->par);
+	return 0;
+}
+
+static void da8xx_fb_blit_callback(unsigned lch, u16 ch_status, void *data)
+{
+	struct da8xx_fb_par *par = data;
+
+	par->blit_status = ch_status;
+	complete(&par->blit_done);
+}
+
+/*
+ * Move a rectangle of @height lines of @width bytes with one ABSYNC
+ * transfer: ACNT covers a line, BCNT counts lines and the B indexes are
+ * the line strides. A zero source stride replicates the same source line,
+ * which is how fills work. Caller must hold blit_lock.
+ */
+static int lcd_dma_rect(struct da8xx_fb_par *par, dma_addr_t src,
+			s16 src_bidx, dma_addr_t dst, s16 dst_bidx,
+			u16 width, u16 height)
+{
+	struct edmacc_param param;
+
+	param.opt = TCINTEN | EDMA_TCC(EDMA_CHAN_SLOT(par->blit_chan)) |
+			SYNCDIM;
+	param.src = src;
+	param.a_b_cnt = height << 16 | width;
+	param.dst = dst;
+	param.src_dst_bidx = (u16)dst_bidx << 16 | (u16)src_bidx;
+	param.link_bcntrld = 0xffff;
+	param.src_dst_cidx = 0;
+	param.ccnt = 1;
+	edma_write_slot(par->blit_chan, &param);
+
+	/* Make CPU writes to the frame buffer visible to the TC */
+	wmb();
+
+	INIT_COMPLETION(par->blit_done);
+	edma_start(par->blit_chan);
+	if (!wait_for_completion_timeout(&par->blit_done, BLIT_TIMEOUT)) {
+		edma_stop(par->blit_chan);
+		edma_clean_channel(par->blit_chan);
+		return -ETIMEDOUT;
+	}
+
+	return par->blit_status == DMA_COMPLETE ? 0 : -EIO;
+}
+
+/*
+ * The drawing hooks are only called by fbcon.  It draws from printk()
+ * through console_unlock(), which runs the console drivers with
+ * interrupts off, and otherwise from process context under
+ * console_lock().
+ */
+static bool da8xx_fb_console_may_sleep(void)
+{
+	return !irqs_disabled() && !oops_in_progress;
+}
+
+/* Only use the DMA engine where waiting for it is allowed */
+static int da8xx_fb_can_dma(struct fb_info *info, u32 width, u32 height)
+{
+	struct da8xx_fb_par *par = info->par;
+
+	if (!da8xx_fb_console_may_sleep() || par->blit_chan < 0 ||
+	    info->var.bits_per_pixel < 8)
+		return 0;
+
+	return width * height * (info->var.bits_per_pixel / 8) >=
+			BLIT_DMA_MIN_BYTES;
+}
+
+/* Lines are copied in order, so same-line overlaps are left to the CPU */
+static bool da8xx_fb_copy_overlaps(u32 sx, u32 sy, u32 dx, u32 dy,
+				   u32 width)
+{
+	return sy == dy && sx < dx + width && dx < sx + width;
+}
+
+static int da8xx_fb_dma_copy(struct fb_info *info, u32 sx, u32 sy,
+			     u32 dx, u32 dy, u32 width, u32 height)
+{
+	struct da8xx_fb_par *par = info->par;
+	unsigned int bytes = info->var.bits_per_pixel / 8;
+	int pitch = info->fix.line_length;
+	dma_addr_t src, dst;
+	int ret;
+
+	if (da8xx_fb_copy_overlaps(sx, sy, dx, dy, width))
+		return -EINVAL;
+
+	src = info->fix.smem_start + sy * pitch + sx * bytes;
+	dst = info->fix.smem_start + dy * pitch + dx * bytes;
+	if (dy > sy) {
+		src += (height - 1) * pitch;
+		dst += (height - 1) * pitch;
+		pitch = -pitch;
+	}
+
+	mutex_lock(&par->blit_lock);
+	ret = lcd_dma_rect(par, src, pitch, dst, pitch, width * bytes, height);
+	mutex_unlock(&par->blit_lock);
+
+	return ret;
+}
+
+static int da8xx_fb_dma_fill(struct fb_info *info, u32 dx, u32 dy,
+			     u32 width, u32 height, u32 color)
+{
+	struct da8xx_fb_par *par = info->par;
+	unsigned int bytes = info->var.bits_per_pixel / 8;
+	int pitch = info->fix.line_length;
+	dma_addr_t dst;
+	u16 *line;
+	int ret, i;
+
+	dst = info->fix.smem_start + dy * pitch + dx * bytes;
+
+	mutex_lock(&par->blit_lock);
+	if (bytes == 1) {
+		memset(par->fill_virt, color, width);
+	} else {
+		line = par->fill_virt;
+		for (i = 0; i < width; i++)
+			line[i] = color;
+	}
+	ret = lcd_dma_rect(par, par->fill_phys, 0, dst, pitch, width * bytes,
+			   height);
+	mutex_unlock(&par->blit_lock);
+
+	return ret;
+}
+
+static void da8xx_fb_fillrect(struct fb_info *info,
+			      const struct fb_fillrect *rect)
+{
+	u32 color = rect->color;
+
+	if (rect->rop != ROP_COPY ||
+	    !da8xx_fb_can_dma(info, rect->width, rect->height)) {
+		cfb_fillrect(info, rect);
+	} else {
+		if (info->fix.visual == FB_VISUAL_TRUECOLOR)
+			color = ((u32 *)info->pseudo_palette)[rect->color];
+		if (da8xx_fb_dma_fill(info, rect->dx, rect->dy, rect->width,
+				      rect->height, color))
+			cfb_fillrect(info, rect);
+	}
+	da8xx_fb_damage(info->par);
+}
+
+static void da8xx_fb_copyarea(struct fb_info *info,
+			      const struct fb_copyarea *area)
+{
+	if (!da8xx_fb_can_dma(info, area->width, area->height) ||
+	    da8xx_fb_dma_copy(info, area->sx, area->sy, area->dx, area->dy,
+			      area->width, area->height))
+		cfb_copyarea(info, area);
+	da8xx_fb_damage(info->par);
+}
+
+static int da8xx_fb_user_blit(struct fb_info *info,
+			      const struct da8xx_fb_blit *blit)
+{
+	struct fb_var_screeninfo *var = &info->var;
+	struct da8xx_fb_par *par = info->par;
+	struct da8xx_fb_damage damage;
+	int ret;
+
+	if (par->blit_chan < 0 || var->bits_per_pixel < 8)
+		return -ENODEV;
+
+	if (!blit->width || !blit->height ||
+	    blit->dx >= var->xres_virtual || blit->dy >= var->yres_virtual ||
+	    blit->width > var->xres_virtual - blit->dx ||
+	    blit->height > var->yres_virtual - blit->dy)
+		return -EINVAL;
+
+	switch (blit->op) {
+	case DA8XX_FB_BLIT_COPY:
+		if (blit->sx >= var->xres_virtual ||
+		    blit->sy >= var->yres_virtual ||
+		    blit->width > var->xres_virtual - blit->sx ||
+		    blit->height > var->yres_virtual - blit->sy)
+			return -EINVAL;
+		if (da8xx_fb_copy_overlaps(blit->sx, blit->sy, blit->dx,
+					   blit->dy, blit->width)) {
+			struct fb_copyarea area = {
+				.dx	= blit->dx,
+				.dy	= blit->dy,
+				.width	= blit->width,
+				.height	= blit->height,
+				.sx	= blit->sx,
+				.sy	= blit->sy,
+			};
+
+			cfb_copyarea(info, &area);
+			ret = 0;
+		} else {
+			ret = da8xx_fb_dma_copy(info, blit->sx, blit->sy,
+						blit->dx, blit->dy,
+						blit->width, blit->height);
+		}
+		break;
+	case DA8XX_FB_BLIT_FILL:
+		ret = da8xx_fb_dma_fill(info, blit->dx, blit->dy, blit->width,
+					blit->height, blit->color);
+		break;
+	default:
+		return -EINVAL;
+	}
+	if (ret)
+		return ret;
+
+	damage.x = blit->dx;
+	damage.y = blit->dy;
+	damage.width = blit->width;
+	damage.height = blit->height;
+	return da8xx_fb_report_damage(info, &damage);
+}
+
+static int __devinit da8xx_fb_blit_init(struct da8xx_fb_par *par,
+					unsigned int line_length)
+{
+	par->blit_chan = -1;
+	mutex_init(&par->blit_lock);
+	init_completion(&par->blit_done);
+
+	par->fill_virt = dma_alloc_coherent(NULL, line_length,
+					    &par->fill_phys, GFP_KERNEL);
+	if (!par->fill_virt)
+		return -ENOMEM;
+
+	par->blit_chan = edma_alloc_channel(EDMA_CHANNEL_ANY,
+					    da8xx_fb_blit_callback, par,
+					    EVENTQ_DEFAULT);
+	if (par->blit_chan < 0) {
+		dma_free_coherent(NULL, line_length, par->fill_virt,
+				  par->fill_phys);
+		return par->blit_chan;
+	}
+
+	return 0;
+}
+
+static void da8xx_fb_blit_exit(struct da8xx_fb_par *par,
+			       unsigned int line_length)
+{
+	if (par->blit_chan < 0)
+		return;
+
+	edma_free_channel(par->blit_chan);
+	dma_free_coherent(NULL, line_length, par->fill_virt, par->fill_phys);
+	par->blit_chan = -1;
+}
+
+static void da8xx_fb_imageblit(struct fb_info *info,
+			       const struct fb_image *image)
+{
+	cfb_imageblit(info, image);
+	da8xx_fb_damage(info->par);
+}
+
+static ssize_t show_idle_refresh_div(struct device *dev,
+				     struct device_attribute *attr, char *buf)
+{
+	struct fb_info *info = dev_get_drvdata(dev);
+	struct da8xx_fb_par *par = info->par;
+
+	return sprintf(buf, "%u\n", par->idle_refresh_div);
+}
+
+static ssize_t store_idle_refresh_div(struct device *dev,
+				      struct device_attribute *attr,
+				      const char *buf, size_t count)
+{
+	struct fb_info *info = dev_get_drvdata(dev);
+	struct da8xx_fb_par *par = info->par;
+	unsigned long flags;
+	unsigned int div;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &div);
+	if (ret)
+		return ret;
+	if (div > 0xff)
+		return -EINVAL;
+
+	spin_lock_irqsave(&par->refresh_lock, flags);
+	par->idle_refresh_div = div;
+	par->last_damage = jiffies;
+	lcd_set_refresh_idle(par, 0);
+	spin_unlock_irqrestore(&par->refresh_lock, flags);
+
+	if (div > 1)
+		schedule_delayed_work(&par->idle_work, par->idle_timeout);
+
+	return count;
+}
+
+static ssize_t show_idle_timeout_ms(struct device *dev,
+				    struct device_attribute *attr, char *buf)
+{
+	struct fb_info *info = dev_get_drvdata(dev);
+	struct da8xx_fb_par *par = info->par;
+
+	return sprintf(buf, "%u\n", jiffies_to_msecs(par->idle_timeout));
+}
+
+static ssize_t store_idle_timeout_ms(struct device *dev,
+				     struct device_attribute *attr,
+				     const char *buf, size_t count)
+{
+	struct fb_info *info = dev_get_drvdata(dev);
+	struct da8xx_fb_par *par = info->par;
+	unsigned int ms;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &ms);
+	if (ret)
+		return ret;
+	if (!ms)
+		return -EINVAL;
+
+	par->idle_timeout = msecs_to_jiffies(ms);
+	return count;
+}
+
+static DEVICE_ATTR(idle_refresh_div, S_IRUGO | S_IWUSR,
+		   show_idle_refresh_div, store_idle_refresh_div);
+static DEVICE_ATTR(idle_timeout_ms, S_IRUGO | S_IWUSR,
+		   show_idle_timeout_ms, store_idle_timeout_ms);
+
+static struct attribute *da8xx_fb_attrs[] = {
+	&dev_attr_idle_refresh_div.attr,
+	&dev_attr_idle_timeout_ms.attr,
+	NULL,
+};
+
+static const struct attribute_group da8xx_fb_attr_group = {
+	.attrs = da8xx_fb_attrs,
+};
+
 static int __devexit fb_remove(struct platform_device *dev)
 {
 	struct fb_info *info = dev_get_drvdata(&dev->dev);
@@ -1076,6 +1548,8 @@ static int __devexit fb_remove(struct platform_device *dev)
 #ifdef CONFIG_CPU_FREQ
 		lcd_da8xx_cpufreq_deregister(par);
 #endif
+		sysfs_remove_group(&dev->dev.kobj, &da8xx_fb_attr_group);
+
 		if (par->panel_power_ctrl)
 			par->panel_power_ctrl(0);
 
@@ -1086,6 +1560,9 @@ static int __devexit fb_remove(struct platform_device *dev)
 		lcdc_write(0, LCD_DMA_CTRL_REG);
 
 		unregister_framebuffer(info);
+		/* Drawing can schedule the idle work until unregistered */
+		cancel_delayed_work_sync(&par->idle_work);
+		da8xx_fb_blit_exit(par, info->fix.line_length);
 		fb_dealloc_cmap(&info->cmap);
 		dma_free_coherent(NULL, PALETTE_SIZE, par->v_palette_base,
 				  par->p_palette_base);
@@ -1139,6 +1616,8 @@ static int fb_ioctl(struct fb_info *info, unsigned int cmd,
 			  unsigned long arg)
 {
 	struct lcd_sync_arg sync_arg;
+	struct da8xx_fb_damage damage;
+	struct da8xx_fb_blit blit;
 
 	switch (cmd) {
 	case FBIOGET_CONTRAST:
@@ -1166,6 +1645,16 @@ static int fb_ioctl(struct fb_info *info, unsigned int cmd,
 		break;
 	case FBIO_WAITFORVSYNC:
 		return fb_wait_for_vsync(info);
+	case FBIO_DA8XX_DAMAGE:
+		if (copy_from_user(&damage, (char *)arg,
+				sizeof(struct da8xx_fb_damage)))
+			return -EFAULT;
+		return da8xx_fb_report_damage(info, &damage);
+	case FBIO_DA8XX_BLIT:
+		if (copy_from_user(&blit, (char *)arg,
+				sizeof(struct da8xx_fb_blit)))
+			return -EFAULT;
+		return da8xx_fb_user_blit(info, &blit);
 	default:
 		return -EINVAL;
 	}
@@ -1247,6 +1736,7 @@ static int da8xx_pan_display(struct fb_var_screeninfo *var,
 			}
 			spin_unlock_irqrestore(&par->lock_for_chan_update,
 					irq_flags);
+			da8xx_fb_damage(par);
 		}
 	}
 
@@ -1259,9 +1749,9 @@ static struct fb_ops da8xx_fb_ops = {
 	.fb_setcolreg = fb_setcolreg,
 	.fb_pan_display = da8xx_pan_display,
 	.fb_ioctl = fb_ioctl,
-	.fb_fillrect = cfb_fillrect,
-	.fb_copyarea = cfb_copyarea,
-	.fb_imageblit = cfb_imageblit,
+	.fb_fillrect = da8xx_fb_fillrect,
+	.fb_copyarea = da8xx_fb_copyarea,
+	.fb_imageblit = da8xx_fb_imageblit,
 	.fb_blank = cfb_blank,
 };
 
@@ -1374,6 +1864,10 @@ static int __devinit fb_probe(struct platform_device *device)
 	par->lcd_fck_rate = clk_get_rate(fb_clk);
 #endif
 	par->pxl_clk = lcdc_info->pxl_clk;
+	spin_lock_init(&par->refresh_lock);
+	INIT_DELAYED_WORK(&par->idle_work, lcd_idle_work);
+	par->idle_refresh_div = 1;
+	par->idle_timeout = msecs_to_jiffies(IDLE_TIMEOUT_MS);
 	if (fb_pdata->panel_power_ctrl) {
 		par->panel_power_ctrl = fb_pdata->panel_power_ctrl;
 		par->panel_power_ctrl(1);
@@ -1477,12 +1971,16 @@ static int __devinit fb_probe(struct platform_device *device)
 	par->which_dma_channel_done = -1;
 	spin_lock_init(&par->lock_for_chan_update);
 
+	/* The CPU still draws if no DMA channel is left for blits */
+	if (da8xx_fb_blit_init(par, da8xx_fb_fix.line_length))
+		dev_info(&device->dev, "GLCD: no EDMA channel for blits\n");
+
 	/* Register the Frame Buffer  */
 	if (register_framebuffer(da8xx_fb_info) < 0) {
 		dev_err(&device->dev,
 			"GLCD: Frame Buffer Registration Failed!\n");
 		ret = -EINVAL;
-		goto err_dealloc_cmap;
+		goto err_blit_exit;
 	}
 
 #ifdef CONFIG_CPU_FREQ
@@ -1502,8 +2000,16 @@ static int __devinit fb_probe(struct platform_device *device)
 			DRIVER_NAME, par);
 	if (ret)
 		goto irq_freq;
+
+	ret = sysfs_create_group(&device->dev.kobj, &da8xx_fb_attr_group);
+	if (ret) {
+		dev_err(&device->dev, "failed to create sysfs entries\n");
+		goto err_free_irq;
+	}
 	return 0;
 
+err_free_irq:
+	free_irq(par->irq, par);
 irq_freq:
 #ifdef CONFIG_CPU_FREQ
 	lcd_da8xx_cpufreq_deregister(par);
@@ -1511,7 +2017,8 @@ err_cpu_freq:
 #endif
 	unregister_framebuffer(da8xx_fb_info);
 
-err_dealloc_cmap:
+err_blit_exit:
+	da8xx_fb_blit_exit(par, da8xx_fb_fix.line_length);
 	fb_dealloc_cmap(&da8xx_fb_info->cmap);
 
 err_release_pl_mem:
@@ -1550,6 +2057,7 @@ static int fb_suspend(struct platform_device *dev, pm_message_t state)
 		par->panel_power_ctrl(0);
 
 	fb_set_suspend(info, 1);
+	cancel_delayed_work_sync(&par->idle_work);
 	lcd_disable_raster();
 	clk_disable(par->lcdc_clk);
 	console_unlock();
@@ -0,0 +1,84 @@
+// pru_gpio_sample.p - sample a DA8xx GPIO bank pair at a fixed rate
+//
+// Firmware for drivers/staging/iio/adc/davinci_pru_gpio.c; build with
+// TI's PRU assembler:  pasm -b pru_gpio_sample.p
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation.
+//
+// The driver fills in the parameter block at the start of this PRU's
+// data RAM before starting us:
+//
+//   0x00  run		cleared by the ARM to stop sampling
+//   0x04  gpio_in	address of the IN_DATA register to sample
+//   0x08  period	PRU cycles between samples, less loop overhead;
+//			re-read every sample, the ARM updates it when
+//			the PRU clock changes
+//   0x0c  ring		address of the sample ring (32-bit entries)
+//   0x10  mask		ring entries - 1, entries a power of two
+//   0x14  watermark	samples between notifications to the ARM
+//   0x18  pru_ctrl	address of this PRU's control registers
+//   0x1c  signal	value written to R31 to notify the ARM
+//   0x20  head		next ring entry we write
+//   0x24  tail		next ring entry the ARM reads
+//   0x28  overruns	samples dropped because the ring was full
+//
+// Timing uses the PRU cycle counter, restarted at the top of each
+// sample, so that the variable latency of the GPIO read does not move
+// the sampling instants.
+
+.origin 0
+.entrypoint START
+
+START:
+	MOV	r1, 0
+	LBBO	r2, r1, 0x04, 28	// r2 gpio_in .. r8 signal
+
+	LBBO	r16, r7, 0, 4		// CONTROL with counter on and off
+	SET	r16, r16, 3
+	CLR	r17, r16, 3
+
+	MOV	r9, 0			// head
+	MOV	r11, 0			// samples since last notification
+	MOV	r13, 0			// overruns
+	MOV	r18, 0
+
+SAMPLE:
+	SBBO	r17, r7, 0, 4		// restart the cycle counter
+	SBBO	r18, r7, 0x0c, 4
+	SBBO	r16, r7, 0, 4
+
+	LBBO	r10, r2, 0, 4		// the sample
+
+	LBBO	r12, r1, 0x24, 4	// tail
+	ADD	r15, r9, 1
+	AND	r15, r15, r5
+	QBEQ	OVERRUN, r15, r12
+
+	LSL	r19, r9, 2
+	SBBO	r10, r4, r19, 4
+	MOV	r9, r15
+	SBBO	r9, r1, 0x20, 4		// publish head
+
+	ADD	r11, r11, 1
+	QBNE	WAIT, r11, r6
+	MOV	r11, 0
+	MOV	r31, r8			// notify the ARM
+	JMP	WAIT
+
+OVERRUN:
+	ADD	r13, r13, 1
+	SBBO	r13, r1, 0x28, 4
+
+WAIT:
+	LBBO	r12, r1, 0x00, 4	// still running?
+	QBEQ	DONE, r12, 0
+	LBBO	r3, r1, 0x08, 4		// period
+WAIT_CYCLES:
+	LBBO	r15, r7, 0x0c, 4	// CYCLE
+	QBLT	WAIT_CYCLES, r3, r15	// until r15 >= period
+	JMP	SAMPLE
+
+DONE:
+	HALT
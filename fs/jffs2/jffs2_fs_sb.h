@@ -32,6 +32,7 @@ struct jffs2_inodirty;
 struct jffs2_mount_opts {
 	bool override_compr;
 	unsigned int compr;
+	bool fastmount;
 };
 
 /* A struct for the overall file system control.  Pointers to
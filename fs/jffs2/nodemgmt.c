@@ -212,6 +212,33 @@ static void jffs2_close_nextblock(struct jffs2_sb_info *c, struct jffs2_eraseblo
 
 }
 
+#ifdef CONFIG_JFFS2_SUMMARY
+/* Write out the summary of the partially-written nextblock and close it,
+   so that the next mount finds a summary in every block in use and need
+   not scan node headers at all. The rest of the block is padded and left
+   for GC to reclaim. Called with alloc_sem held. */
+void jffs2_sum_close_nextblock(struct jffs2_sb_info *c)
+{
+	struct jffs2_eraseblock *jeb;
+	int ret;
+
+	spin_lock(&c->erase_completion_lock);
+	jeb = c->nextblock;
+	if (!jeb || jffs2_sum_is_disabled(c->summary) ||
+	    !c->summary->sum_num ||
+	    jeb->free_size < PAD(c->summary->sum_size + JFFS2_SUMMARY_FRAME_SIZE)) {
+		spin_unlock(&c->erase_completion_lock);
+		return;
+	}
+
+	dbg_summary("generating summary for 0x%08x at unmount.\n", jeb->offset);
+	ret = jffs2_sum_write_sumnode(c);
+	if (!ret && !jffs2_sum_is_disabled(c->summary))
+		jffs2_close_nextblock(c, jeb);
+	spin_unlock(&c->erase_completion_lock);
+}
+#endif
+
 /* Select a new jeb for nextblock */
 
 static int jffs2_find_nextblock(struct jffs2_sb_info *c)
@@ -750,7 +777,9 @@ int jffs2_thread_should_wake(struct jffs2_sb_info *c)
 	    !list_empty(&c->erase_pending_list))
 		return 1;
 
-	if (c->unchecked_size) {
+	/* With fastmount, nodes are CRC-checked as their inodes are first
+	   read, or by the GC pass once there is real collection to do. */
+	if (c->unchecked_size && !c->mount_opts.fastmount) {
 		D1(printk(KERN_DEBUG "jffs2_thread_should_wake(): unchecked_size %d, checked_ino #%d\n",
 			  c->unchecked_size, c->checked_ino));
 		return 1;
@@ -103,6 +103,8 @@ static int jffs2_show_options(struct seq_file *s, struct dentry *root)
 
 	if (opts->override_compr)
 		seq_printf(s, ",compr=%s", jffs2_compr_name(opts->compr));
+	if (opts->fastmount)
+		seq_printf(s, ",fastmount");
 
 	return 0;
 }
@@ -169,15 +171,18 @@ static const struct export_operations jffs2_export_ops = {
  * JFFS2 mount options.
  *
  * Opt_override_compr: override default compressor
+ * Opt_fastmount: summarize the current block at unmount, check lazily
  * Opt_err: just end of array marker
  */
 enum {
 	Opt_override_compr,
+	Opt_fastmount,
 	Opt_err,
 };
 
 static const match_table_t tokens = {
 	{Opt_override_compr, "compr=%s"},
+	{Opt_fastmount, "fastmount"},
 	{Opt_err, NULL},
 };
 
@@ -222,6 +227,9 @@ static int jffs2_parse_options(struct jffs2_sb_info *c, char *data)
 			kfree(name);
 			c->mount_opts.override_compr = true;
 			break;
+		case Opt_fastmount:
+			c->mount_opts.fastmount = true;
+			break;
 		default:
 			printk(KERN_ERR "JFFS2 Error: unrecognized mount option '%s' or missing value\n",
 					p);
@@ -321,6 +329,8 @@ static void jffs2_put_super (struct super_block *sb)
 		jffs2_write_super(sb);
 
 	mutex_lock(&c->alloc_sem);
+	if (c->mount_opts.fastmount && !(sb->s_flags & MS_RDONLY))
+		jffs2_sum_close_nextblock(c);
 	jffs2_flush_wbuf_pad(c);
 	mutex_unlock(&c->alloc_sem);
 
@@ -0,0 +1,218 @@
+/*
+ * Squashfs - a compressed read only filesystem for Linux
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * decompressor_multi.c
+ */
+
+#include <linux/types.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/buffer_head.h>
+#include <linux/sched.h>
+#include <linux/wait.h>
+#include <linux/cpumask.h>
+
+#include "squashfs_fs.h"
+#include "squashfs_fs_sb.h"
+#include "decompressor.h"
+#include "squashfs.h"
+
+/*
+ * This file implements multi-threaded decompression in the
+ * decompressor framework.  Decompressors are kept in a pool which
+ * starts with one decompressor and grows on demand, up to two per
+ * online CPU, so readers only wait for each other once all of them
+ * are busy.  The decompressors are kept until the filesystem is
+ * unmounted.
+ */
+
+struct squashfs_stream {
+	void			*comp_opts;
+	int			comp_opts_len;
+	struct list_head	strm_list;
+	struct mutex		mutex;
+	int			avail_decomp;
+	wait_queue_head_t	wait;
+};
+
+
+struct decomp_stream {
+	void			*stream;
+	struct list_head	list;
+};
+
+
+static struct decomp_stream *alloc_decomp_stream(
+	struct squashfs_sb_info *msblk, struct squashfs_stream *stream)
+{
+	struct decomp_stream *decomp_strm;
+
+	decomp_strm = kmalloc(sizeof(*decomp_strm), GFP_KERNEL);
+	if (decomp_strm == NULL)
+		return ERR_PTR(-ENOMEM);
+
+	decomp_strm->stream = msblk->decompressor->init(msblk,
+		stream->comp_opts, stream->comp_opts_len);
+	if (IS_ERR(decomp_strm->stream)) {
+		void *err = decomp_strm->stream;
+
+		kfree(decomp_strm);
+		return err;
+	}
+
+	return decomp_strm;
+}
+
+
+void *squashfs_decompressor_create(struct squashfs_sb_info *msblk,
+						void *comp_opts, int length)
+{
+	struct squashfs_stream *stream;
+	struct decomp_stream *decomp_strm;
+	int err = -ENOMEM;
+
+	stream = kzalloc(sizeof(*stream), GFP_KERNEL);
+	if (stream == NULL)
+		goto out;
+
+	/*
+	 * Keep the compressor options, they are needed each time the pool
+	 * grows.
+	 */
+	if (comp_opts) {
+		stream->comp_opts = kmemdup(comp_opts, length, GFP_KERNEL);
+		if (stream->comp_opts == NULL)
+			goto out;
+		stream->comp_opts_len = length;
+	}
+
+	INIT_LIST_HEAD(&stream->strm_list);
+	mutex_init(&stream->mutex);
+	init_waitqueue_head(&stream->wait);
+
+	/*
+	 * Create the first decompressor now, this also checks the
+	 * compressor options.
+	 */
+	decomp_strm = alloc_decomp_stream(msblk, stream);
+	if (IS_ERR(decomp_strm)) {
+		err = PTR_ERR(decomp_strm);
+		goto out;
+	}
+
+	list_add(&decomp_strm->list, &stream->strm_list);
+	stream->avail_decomp = 1;
+	return stream;
+
+out:
+	if (stream)
+		kfree(stream->comp_opts);
+	kfree(stream);
+	return ERR_PTR(err);
+}
+
+
+void squashfs_decompressor_destroy(struct squashfs_sb_info *msblk)
+{
+	struct squashfs_stream *stream = msblk->stream;
+	struct decomp_stream *decomp_strm, *next;
+
+	if (stream == NULL)
+		return;
+
+	list_for_each_entry_safe(decomp_strm, next, &stream->strm_list, list) {
+		msblk->decompressor->free(decomp_strm->stream);
+		kfree(decomp_strm);
+	}
+
+	kfree(stream->comp_opts);
+	kfree(stream);
+}
+
+
+/*
+ * Get an idle decompressor from the pool, creating a new one if there is
+ * none and the pool may still grow, otherwise wait for one to be put back.
+ */
+static struct decomp_stream *get_decomp_stream(struct squashfs_sb_info *msblk,
+	struct squashfs_stream *stream)
+{
+	struct decomp_stream *decomp_strm;
+
+	while (1) {
+		mutex_lock(&stream->mutex);
+
+		if (!list_empty(&stream->strm_list)) {
+			decomp_strm = list_first_entry(&stream->strm_list,
+				struct decomp_stream, list);
+			list_del(&decomp_strm->list);
+			mutex_unlock(&stream->mutex);
+			return decomp_strm;
+		}
+
+		if (stream->avail_decomp < squashfs_max_decompressors()) {
+			stream->avail_decomp++;
+			mutex_unlock(&stream->mutex);
+
+			decomp_strm = alloc_decomp_stream(msblk, stream);
+			if (!IS_ERR(decomp_strm))
+				return decomp_strm;
+
+			/*
+			 * Not enough memory for another decompressor, wait
+			 * for one of the existing ones instead.
+			 */
+			mutex_lock(&stream->mutex);
+			stream->avail_decomp--;
+		}
+
+		mutex_unlock(&stream->mutex);
+		wait_event(stream->wait, !list_empty(&stream->strm_list));
+	}
+}
+
+
+static void put_decomp_stream(struct decomp_stream *decomp_strm,
+	struct squashfs_stream *stream)
+{
+	mutex_lock(&stream->mutex);
+	list_add(&decomp_strm->list, &stream->strm_list);
+	mutex_unlock(&stream->mutex);
+	wake_up(&stream->wait);
+}
+
+
+int squashfs_decompress(struct squashfs_sb_info *msblk, void **buffer,
+	struct buffer_head **bh, int b, int offset, int length, int srclength,
+	int pages)
+{
+	int res;
+	struct squashfs_stream *stream = msblk->stream;
+	struct decomp_stream *decomp_strm = get_decomp_stream(msblk, stream);
+
+	res = msblk->decompressor->decompress(msblk, decomp_strm->stream,
+		buffer, bh, b, offset, length, srclength, pages);
+	put_decomp_stream(decomp_strm, stream);
+
+	return res;
+}
+
+
+int squashfs_max_decompressors(void)
+{
+	return num_online_cpus() * 2;
+}
@@ -410,8 +410,17 @@ static int squashfs_readpage(struct file *file, struct page *page)
 			sparse = 1;
 		} else {
 			/*
-			 * Read and decompress datablock.
+			 * Try to decompress the datablock straight into the
+			 * page cache, if that is not possible read and
+			 * decompress it through the read_page cache.
 			 */
+			int res = squashfs_readpage_block(page, block, bsize);
+
+			if (res < 0)
+				goto error_out;
+			if (res == 0)
+				return 0;
+
 			buffer = squashfs_get_datablock(inode->i_sb,
 								block, bsize);
 			if (buffer->error) {
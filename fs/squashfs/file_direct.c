@@ -0,0 +1,135 @@
+/*
+ * Squashfs - a compressed read only filesystem for Linux
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * file_direct.c
+ */
+
+#include <linux/types.h>
+#include <linux/mutex.h>
+
+/*
+ * This file contains code to decompress a datablock straight into the
+ * page cache.  Squashfs_readpage() normally decompresses datablocks into
+ * the read_page cache and then copies them into the page cache pages,
+ * which costs a copy of every byte read and serialises all readers on
+ * the few read_page cache entries.  If all the pages the datablock
+ * decompresses into can be grabbed, they are handed to the decompressor
+ * directly, otherwise squashfs_readpage() falls back to the read_page
+ * cache.
+ */
+
+#include <linux/fs.h>
+#include <linux/vfs.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/pagemap.h>
+#include <linux/mm.h>
+
+#include "squashfs_fs.h"
+#include "squashfs_fs_sb.h"
+#include "squashfs_fs_i.h"
+#include "squashfs.h"
+
+/*
+ * Read the datablock containing page into the page cache.  Returns 0 if
+ * the block was read (and page unlocked), 1 if the caller should fall
+ * back to the read_page cache, or a negative error (with page still
+ * locked).
+ */
+int squashfs_readpage_block(struct page *target_page, u64 block, int bsize)
+{
+	struct inode *inode = target_page->mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int file_end = (i_size_read(inode) - 1) >> PAGE_CACHE_SHIFT;
+	int mask = (1 << (msblk->block_log - PAGE_CACHE_SHIFT)) - 1;
+	int start_index = target_page->index & ~mask;
+	int end_index = start_index | mask;
+	int i, n, pages, res = 1, bytes;
+	struct page **page;
+	void **data;
+
+	if (end_index > file_end)
+		end_index = file_end;
+	pages = end_index - start_index + 1;
+
+	page = kmalloc(pages * (sizeof(*page) + sizeof(*data)), GFP_KERNEL);
+	if (page == NULL)
+		goto fallback;
+	data = (void **) (page + pages);
+
+	/*
+	 * Grab all the pages of the datablock.  If any of them is missing
+	 * (locked by someone else), already up to date or in high memory,
+	 * give up and let the read_page cache handle the block.
+	 */
+	for (n = 0, i = start_index; i <= end_index; n++, i++) {
+		page[n] = (i == target_page->index) ? target_page :
+			grab_cache_page_nowait(target_page->mapping, i);
+
+		if (page[n] == NULL)
+			goto release;
+
+		if (PageHighMem(page[n]) || (page[n] != target_page &&
+						PageUptodate(page[n]))) {
+			n++;
+			goto release;
+		}
+
+		data[n] = page_address(page[n]);
+	}
+
+	res = squashfs_read_data(inode->i_sb, data, block, bsize, NULL,
+		pages << PAGE_CACHE_SHIFT, pages);
+	if (res < 0) {
+		ERROR("Unable to read page, block %llx, size %x\n", block,
+			bsize);
+		for (i = 0; i < pages; i++)
+			if (page[i] != target_page) {
+				unlock_page(page[i]);
+				page_cache_release(page[i]);
+			}
+		kfree(page);
+		return res;
+	}
+
+	for (i = 0, bytes = res; i < pages; i++, bytes -= PAGE_CACHE_SIZE) {
+		int avail = clamp_t(int, bytes, 0, PAGE_CACHE_SIZE);
+
+		memset(data[i] + avail, 0, PAGE_CACHE_SIZE - avail);
+		flush_dcache_page(page[i]);
+		SetPageUptodate(page[i]);
+		unlock_page(page[i]);
+		if (page[i] != target_page)
+			page_cache_release(page[i]);
+	}
+
+	kfree(page);
+	atomic_inc(&msblk->direct_reads);
+	return 0;
+
+release:
+	for (i = 0; i < n; i++)
+		if (page[i] && page[i] != target_page) {
+			unlock_page(page[i]);
+			page_cache_release(page[i]);
+		}
+	kfree(page);
+fallback:
+	atomic_inc(&msblk->direct_fallbacks);
+	return 1;
+}
@@ -50,10 +50,29 @@ extern void *squashfs_read_table(struct super_block *, u64, int);
 extern const struct squashfs_decompressor *squashfs_lookup_decompressor(int);
 extern void *squashfs_decompressor_init(struct super_block *, unsigned short);
 
+/* decompressor_xxx.c */
+extern void *squashfs_decompressor_create(struct squashfs_sb_info *,
+				void *, int);
+extern void squashfs_decompressor_destroy(struct squashfs_sb_info *);
+extern int squashfs_decompress(struct squashfs_sb_info *, void **,
+				struct buffer_head **, int, int, int, int, int);
+extern int squashfs_max_decompressors(void);
+
 /* export.c */
 extern __le64 *squashfs_read_inode_lookup_table(struct super_block *, u64, u64,
 				unsigned int);
 
+/* file_direct.c */
+#ifdef CONFIG_SQUASHFS_FILE_DIRECT
+extern int squashfs_readpage_block(struct page *, u64, int);
+#else
+static inline int squashfs_readpage_block(struct page *page, u64 block,
+				int bsize)
+{
+	return 1;
+}
+#endif
+
 /* fragment.c */
 extern int squashfs_frag_lookup(struct super_block *, unsigned int, u64 *);
 extern __le64 *squashfs_read_fragment_index_table(struct super_block *,
@@ -69,6 +88,22 @@ extern struct inode *squashfs_iget(struct super_block *, long long,
 				unsigned int);
 extern int squashfs_read_inode(struct inode *, long long);
 
+/* stats.c */
+#ifdef CONFIG_DEBUG_FS
+extern int squashfs_stats_init(void);
+extern void squashfs_stats_exit(void);
+extern void squashfs_stats_add(struct super_block *);
+extern void squashfs_stats_remove(struct super_block *);
+#else
+static inline int squashfs_stats_init(void)
+{
+	return 0;
+}
+static inline void squashfs_stats_exit(void) { }
+static inline void squashfs_stats_add(struct super_block *sb) { }
+static inline void squashfs_stats_remove(struct super_block *sb) { }
+#endif
+
 /* xattr.c */
 extern ssize_t squashfs_listxattr(struct dentry *, char *, size_t);
 
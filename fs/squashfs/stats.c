@@ -0,0 +1,130 @@
+/*
+ * Squashfs - a compressed read only filesystem for Linux
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * stats.c
+ */
+
+#include <linux/types.h>
+#include <linux/mutex.h>
+
+/*
+ * This file exports per-mount statistics in debugfs, under
+ * squashfs/<device>/stats, to help size the caches and choose the
+ * decompressor configuration.
+ */
+
+#include <linux/module.h>
+#include <linux/fs.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+
+#include "squashfs_fs.h"
+#include "squashfs_fs_sb.h"
+#include "squashfs.h"
+
+static struct dentry *squashfs_debugfs_root;
+
+static void show_cache(struct seq_file *m, struct squashfs_cache *cache)
+{
+	unsigned long hits, misses;
+
+	spin_lock(&cache->lock);
+	hits = cache->hits;
+	misses = cache->misses;
+	spin_unlock(&cache->lock);
+
+	seq_printf(m, "%s cache:\t%d entries, %lu hits, %lu misses\n",
+		cache->name, cache->entries, hits, misses);
+}
+
+static int squashfs_stats_show(struct seq_file *m, void *v)
+{
+	struct squashfs_sb_info *msblk = m->private;
+
+	show_cache(m, msblk->block_cache);
+	show_cache(m, msblk->fragment_cache);
+	show_cache(m, msblk->read_page);
+	seq_printf(m, "direct reads:\t%d\n", atomic_read(&msblk->direct_reads));
+	seq_printf(m, "direct fallbacks:\t%d\n",
+		atomic_read(&msblk->direct_fallbacks));
+	seq_printf(m, "decompressors:\t%d\n", squashfs_max_decompressors());
+	return 0;
+}
+
+static int squashfs_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, squashfs_stats_show, inode->i_private);
+}
+
+static const struct file_operations squashfs_stats_fops = {
+	.owner		= THIS_MODULE,
+	.open		= squashfs_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+
+void squashfs_stats_add(struct super_block *sb)
+{
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+	struct dentry *dir;
+
+	if (squashfs_debugfs_root == NULL)
+		return;
+
+	dir = debugfs_create_dir(sb->s_id, squashfs_debugfs_root);
+	if (IS_ERR_OR_NULL(dir))
+		return;
+
+	if (IS_ERR_OR_NULL(debugfs_create_file("stats", S_IRUSR, dir, msblk,
+			&squashfs_stats_fops))) {
+		debugfs_remove(dir);
+		return;
+	}
+
+	msblk->stats_dentry = dir;
+}
+
+
+void squashfs_stats_remove(struct super_block *sb)
+{
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+
+	debugfs_remove_recursive(msblk->stats_dentry);
+	msblk->stats_dentry = NULL;
+}
+
+
+/*
+ * Statistics are not essential, so failing to create the debugfs
+ * directory is not an error.
+ */
+int squashfs_stats_init(void)
+{
+	squashfs_debugfs_root = debugfs_create_dir("squashfs", NULL);
+	if (IS_ERR(squashfs_debugfs_root))
+		squashfs_debugfs_root = NULL;
+	return 0;
+}
+
+
+void squashfs_stats_exit(void)
+{
+	debugfs_remove_recursive(squashfs_debugfs_root);
+}
@@ -22,10 +22,14 @@
  *          Adrian Hunter
  */
 
-/* This file implements EXT2-compatible extended attribute ioctl() calls */
+/*
+ * This file implements EXT2-compatible extended attribute ioctl() calls and
+ * the UBIFS-specific per-file compressor ioctl() calls.
+ */
 
 #include <linux/compat.h>
 #include <linux/mount.h>
+#include <mtd/ubifs-user.h>
 #include "ubifs.h"
 
 /**
@@ -144,6 +148,50 @@ out_unlock:
 	return err;
 }
 
+/**
+ * setcompr - change the compressor of an inode.
+ * @inode: the inode to change
+ * @compr_type: new compressor type
+ *
+ * Only data written from now on is compressed with the new compressor, the
+ * data nodes already on the media are left alone. Returns zero in case of
+ * success and a negative error code in case of failure.
+ */
+static int setcompr(struct inode *inode, int compr_type)
+{
+	int err, release;
+	struct ubifs_inode *ui = ubifs_inode(inode);
+	struct ubifs_info *c = inode->i_sb->s_fs_info;
+	struct ubifs_budget_req req = { .dirtied_ino = 1,
+					.dirtied_ino_d = ui->data_len };
+
+	BUILD_BUG_ON(UBIFS_IOC_COMPR_LZO != UBIFS_COMPR_LZO ||
+		     UBIFS_IOC_COMPR_ZLIB != UBIFS_COMPR_ZLIB ||
+		     UBIFS_IOC_COMPR_LZ4 != UBIFS_COMPR_LZ4);
+
+	if (compr_type < 0 || compr_type >= UBIFS_COMPR_TYPES_CNT)
+		return -EINVAL;
+	if (!ubifs_compr_present(compr_type))
+		return -EOPNOTSUPP;
+
+	err = ubifs_budget_space(c, &req);
+	if (err)
+		return err;
+
+	mutex_lock(&ui->ui_mutex);
+	ui->compr_type = compr_type;
+	inode->i_ctime = ubifs_current_time(inode);
+	release = ui->dirty;
+	mark_inode_dirty_sync(inode);
+	mutex_unlock(&ui->ui_mutex);
+
+	if (release)
+		ubifs_release_budget(c, &req);
+	if (IS_SYNC(inode))
+		err = write_inode_now(inode, 1);
+	return err;
+}
+
 long ubifs_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
 	int flags, err;
@@ -182,6 +230,32 @@ long ubifs_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		return err;
 	}
 
+	case UBIFS_IOCGCOMPR:
+		return put_user(ubifs_inode(inode)->compr_type,
+				(__s32 __user *) arg);
+
+	case UBIFS_IOCSCOMPR: {
+		__s32 compr_type;
+
+		if (IS_RDONLY(inode))
+			return -EROFS;
+
+		if (!inode_owner_or_capable(inode))
+			return -EACCES;
+
+		if (get_user(compr_type, (__s32 __user *) arg))
+			return -EFAULT;
+
+		err = mnt_want_write_file(file);
+		if (err)
+			return err;
+		dbg_gen("set compressor %d, was %d", compr_type,
+			ubifs_inode(inode)->compr_type);
+		err = setcompr(inode, compr_type);
+		mnt_drop_write_file(file);
+		return err;
+	}
+
 	default:
 		return -ENOTTY;
 	}
@@ -197,6 +271,9 @@ long ubifs_compat_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 	case FS_IOC32_SETFLAGS:
 		cmd = FS_IOC_SETFLAGS;
 		break;
+	case UBIFS_IOCGCOMPR:
+	case UBIFS_IOCSCOMPR:
+		break;
 	default:
 		return -ENOIOCTLCMD;
 	}
@@ -61,6 +61,11 @@ struct device_node;
  *	returns either the value actually sensed, or zero
  * @direction_output: configures signal "offset" as output, or returns error
  * @set: assigns output value for signal "offset"
+ * @get_multiple: optional; returns the values of the signals selected by
+ *	"mask", where bit N stands for signal "offset" + N, sampled in as
+ *	few accesses as the hardware allows
+ * @set_multiple: optional; assigns "bits" to the output signals selected
+ *	by "mask", with the same numbering as @get_multiple
  * @to_irq: optional hook supporting non-static gpio_to_irq() mappings;
  *	implementation may not sleep
  * @dbg_show: optional routine to show contents in debugfs; default code
@@ -111,6 +116,14 @@ struct gpio_chip {
 	void			(*set)(struct gpio_chip *chip,
 						unsigned offset, int value);
 
+	unsigned long		(*get_multiple)(struct gpio_chip *chip,
+						unsigned offset,
+						unsigned long mask);
+	void			(*set_multiple)(struct gpio_chip *chip,
+						unsigned offset,
+						unsigned long mask,
+						unsigned long bits);
+
 	int			(*to_irq)(struct gpio_chip *chip,
 						unsigned offset);
 
@@ -161,6 +174,12 @@ extern int gpio_set_debounce(unsigned gpio, unsigned debounce);
 extern int gpio_get_value_cansleep(unsigned gpio);
 extern void gpio_set_value_cansleep(unsigned gpio, int value);
 
+/* Several GPIOs of one chip at once; bit N of mask and values is gpio + N */
+extern int gpio_get_multiple(unsigned gpio, unsigned long mask,
+			unsigned long *values);
+extern int gpio_set_multiple(unsigned gpio, unsigned long mask,
+			unsigned long values);
+
 
 /* A platform's <asm/gpio.h> code may want to inline the I/O calls when
  * the GPIO is constant and refers to some always-present controller,
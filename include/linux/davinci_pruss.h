@@ -0,0 +1,77 @@
+/*
+ * DA8xx PRUSS firmware loader and ARM <-> PRU messaging
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef __LINUX_DAVINCI_PRUSS_H
+#define __LINUX_DAVINCI_PRUSS_H
+
+#include <linux/types.h>
+
+#define PRUSS_NUM_PRU		2
+#define PRUSS_CHANS_PER_PRU	4
+
+/*
+ * Firmware ABI
+ *
+ * Each PRU has up to PRUSS_CHANS_PER_PRU message channels.  A channel is
+ * a pair of rings in shared RAM (or DDR when shared RAM is exhausted):
+ * one written by the ARM and read by the PRU, and one the other way
+ * round.  Before a PRU is started, the driver fills in one
+ * struct pruss_chan_desc per requested channel at PRUSS_CHAN_TABLE in
+ * that PRU's data RAM; unused entries are zero.
+ *
+ * Channel c of PRU p uses the host interrupt h = p * 4 + c:
+ *  - the PRU signals new messages with system event 32 + h, i.e. by
+ *    writing (1 << 5) | h to R31; the ARM clears it.
+ *  - the ARM signals new messages with system event 40 + h, which is
+ *    routed to host interrupt p (R31 bit 30 + p); the PRU clears it by
+ *    writing the event number to the INTC SICR register.
+ * Both stay within the PRU-generated events 32..63; events 0..31 belong
+ * to the SoC peripherals.
+ *
+ * All ring fields are little-endian 32-bit words.  A ring has
+ * 'slots' entries of 4 + msg_size bytes following the header; each
+ * entry starts with the payload length.  The producer only writes
+ * 'head' and the consumer only writes 'tail', both counting modulo
+ * 'slots'.  The ring is empty when head == tail and full when
+ * head + 1 == tail.
+ */
+#define PRUSS_CHAN_TABLE	0x1c0
+
+struct pruss_chan_desc {
+	u32	to_pru;			/* ring address */
+	u32	from_pru;		/* ring address */
+	u32	to_pru_event;
+	u32	from_pru_event;
+};
+
+struct pruss_ring_hdr {
+	u32	head;
+	u32	tail;
+	u32	slots;
+	u32	msg_size;
+};
+
+struct pruss_chan;
+
+/*
+ * Called from hard interrupt context whenever the PRU signals the
+ * channel; normally drains it with pruss_chan_recv().
+ */
+typedef void (*pruss_chan_cb_t)(struct pruss_chan *chan, void *data);
+
+extern struct pruss_chan *pruss_chan_request(unsigned pru, unsigned idx,
+		unsigned slots, size_t msg_size, pruss_chan_cb_t cb, void *data);
+extern void pruss_chan_free(struct pruss_chan *chan);
+extern int pruss_chan_send(struct pruss_chan *chan, const void *msg,
+		size_t len);
+extern int pruss_chan_recv(struct pruss_chan *chan, void *msg, size_t len);
+
+extern int pruss_boot(unsigned pru, const char *fw_name);
+extern void pruss_halt(unsigned pru);
+extern void __iomem *pruss_dram(unsigned pru);
+
+#endif /* __LINUX_DAVINCI_PRUSS_H */
@@ -123,6 +123,22 @@ static inline void gpio_set_value_cansleep(unsigned gpio, int value)
 	WARN_ON(1);
 }
 
+static inline int gpio_get_multiple(unsigned gpio, unsigned long mask,
+				    unsigned long *values)
+{
+	/* GPIO can never have been requested or set as {in,out}put */
+	WARN_ON(1);
+	return -EINVAL;
+}
+
+static inline int gpio_set_multiple(unsigned gpio, unsigned long mask,
+				    unsigned long values)
+{
+	/* GPIO can never have been requested or set as output */
+	WARN_ON(1);
+	return -EINVAL;
+}
+
 static inline int gpio_export(unsigned gpio, bool direction_may_change)
 {
 	/* GPIO can never have been requested or set as {in,out}put */
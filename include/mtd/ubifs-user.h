@@ -0,0 +1,59 @@
+/*
+ * This file is part of UBIFS.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef __UBIFS_USER_H__
+#define __UBIFS_USER_H__
+
+#include <linux/types.h>
+
+/*
+ * Per-file compressor
+ * ~~~~~~~~~~~~~~~~~~~
+ *
+ * Every UBIFS inode has a compressor which is used for the data written to it
+ * from then on; data which is already on the media stays as it is. New inodes
+ * get the default compressor of the file-system. The compressor of an open
+ * file may be read with the %UBIFS_IOCGCOMPR ioctl command and changed with
+ * the %UBIFS_IOCSCOMPR ioctl command, both take a pointer to a &__s32
+ * holding one of the %UBIFS_IOC_COMPR_* values. Changing the compressor
+ * requires the same permissions as changing the inode flags.
+ *
+ * For example, read-mostly executables may use LZ4 to be decompressed
+ * quickly, while log files may use zlib to take less space:
+ *
+ * int compr = UBIFS_IOC_COMPR_LZ4;
+ * ioctl(fd, UBIFS_IOCSCOMPR, &compr);
+ *
+ * Note, data is only compressed if the %FS_COMPR_FL inode flag is set, which
+ * is the default.
+ */
+
+/* Compressor types, the same as used on the media */
+#define UBIFS_IOC_COMPR_NONE	0
+#define UBIFS_IOC_COMPR_LZO	1
+#define UBIFS_IOC_COMPR_ZLIB	2
+#define UBIFS_IOC_COMPR_LZ4	3
+
+/* ioctl commands of UBIFS files */
+#define UBIFS_IOC_MAGIC 'O'
+
+/* Get the compressor of a file */
+#define UBIFS_IOCGCOMPR _IOR(UBIFS_IOC_MAGIC, 64, __s32)
+/* Set the compressor of a file */
+#define UBIFS_IOCSCOMPR _IOW(UBIFS_IOC_MAGIC, 65, __s32)
+
+#endif /* __UBIFS_USER_H__ */
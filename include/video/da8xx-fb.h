@@ -94,6 +94,29 @@ struct lcd_sync_arg {
 	int pulse_width;
 };
 
+/* Dirty rectangle, in pixels of the virtual frame buffer */
+struct da8xx_fb_damage {
+	__u32 x;
+	__u32 y;
+	__u32 width;
+	__u32 height;
+};
+
+/* Rectangle copy or solid fill within the virtual frame buffer */
+#define DA8XX_FB_BLIT_COPY	0
+#define DA8XX_FB_BLIT_FILL	1
+
+struct da8xx_fb_blit {
+	__u32 op;
+	__u32 sx;		/* source, ignored for fills */
+	__u32 sy;
+	__u32 dx;
+	__u32 dy;
+	__u32 width;
+	__u32 height;
+	__u32 color;		/* raw pixel value for fills */
+};
+
 /* ioctls */
 #define FBIOGET_CONTRAST	_IOR('F', 1, int)
 #define FBIOPUT_CONTRAST	_IOW('F', 2, int)
@@ -103,6 +126,8 @@ struct lcd_sync_arg {
 #define FBIPUT_COLOR		_IOW('F', 6, int)
 #define FBIPUT_HSYNC		_IOW('F', 9, int)
 #define FBIPUT_VSYNC		_IOW('F', 10, int)
+#define FBIO_DA8XX_DAMAGE	_IOW('F', 11, struct da8xx_fb_damage)
+#define FBIO_DA8XX_BLIT		_IOW('F', 12, struct da8xx_fb_blit)
 
 struct da8xx_clcd_platform_data {
 	u8 version;
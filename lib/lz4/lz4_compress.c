@@ -0,0 +1,136 @@
+/*
+ *  LZ4 Compressor
+ *
+ *  A single pass, greedy LZ4 block compressor. Candidate matches are found
+ *  through a hash table of 4-byte sequences indexed by position; when there
+ *  is no match the search step grows, so incompressible data is skipped over
+ *  quickly.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <asm/unaligned.h>
+#include <linux/lz4.h>
+#include "lz4defs.h"
+
+/* Every 2^LZ4_SKIP_TRIGGER misses in a row the search step grows by one */
+#define LZ4_SKIP_TRIGGER	6
+
+static inline u32 lz4_hash(const unsigned char *p)
+{
+	return (get_unaligned((const u32 *)p) * 2654435761U) >>
+	       (32 - LZ4_HASH_LOG);
+}
+
+static unsigned char *lz4_put_length(unsigned char *op, size_t len)
+{
+	while (len >= 255) {
+		*op++ = 255;
+		len -= 255;
+	}
+	*op++ = len;
+	return op;
+}
+
+int lz4_compress(const unsigned char *in, size_t in_len, unsigned char *out,
+		 size_t *out_len, void *wrkmem)
+{
+	const unsigned char * const in_end = in + in_len;
+	const unsigned char * const mflimit = in_end - LZ4_MFLIMIT;
+	const unsigned char * const match_limit = in_end - LZ4_LAST_LITERALS;
+	const unsigned char *ip = in, *anchor = in, *ref;
+	unsigned char * const op_end = out + *out_len;
+	unsigned char *op = out, *token;
+	u32 *dict = wrkmem;
+	size_t lit, len;
+	unsigned int misses = 0;
+
+	memset(dict, 0, LZ4_MEM_COMPRESS);
+
+	if (in_len <= LZ4_MFLIMIT)
+		goto last_literals;
+
+	while (ip <= mflimit) {
+		u32 h = lz4_hash(ip);
+
+		ref = in + dict[h];
+		dict[h] = ip - in;
+
+		if (ref == ip || ip - ref > LZ4_MAX_DISTANCE ||
+		    get_unaligned((const u32 *)ref) !=
+		    get_unaligned((const u32 *)ip)) {
+			ip += 1 + (misses++ >> LZ4_SKIP_TRIGGER);
+			continue;
+		}
+		misses = 0;
+
+		/* The match may extend backwards into pending literals */
+		while (ip > anchor && ref > in && ip[-1] == ref[-1]) {
+			ip--;
+			ref--;
+		}
+
+		len = LZ4_MIN_MATCH;
+		while (ip + len < match_limit && ip[len] == ref[len])
+			len++;
+
+		lit = ip - anchor;
+		if (lit + lit / 255 + (len - LZ4_MIN_MATCH) / 255 + 5 >
+		    (size_t)(op_end - op))
+			goto output_overrun;
+
+		token = op++;
+		if (lit >= LZ4_RUN_MASK) {
+			*token = LZ4_RUN_MASK << LZ4_RUN_BITS;
+			op = lz4_put_length(op, lit - LZ4_RUN_MASK);
+		} else
+			*token = lit << LZ4_RUN_BITS;
+		memcpy(op, anchor, lit);
+		op += lit;
+
+		put_unaligned_le16(ip - ref, op);
+		op += 2;
+
+		len -= LZ4_MIN_MATCH;
+		if (len >= LZ4_ML_MASK) {
+			*token |= LZ4_ML_MASK;
+			op = lz4_put_length(op, len - LZ4_ML_MASK);
+		} else
+			*token |= len;
+
+		ip += len + LZ4_MIN_MATCH;
+		anchor = ip;
+
+		/* Remember a position inside the match for the next search */
+		dict[lz4_hash(ip - 2)] = ip - 2 - in;
+	}
+
+last_literals:
+	lit = in_end - anchor;
+	if (lit + lit / 255 + 2 > (size_t)(op_end - op))
+		goto output_overrun;
+
+	if (lit >= LZ4_RUN_MASK) {
+		*op++ = LZ4_RUN_MASK << LZ4_RUN_BITS;
+		op = lz4_put_length(op, lit - LZ4_RUN_MASK);
+	} else
+		*op++ = lit << LZ4_RUN_BITS;
+	memcpy(op, anchor, lit);
+	op += lit;
+
+	*out_len = op - out;
+	return LZ4_E_OK;
+
+output_overrun:
+	*out_len = op - out;
+	return LZ4_E_OUTPUT_OVERRUN;
+}
+EXPORT_SYMBOL_GPL(lz4_compress);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("LZ4 Compressor");
@@ -0,0 +1,113 @@
+/*
+ *  LZ4 Decompressor
+ *
+ *  Every length and offset read from the compressed stream is checked
+ *  against the input and output buffers, so corrupted input can not make it
+ *  read or write out of bounds.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <asm/unaligned.h>
+#include <linux/lz4.h>
+#include "lz4defs.h"
+
+#define COPY4(dst, src)	\
+		put_unaligned(get_unaligned((const u32 *)(src)), (u32 *)(dst))
+
+int lz4_decompress_safe(const unsigned char *in, size_t in_len,
+			unsigned char *out, size_t *out_len)
+{
+	const unsigned char * const ip_end = in + in_len;
+	unsigned char * const op_end = out + *out_len;
+	const unsigned char *ip = in, *ref;
+	unsigned char *op = out;
+	size_t lit, len, offset;
+	unsigned int token, s;
+
+	for (;;) {
+		if (ip >= ip_end)
+			goto input_overrun;
+		token = *ip++;
+
+		lit = token >> LZ4_RUN_BITS;
+		if (lit == LZ4_RUN_MASK) {
+			do {
+				if (ip >= ip_end)
+					goto input_overrun;
+				s = *ip++;
+				lit += s;
+			} while (s == 255);
+		}
+
+		if (lit > (size_t)(ip_end - ip))
+			goto input_overrun;
+		if (lit > (size_t)(op_end - op))
+			goto output_overrun;
+		memcpy(op, ip, lit);
+		op += lit;
+		ip += lit;
+
+		/* The last sequence has literals only */
+		if (ip == ip_end)
+			break;
+
+		if (ip_end - ip < 2)
+			goto input_overrun;
+		offset = get_unaligned_le16(ip);
+		ip += 2;
+		if (offset == 0 || offset > (size_t)(op - out))
+			goto lookbehind_overrun;
+
+		len = token & LZ4_ML_MASK;
+		if (len == LZ4_ML_MASK) {
+			do {
+				if (ip >= ip_end)
+					goto input_overrun;
+				s = *ip++;
+				len += s;
+			} while (s == 255);
+		}
+		len += LZ4_MIN_MATCH;
+
+		if (len > (size_t)(op_end - op))
+			goto output_overrun;
+
+		ref = op - offset;
+		if (offset >= 4) {
+			/* Source and destination never overlap within 4 bytes */
+			while (len >= 4) {
+				COPY4(op, ref);
+				op += 4;
+				ref += 4;
+				len -= 4;
+			}
+		}
+		while (len--)
+			*op++ = *ref++;
+	}
+
+	*out_len = op - out;
+	return LZ4_E_OK;
+
+input_overrun:
+	*out_len = op - out;
+	return LZ4_E_INPUT_OVERRUN;
+
+output_overrun:
+	*out_len = op - out;
+	return LZ4_E_OUTPUT_OVERRUN;
+
+lookbehind_overrun:
+	*out_len = op - out;
+	return LZ4_E_LOOKBEHIND_OVERRUN;
+}
+EXPORT_SYMBOL_GPL(lz4_decompress_safe);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("LZ4 Decompressor");
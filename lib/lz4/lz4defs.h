@@ -0,0 +1,28 @@
+/*
+ *  lz4defs.h -- LZ4 block format constants
+ *
+ *  A compressed block is a sequence of sequences. Each sequence starts with
+ *  a token byte whose high nibble is the literal length and whose low nibble
+ *  is the match length minus LZ4_MIN_MATCH; a nibble of 15 means further
+ *  length bytes follow, each adding up to 255. The token is followed by the
+ *  literals, a little-endian 16-bit match offset and the match length bytes.
+ *  The last sequence only has literals.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ */
+
+#define LZ4_MIN_MATCH		4
+#define LZ4_MAX_DISTANCE	65535
+
+/* The last match must start at least this many bytes before the end */
+#define LZ4_MFLIMIT		12
+/* and the last this many bytes are always literals */
+#define LZ4_LAST_LITERALS	5
+
+#define LZ4_RUN_BITS		4
+#define LZ4_RUN_MASK		((1U << LZ4_RUN_BITS) - 1)
+#define LZ4_ML_MASK		15
+
+#define LZ4_HASH_LOG		12
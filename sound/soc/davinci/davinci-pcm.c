@@ -272,11 +272,10 @@ static int allocate_sram(struct snd_pcm_substream *substream, unsigned size,
 		return 0;
 
 	ppcm->period_bytes_max = size;
-	iram_virt = (void *)gen_pool_alloc(davinci_gen_pool, size);
+	iram_virt = davinci_sram_alloc("davinci-pcm", size,
+				       DAVINCI_SRAM_PRIO_NORMAL, &iram_phys);
 	if (!iram_virt)
 		goto exit1;
-	iram_phys = gen_pool_virt_to_phys(davinci_gen_pool,
-					(unsigned long)iram_virt);
 	iram_dma = kzalloc(sizeof(*iram_dma), GFP_KERNEL);
 	if (!iram_dma)
 		goto exit2;
@@ -288,7 +287,7 @@ static int allocate_sram(struct snd_pcm_substream *substream, unsigned size,
 	return 0;
 exit2:
 	if (iram_virt)
-		gen_pool_free(davinci_gen_pool, (unsigned long)iram_virt, size);
+		davinci_sram_free(iram_virt);
 exit1:
 	return -ENOMEM;
 }
@@ -822,8 +821,7 @@ static void davinci_pcm_free(struct snd_pcm *pcm)
 		buf->area = NULL;
 		iram_dma = buf->private_data;
 		if (iram_dma) {
-			gen_pool_free(davinci_gen_pool,
-			      (unsigned long)iram_dma->area, iram_dma->bytes);
+			davinci_sram_free(iram_dma->area);
 			kfree(iram_dma);
 		}
 	}